@@ -0,0 +1,109 @@
+#include "Culling.h"
+
+using namespace DirectX;
+
+/// <summary>
+/// Gets the planes around a camera's view volume
+/// </summary>
+/// <param name="_view">The camera's view matrix</param>
+/// <param name="_projection">The camera's projection matrix</param>
+/// <returns>The six planes around the view volume in world space, normalized and facing inward</returns>
+Frustum Culling::ExtractFrustum(const XMFLOAT4X4& _view, const XMFLOAT4X4& _projection)
+{
+	XMMATRIX viewProjection = XMMatrixMultiply(XMLoadFloat4x4(&_view), XMLoadFloat4x4(&_projection));
+
+	// Points are row vectors (point * matrix), so each clip-space
+	// component is a dot product with one column of the matrix.
+	// A point is inside when -w <= x <= w, -w <= y <= w and 0 <= z <= w,
+	// which gives one plane for each side of each inequality
+	XMMATRIX columns = XMMatrixTranspose(viewProjection);
+	XMVECTOR planes[6] = {
+		columns.r[3] + columns.r[0],	// Left
+		columns.r[3] - columns.r[0],	// Right
+		columns.r[3] + columns.r[1],	// Bottom
+		columns.r[3] - columns.r[1],	// Top
+		columns.r[2],					// Near
+		columns.r[3] - columns.r[2],	// Far
+	};
+
+	Frustum frustum;
+	for (int i = 0; i < 6; i++) {
+		XMStoreFloat4(&frustum.Planes[i], XMPlaneNormalize(planes[i]));
+	}
+	return frustum;
+}
+
+/// <summary>
+/// Removes a frustum's near plane, so anything between the viewer and the
+/// volume (or behind the viewer, for orthographic views) counts as inside
+/// </summary>
+/// <param name="_frustum">The frustum to extend</param>
+/// <returns>The frustum with its near plane replaced by one every point is in front of</returns>
+Frustum Culling::RemoveNearPlane(const Frustum& _frustum)
+{
+	Frustum frustum = _frustum;
+	frustum.Planes[4] = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+	return frustum;
+}
+
+/// <summary>
+/// Tests which boxes are at least partly inside a frustum
+/// </summary>
+/// <param name="_frustum">The frustum to test against</param>
+/// <param name="_boxes">Array of boxes to test</param>
+/// <param name="_count">Number of boxes in the array</param>
+/// <param name="_visible">Array with room for _count results, set to 1 for boxes that are inside and 0 for boxes that aren't</param>
+/// <returns>How many boxes were tested, kept, and culled</returns>
+CullingStats Culling::TestBoxes(const Frustum& _frustum, const BoundingBox* _boxes, size_t _count, uint8_t* _visible)
+{
+	CullingStats stats = {};
+	stats.Tested = (unsigned int)_count;
+
+	// Spread each part of each plane across a whole register,
+	// so one plane can be tested against four boxes at once
+	XMVECTOR planeX[6], planeY[6], planeZ[6], planeW[6];
+	XMVECTOR absPlaneX[6], absPlaneY[6], absPlaneZ[6];
+	for (int i = 0; i < 6; i++) {
+		XMVECTOR plane = XMLoadFloat4(&_frustum.Planes[i]);
+		planeX[i] = XMVectorSplatX(plane);
+		planeY[i] = XMVectorSplatY(plane);
+		planeZ[i] = XMVectorSplatZ(plane);
+		planeW[i] = XMVectorSplatW(plane);
+		absPlaneX[i] = XMVectorAbs(planeX[i]);
+		absPlaneY[i] = XMVectorAbs(planeY[i]);
+		absPlaneZ[i] = XMVectorAbs(planeZ[i]);
+	}
+
+	for (size_t first = 0; first < _count; first += 4) {
+		// Transpose four boxes so each register holds one component of all four
+		// (lanes past the end repeat the last box and are never stored)
+		XMMATRIX centers;
+		XMMATRIX extents;
+		for (size_t lane = 0; lane < 4; lane++) {
+			size_t box = first + lane < _count ? first + lane : _count - 1;
+			centers.r[lane] = XMLoadFloat3(&_boxes[box].Center);
+			extents.r[lane] = XMLoadFloat3(&_boxes[box].Extents);
+		}
+		centers = XMMatrixTranspose(centers);
+		extents = XMMatrixTranspose(extents);
+
+		// A box is outside a plane if its center is further behind the plane
+		// than the box reaches along the plane's normal
+		XMVECTOR outside = XMVectorFalseInt();
+		for (int i = 0; i < 6; i++) {
+			XMVECTOR distance = planeX[i] * centers.r[0] + planeY[i] * centers.r[1] + planeZ[i] * centers.r[2] + planeW[i];
+			XMVECTOR reach = absPlaneX[i] * extents.r[0] + absPlaneY[i] * extents.r[1] + absPlaneZ[i] * extents.r[2];
+			outside = XMVectorOrInt(outside, XMVectorLess(distance, -reach));
+		}
+
+		uint32_t results[4];
+		XMStoreInt4(results, outside);
+		for (size_t lane = 0; lane < 4 && first + lane < _count; lane++) {
+			_visible[first + lane] = results[lane] == 0 ? 1 : 0;
+			stats.Visible += _visible[first + lane];
+		}
+	}
+
+	stats.Culled = stats.Tested - stats.Visible;
+	return stats;
+}
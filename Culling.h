@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+// Planes around a view volume, with normals pointing inward
+// - Stored as (normal, distance), so a point p is inside a
+//   plane when dot(normal, p) + distance >= 0
+struct Frustum
+{
+	DirectX::XMFLOAT4 Planes[6];	// Left, right, bottom, top, near, far
+};
+
+// How many objects a culling pass kept and rejected
+struct CullingStats
+{
+	unsigned int Tested;
+	unsigned int Visible;
+	unsigned int Culled;
+};
+
+// --------------------------------------------------------
+// Visibility tests for bounding volumes against view
+// volumes, done in batches of four with SIMD
+// --------------------------------------------------------
+namespace Culling
+{
+	// Gets the planes around the volume a view and projection matrix
+	// map into clip space (D3D style, with depth from 0 to 1)
+	Frustum ExtractFrustum(const DirectX::XMFLOAT4X4& _view, const DirectX::XMFLOAT4X4& _projection);
+
+	// Gets a copy of a frustum with no near plane, so it reaches endlessly
+	// back toward (and past) its viewer, like the path light takes to a shadow
+	Frustum RemoveNearPlane(const Frustum& _frustum);
+
+	// Tests boxes against a frustum four at a time, writing 1 to _visible for each
+	// box that's at least partly inside and 0 for the rest. Boxes near a corner of
+	// the frustum may be kept even when they're just outside it
+	CullingStats TestBoxes(const Frustum& _frustum, const DirectX::BoundingBox* _boxes, size_t _count, uint8_t* _visible);
+}
@@ -0,0 +1,243 @@
+#include "EntityStore.h"
+
+using namespace std;
+using namespace DirectX;
+
+/// <summary>
+/// Constructs a store with no entities, whose Transforms are in the shared TransformSystem
+/// </summary>
+EntityStore::EntityStore() :
+	EntityStore(TransformSystem::Global())
+{
+}
+
+/// <summary>
+/// Constructs a store with no entities
+/// </summary>
+/// <param name="_transforms">The TransformSystem to store the entities' Transforms in</param>
+EntityStore::EntityStore(TransformSystem& _transforms) :
+	transformSystem(&_transforms)
+{
+}
+
+/// <summary>
+/// Adds an entity to the end of the arrays
+/// </summary>
+/// <param name="_name">The internal name for the entity</param>
+/// <param name="_mesh">The mesh the entity will be drawn with</param>
+/// <param name="_material">The material the entity will be drawn with</param>
+/// <returns>Handle to the entity, which stays valid until it's destroyed</returns>
+unsigned int EntityStore::Create(const char* _name, std::shared_ptr<Mesh> _mesh, std::shared_ptr<Material> _material)
+{
+	unsigned int handle;
+	if (!freeHandles.empty()) {
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else {
+		handle = (unsigned int)indexOfHandle.size();
+		indexOfHandle.push_back(ENTITY_NONE);
+	}
+	indexOfHandle[handle] = (unsigned int)names.size();
+
+	shared_ptr<Transform> transform = make_shared<Transform>(*transformSystem);
+	names.push_back(_name);
+	meshes.push_back(_mesh);
+	materials.push_back(_material);
+	meshIDs.push_back(_mesh->GetSortID());
+	materialIDs.push_back(_material->GetSortID());
+	transformIDs.push_back(transform->GetID());
+	transforms.push_back(transform);
+	statics.push_back(0);
+	spinSpeeds.push_back(0.0f);
+	handleOfIndex.push_back(handle);
+	return handle;
+}
+
+/// <summary>
+/// Removes an entity, moving the last entity into its place so there
+/// are no gaps. That changes the moved entity's index, but not its handle
+/// </summary>
+/// <param name="_handle">Handle to the entity</param>
+void EntityStore::Destroy(unsigned int _handle)
+{
+	unsigned int index = indexOfHandle[_handle];
+	unsigned int last = (unsigned int)names.size() - 1;
+	if (index != last) {
+		names[index] = names[last];
+		meshes[index] = std::move(meshes[last]);
+		materials[index] = std::move(materials[last]);
+		meshIDs[index] = meshIDs[last];
+		materialIDs[index] = materialIDs[last];
+		transforms[index] = std::move(transforms[last]);
+		transformIDs[index] = transformIDs[last];
+		statics[index] = statics[last];
+		spinSpeeds[index] = spinSpeeds[last];
+		handleOfIndex[index] = handleOfIndex[last];
+		indexOfHandle[handleOfIndex[index]] = index;
+	}
+	names.pop_back();
+	meshes.pop_back();
+	materials.pop_back();
+	meshIDs.pop_back();
+	materialIDs.pop_back();
+	transforms.pop_back();
+	transformIDs.pop_back();
+	statics.pop_back();
+	spinSpeeds.pop_back();
+	handleOfIndex.pop_back();
+
+	indexOfHandle[_handle] = ENTITY_NONE;
+	freeHandles.push_back(_handle);
+}
+
+/// <summary>
+/// Removes every entity
+/// </summary>
+void EntityStore::Clear()
+{
+	names.clear();
+	meshes.clear();
+	materials.clear();
+	meshIDs.clear();
+	materialIDs.clear();
+	transforms.clear();
+	transformIDs.clear();
+	statics.clear();
+	spinSpeeds.clear();
+	handleOfIndex.clear();
+	indexOfHandle.clear();
+	freeHandles.clear();
+}
+
+unsigned int EntityStore::GetCount()
+{
+	return (unsigned int)names.size();
+}
+
+/// <summary>
+/// Finds where an entity currently is in the arrays
+/// </summary>
+/// <param name="_handle">Handle to the entity</param>
+/// <returns>The entity's index, valid until an entity is destroyed</returns>
+unsigned int EntityStore::GetIndex(unsigned int _handle)
+{
+	return indexOfHandle[_handle];
+}
+
+unsigned int EntityStore::GetHandle(unsigned int _index)
+{
+	return handleOfIndex[_index];
+}
+
+TransformSystem& EntityStore::GetTransformSystem()
+{
+	return *transformSystem;
+}
+
+const char* EntityStore::GetName(unsigned int _index)
+{
+	return names[_index];
+}
+
+Mesh* EntityStore::GetMesh(unsigned int _index)
+{
+	return meshes[_index].get();
+}
+
+Material* EntityStore::GetMaterial(unsigned int _index)
+{
+	return materials[_index].get();
+}
+
+unsigned int EntityStore::GetMeshID(unsigned int _index)
+{
+	return meshIDs[_index];
+}
+
+unsigned int EntityStore::GetMaterialID(unsigned int _index)
+{
+	return materialIDs[_index];
+}
+
+const std::shared_ptr<Transform>& EntityStore::GetTransform(unsigned int _index)
+{
+	return transforms[_index];
+}
+
+bool EntityStore::IsStatic(unsigned int _index)
+{
+	return statics[_index] != 0;
+}
+
+float EntityStore::GetSpinSpeed(unsigned int _index)
+{
+	return spinSpeeds[_index];
+}
+
+const DirectX::XMFLOAT4X4& EntityStore::GetWorld(unsigned int _index)
+{
+	return transformSystem->GetWorld(transformIDs[_index]);
+}
+
+const DirectX::XMFLOAT4X4& EntityStore::GetWorldInverseTranspose(unsigned int _index)
+{
+	return transformSystem->GetWorldInverseTranspose(transformIDs[_index]);
+}
+
+unsigned long long EntityStore::GetVersion(unsigned int _index)
+{
+	return transformSystem->GetVersion(transformIDs[_index]);
+}
+
+/// <summary>
+/// Gets the axis-aligned box around an entity's Mesh in world space
+/// </summary>
+/// <param name="_index">Index of the entity</param>
+/// <returns>The Mesh's local box transformed by the entity's world matrix, then re-fit to the world axes</returns>
+BoundingBox EntityStore::GetWorldBoxBounds(unsigned int _index)
+{
+	BoundingBox bounds;
+	meshes[_index]->GetBoxBounds().Transform(bounds, XMLoadFloat4x4(&GetWorld(_index)));
+	return bounds;
+}
+
+/// <summary>
+/// Gets the sphere around an entity's Mesh in world space
+/// </summary>
+/// <param name="_index">Index of the entity</param>
+/// <returns>The Mesh's local sphere transformed by the entity's world matrix, scaled by its largest axis</returns>
+BoundingSphere EntityStore::GetWorldSphereBounds(unsigned int _index)
+{
+	BoundingSphere bounds;
+	meshes[_index]->GetSphereBounds().Transform(bounds, XMLoadFloat4x4(&GetWorld(_index)));
+	return bounds;
+}
+
+void EntityStore::SetMaterial(unsigned int _index, std::shared_ptr<Material> _material)
+{
+	materials[_index] = _material;
+	materialIDs[_index] = _material->GetSortID();
+}
+
+/// <summary>
+/// Sets whether an entity is expected to never move. Static entities
+/// can still be moved, it'll just cost more to update their shadows
+/// </summary>
+/// <param name="_index">Index of the entity</param>
+/// <param name="_isStatic">Whether the entity is static</param>
+void EntityStore::SetStatic(unsigned int _index, bool _isStatic)
+{
+	statics[_index] = _isStatic ? 1 : 0;
+}
+
+/// <summary>
+/// Sets how fast an entity turns about the Y axis each second,
+/// as a multiple of the scene's rotation speed
+/// </summary>
+/// <param name="_index">Index of the entity</param>
+/// <param name="_spinSpeed">Radians per second, or 0 to not spin</param>
+void EntityStore::SetSpinSpeed(unsigned int _index, float _spinSpeed)
+{
+	spinSpeeds[_index] = _spinSpeed;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <DirectXCollision.h>
+
+#include "Transform.h"
+#include "Mesh.h"
+#include "Material.h"
+
+// Marks a handle to no entity
+#define ENTITY_NONE	0xFFFFFFFFu
+
+// --------------------------------------------------------
+// Stores every entity's components in dense arrays, one per
+// component, so going through the scene is a walk down a
+// few arrays rather than a chase through pointers to each
+// entity and then to each of its parts.
+//
+// Every entity has the same components (a name, mesh,
+// material, transform, whether it's static and how fast it
+// spins), so this is the one archetype the scene needs.
+//
+// Entities are looked up by index in loops. Destroying one
+// moves the last entity into its place, so indices can
+// change; handles stay the same until their entity is
+// destroyed, and map to wherever it currently is.
+// --------------------------------------------------------
+class EntityStore
+{
+public:
+	EntityStore();
+	EntityStore(TransformSystem& _transforms);
+	EntityStore(const EntityStore&) = delete; // Remove copy constructor
+	EntityStore& operator=(const EntityStore&) = delete; // Remove copy-assignment operator
+
+	// Adds an entity at XYZ (0, 0, 0), returning its handle
+	unsigned int Create(const char* _name, std::shared_ptr<Mesh> _mesh, std::shared_ptr<Material> _material);
+	void Destroy(unsigned int _handle);
+	void Clear();
+
+	unsigned int GetCount();
+	unsigned int GetIndex(unsigned int _handle);
+	unsigned int GetHandle(unsigned int _index);
+	TransformSystem& GetTransformSystem();
+
+	// Components, by index
+	const char* GetName(unsigned int _index);
+	Mesh* GetMesh(unsigned int _index);
+	Material* GetMaterial(unsigned int _index);
+	// Sort IDs of the entity's Mesh and Material, copied when they're set
+	unsigned int GetMeshID(unsigned int _index);
+	unsigned int GetMaterialID(unsigned int _index);
+	const std::shared_ptr<Transform>& GetTransform(unsigned int _index);
+	bool IsStatic(unsigned int _index);
+	float GetSpinSpeed(unsigned int _index);
+	// Straight from the TransformSystem, skipping the Transform
+	const DirectX::XMFLOAT4X4& GetWorld(unsigned int _index);
+	const DirectX::XMFLOAT4X4& GetWorldInverseTranspose(unsigned int _index);
+	unsigned long long GetVersion(unsigned int _index);
+	// World-space bounds of the entity's Mesh
+	DirectX::BoundingBox GetWorldBoxBounds(unsigned int _index);
+	DirectX::BoundingSphere GetWorldSphereBounds(unsigned int _index);
+
+	void SetMaterial(unsigned int _index, std::shared_ptr<Material> _material);
+	void SetStatic(unsigned int _index, bool _isStatic);
+	void SetSpinSpeed(unsigned int _index, float _spinSpeed);
+
+private:
+	TransformSystem* transformSystem;
+
+	// COMPONENTS
+	// Indexed by entity, with no gaps
+	std::vector<const char*> names;
+	std::vector<std::shared_ptr<Mesh>> meshes;
+	std::vector<std::shared_ptr<Material>> materials;
+	// Each Mesh's and Material's sort ID, so sorting and batching
+	// don't have to go through the pointers above
+	std::vector<unsigned int> meshIDs;
+	std::vector<unsigned int> materialIDs;
+	std::vector<std::shared_ptr<Transform>> transforms;
+	// Each Transform's ID in the TransformSystem, so matrices
+	// can be read without going through the Transform
+	std::vector<unsigned int> transformIDs;
+	// Whether the entity is expected to never move, so it can
+	// share a shadow map that's rarely redrawn
+	std::vector<uint8_t> statics;
+	// Radians per second the entity turns about Y, times the scene's rotation speed
+	std::vector<float> spinSpeeds;
+
+	// HANDLES
+	std::vector<unsigned int> handleOfIndex;
+	std::vector<unsigned int> indexOfHandle;
+	std::vector<unsigned int> freeHandles;
+};
@@ -0,0 +1,74 @@
+#include "FrameArena.h"
+
+/// <summary>
+/// Creates an arena with one block of the given size
+/// </summary>
+/// <param name="_capacity">Bytes the main block starts with room for</param>
+FrameArena::FrameArena(size_t _capacity) :
+	block(new unsigned char[_capacity]),
+	capacity(_capacity),
+	used(0),
+	overflowUsed(0)
+{
+}
+
+FrameArena::~FrameArena()
+{
+	Reset();
+	delete[] block;
+}
+
+/// <summary>
+/// Finds room for some bytes after everything allocated so far
+/// </summary>
+/// <param name="_size">Bytes to allocate</param>
+/// <param name="_alignment">What the address must be a multiple of, up to alignof(max_align_t)</param>
+/// <returns>Where the bytes start</returns>
+void* FrameArena::Allocate(size_t _size, size_t _alignment)
+{
+	size_t offset = (used + _alignment - 1) / _alignment * _alignment;
+	if (offset + _size <= capacity) {
+		used = offset + _size;
+		return block + offset;
+	}
+
+	// Out of room, so fall back to the heap until the next Reset()
+	// (new[] memory suits any alignment up to max_align_t)
+	unsigned char* overflow = new unsigned char[_size > 0 ? _size : 1];
+	overflowBlocks.push_back(overflow);
+	overflowUsed += _size;
+	return overflow;
+}
+
+/// <summary>
+/// Frees everything allocated since the last reset, growing the
+/// main block if it couldn't fit all of it
+/// </summary>
+void FrameArena::Reset()
+{
+	if (!overflowBlocks.empty()) {
+		for (unsigned char* overflow : overflowBlocks) {
+			delete[] overflow;
+		}
+		overflowBlocks.clear();
+
+		// Leave some room to spare, so slowly growing
+		// frames don't need a new block every time
+		size_t needed = used + overflowUsed;
+		capacity = needed + needed / 2;
+		delete[] block;
+		block = new unsigned char[capacity];
+	}
+	used = 0;
+	overflowUsed = 0;
+}
+
+size_t FrameArena::GetUsed()
+{
+	return used + overflowUsed;
+}
+
+size_t FrameArena::GetCapacity()
+{
+	return capacity;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// --------------------------------------------------------
+// Hands out memory for things that only live for one frame
+// by bumping a pointer through one block, then takes it all
+// back at once with Reset(), so building them never touches
+// the heap.
+//
+// Allocations that don't fit go in extra blocks until the
+// next Reset(), which grows the main block to fit everything
+// the frame needed, so later frames stay in one block.
+// Nothing allocated is constructed or destroyed, so it's
+// only for plain data.
+// --------------------------------------------------------
+class FrameArena
+{
+public:
+	FrameArena(size_t _capacity = 64 * 1024);
+	~FrameArena();
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// Room for _count uninitialized T's, valid until the next Reset()
+	template <typename T> T* Allocate(size_t _count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "FrameArena never destroys what it holds");
+		return static_cast<T*>(Allocate(sizeof(T) * _count, alignof(T)));
+	}
+	void* Allocate(size_t _size, size_t _alignment);
+
+	// Frees everything allocated since the last Reset()
+	void Reset();
+
+	// Bytes allocated since the last Reset()
+	size_t GetUsed();
+	// Bytes the main block has room for
+	size_t GetCapacity();
+
+private:
+	unsigned char* block;
+	size_t capacity;
+	size_t used;
+
+	// Blocks allocated when the main one ran out, and their total size
+	std::vector<unsigned char*> overflowBlocks;
+	size_t overflowUsed;
+};
@@ -1,12 +1,20 @@
 #include "Game.h"
 #include "Graphics.h"
 #include "Vertex.h"
+#include "VertexPacking.h"
 #include "Input.h"
 #include "PathHelpers.h"
 #include "Window.h"
 #include "WICTextureLoader.h"
+#include "WorkerPool.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <climits>
+#include <cstddef>
 #include <cmath>
+#include <cstring>
 
 // Needed for a helper function to load pre-compiled shader files
 #pragma comment(lib, "d3dcompiler.lib")
@@ -22,6 +30,9 @@
 using namespace std;
 using namespace DirectX;
 
+// Scene sizes RunEntityBenchmark() tries
+static const unsigned int entityBenchmarkSizes[ENTITY_BENCHMARK_SIZES] = { 12, 100, 1000, 10000, 100000, 1000000 };
+
 // --------------------------------------------------------
 // Called once per program, after the window and graphics API
 // are initialized but before the game loop begins
@@ -32,6 +43,18 @@ void Game::Initialize()
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
 	InitializeSimulationParameters();
+	// Route every shader's binds through the state cache
+	stateCache = make_shared<StateCache>(Graphics::Context);
+	ISimpleShader::BindCache = stateCache.get();
+	// Write per-draw constants and instance data into rings, if
+	// the driver can bind constant buffers by offset
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	Graphics::Device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+	if (options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer) {
+		constantRing = make_shared<RingBuffer>(Graphics::Device, Graphics::Context, 1024 * 1024, D3D11_BIND_CONSTANT_BUFFER);
+		ISimpleShader::ConstantRing = constantRing.get();
+	}
+	instanceRing = make_shared<RingBuffer>(Graphics::Device, Graphics::Context, 4 * 1024 * 1024, D3D11_BIND_VERTEX_BUFFER);
 	LoadShaders();
 	CreateLights();
 	CreateMaterials();
@@ -80,6 +103,10 @@ Game::~Game()
 
 	// Cleanup other variables from helper methods
 	CleanupSimulationParameters();
+
+	// Shaders outliving the game shouldn't use its state cache or ring
+	ISimpleShader::BindCache = nullptr;
+	ISimpleShader::ConstantRing = nullptr;
 }
 
 
@@ -104,7 +131,48 @@ void Game::LoadShaders()
 	AddVertexShader(L"VS_DiffuseNormal.cso",	vsDiffuseNormal);
 	AddVertexShader(L"VS_PBR.cso",				vsPBR);
 	AddVertexShader(L"VS_Skybox.cso",			vsSkybox);
-	AddVertexShader(L"VS_ShadowMap.cso",		vsShadowMap);
+	AddVertexShader(L"VS_ShadowMap.cso",		vsShadowMaps[0][0]);
+
+	// Versions of the above for meshes with packed vertices
+	// - Reflection would give every input a 32-bit float format,
+	//   so the layout matching PackedVertex is given explicitly
+	D3D11_INPUT_ELEMENT_DESC packedVertexElements[] = {
+		{ "POSITION",	0, DXGI_FORMAT_R16G16B16A16_SNORM,	0, offsetof(PackedVertex, Position),		D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL",		0, DXGI_FORMAT_R16G16B16A16_SNORM,	0, offsetof(PackedVertex, NormalTangent),	D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD",	0, DXGI_FORMAT_R16G16_FLOAT,		0, offsetof(PackedVertex, UV),				D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+	AddVertexShader(L"VS_PBR_Packed.cso",		vsPBRPacked,		packedVertexElements, (unsigned int)size(packedVertexElements));
+	AddVertexShader(L"VS_ShadowMap_Packed.cso",	vsShadowMaps[1][0],	packedVertexElements, (unsigned int)size(packedVertexElements));
+
+	// Versions of the above for instanced draws
+	// - Reflection finds the "_PER_INSTANCE" inputs itself, but the
+	//   packed shaders' layouts need them added explicitly
+	D3D11_INPUT_ELEMENT_DESC packedInstancedElements[] = {
+		packedVertexElements[0],
+		packedVertexElements[1],
+		packedVertexElements[2],
+		{ "WORLD_PER_INSTANCE",		0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(InstanceData, World),						D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD_PER_INSTANCE",		1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(InstanceData, World) + 16,					D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD_PER_INSTANCE",		2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(InstanceData, World) + 32,					D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD_PER_INSTANCE",		3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(InstanceData, World) + 48,					D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD_IT_PER_INSTANCE",	0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(InstanceData, WorldInverseTranspose),		D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD_IT_PER_INSTANCE",	1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(InstanceData, WorldInverseTranspose) + 16,	D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD_IT_PER_INSTANCE",	2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(InstanceData, WorldInverseTranspose) + 32,	D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD_IT_PER_INSTANCE",	3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(InstanceData, WorldInverseTranspose) + 48,	D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
+	AddVertexShader(L"VS_PBR_Instanced.cso",				vsPBRInstanced);
+	AddVertexShader(L"VS_ShadowMap_Instanced.cso",			vsShadowMaps[0][1]);
+	AddVertexShader(L"VS_PBR_Packed_Instanced.cso",			vsPBRPackedInstanced,	packedInstancedElements, (unsigned int)size(packedInstancedElements));
+	AddVertexShader(L"VS_ShadowMap_Packed_Instanced.cso",	vsShadowMaps[1][1],		packedInstancedElements, (unsigned int)size(packedInstancedElements));
+	FindShaderHandles(vsPBR).Instanced = &FindShaderHandles(vsPBRInstanced);
+	FindShaderHandles(vsPBRPacked).Instanced = &FindShaderHandles(vsPBRPackedInstanced);
+
+	// Look up the shadow shaders' variables once
+	for (int packed = 0; packed < 2; packed++) {
+		for (int instanced = 0; instanced < 2; instanced++) {
+			vsShadowMapHandles[packed][instanced] = FindShadowShaderHandles(vsShadowMaps[packed][instanced]);
+		}
+	}
 
 	// PIXEL SHADERS
 	AddPixelShader(L"PS_DiffuseSpecular.cso",	psDiffuseSpecular);
@@ -208,14 +276,57 @@ void Game::CreateMaterials()
 void Game::CreateGeometry()
 {
 	// Create meshes from OBJ models
+	// - Every file is decoded (loaded and processed on the CPU)
+	//   at the same time on the worker pool, then each mesh's
+	//   buffers are created in order on this thread
 	// MESHES 0-6
-	meshes.push_back(make_shared<Mesh>("M_Cube", FixPath(L"../../Assets/Models/cube.obj").c_str()));
-	meshes.push_back(make_shared<Mesh>("M_Cylinder", FixPath(L"../../Assets/Models/cylinder.obj").c_str()));
-	meshes.push_back(make_shared<Mesh>("M_Helix", FixPath(L"../../Assets/Models/helix.obj").c_str()));
-	meshes.push_back(make_shared<Mesh>("M_Quad-SingleSided", FixPath(L"../../Assets/Models/quad.obj").c_str()));
-	meshes.push_back(make_shared<Mesh>("M_Quad-DoubleSided", FixPath(L"../../Assets/Models/quad_double_sided.obj").c_str()));
-	meshes.push_back(make_shared<Mesh>("M_Sphere", FixPath(L"../../Assets/Models/sphere.obj").c_str()));
-	meshes.push_back(make_shared<Mesh>("M_Torus", FixPath(L"../../Assets/Models/torus.obj").c_str()));
+	const char* meshNames[] = {
+		"M_Cube",
+		"M_Cylinder",
+		"M_Helix",
+		"M_Quad-SingleSided",
+		"M_Quad-DoubleSided",
+		"M_Sphere",
+		"M_Torus",
+	};
+	// Whether to store each mesh's vertices in the smaller PackedVertex
+	// format. The cube is shared with the skybox, whose shader only
+	// reads full-size vertices, so it stays unpacked
+	bool meshPacked[] = {
+		false,
+		true,
+		true,
+		true,
+		true,
+		true,
+		true,
+	};
+	wstring meshPaths[] = {
+		FixPath(L"../../Assets/Models/cube.obj"),
+		FixPath(L"../../Assets/Models/cylinder.obj"),
+		FixPath(L"../../Assets/Models/helix.obj"),
+		FixPath(L"../../Assets/Models/quad.obj"),
+		FixPath(L"../../Assets/Models/quad_double_sided.obj"),
+		FixPath(L"../../Assets/Models/sphere.obj"),
+		FixPath(L"../../Assets/Models/torus.obj"),
+	};
+	const size_t meshCount = size(meshPaths);
+
+	auto meshLoadStartTime = chrono::steady_clock::now();
+
+	vector<MeshData> meshData(meshCount);
+	WorkerPool::Global().ParallelFor(meshCount, [&](size_t i) {
+		Mesh::Decode(meshPaths[i].c_str(), meshData[i],
+			MESH_OPTIMIZE_VERTEX_CACHE | (meshPacked[i] ? MESH_OPTIMIZE_PACK_VERTICES : MESH_OPTIMIZE_NONE));
+	});
+
+	for (size_t i = 0; i < meshCount; i++) {
+		meshes.push_back(make_shared<Mesh>(meshNames[i], meshData[i]));
+		meshes.back()->SetSortID((unsigned int)i);
+	}
+
+	meshLoadSeconds = chrono::duration<double>(chrono::steady_clock::now() - meshLoadStartTime).count();
+	meshSourcePaths.assign(begin(meshPaths), end(meshPaths));
 
 	// ENTITIES 0-6
 	AddEntity("E_ObjectBronze",			0, 3, XMFLOAT3(-9.0f,  0.0f, 0.0f));
@@ -225,19 +336,35 @@ void Game::CreateGeometry()
 	AddEntity("E_ObjectRough",			4, 7, XMFLOAT3( 3.0f, -1.0f, 0.0f));
 	AddEntity("E_ObjectScratched",		5, 8, XMFLOAT3( 6.0f,  0.0f, 0.0f));
 	AddEntity("E_ObjectWood",			6, 9, XMFLOAT3( 9.0f,  0.0f, 0.0f));
+	// They spin every frame, so compose their rotations
+	// instead of adding to angles and rebuilding them
+	for (unsigned int i = 0; i <= 6; i++) {
+		entities.SetSpinSpeed(i, 1.0f);
+		entities.GetTransform(i)->SetQuaternionRotation(true);
+	}
 
 	// ENTITY 7-9
 	AddEntity("E_Floor",				0, 9, XMFLOAT3( 0.0f, -2.0f, 0.0f));
-	entities[7]->GetTransform()->Scale(XMFLOAT3(50.0f, 0.125f, 50.0f));
+	entities.GetTransform(7)->Scale(XMFLOAT3(50.0f, 0.125f, 50.0f));
 	AddEntity("E_Wall1",				0, 6, XMFLOAT3( -12.0f, 1.0f, 0.0f));
-	entities[8]->GetTransform()->Scale(XMFLOAT3(0.125f, 3.0f, 5.0f));
+	entities.GetTransform(8)->Scale(XMFLOAT3(0.125f, 3.0f, 5.0f));
 	AddEntity("E_Wall2",				0, 6, XMFLOAT3( 0.0f, 1.0f, 5.0f));
-	entities[9]->GetTransform()->Scale(XMFLOAT3(12.0f, 3.0f, 0.125f));
+	entities.GetTransform(9)->Scale(XMFLOAT3(12.0f, 3.0f, 0.125f));
+	// The floor and walls never move
+	for (unsigned int i = 7; i <= 9; i++) {
+		entities.SetStatic(i, true);
+	}
 
 	// ENTITIES 10-11
-	AddEntity("E_BouncerSpring",		2, 7, XMFLOAT3( 0.0f, -1.0f, 3.0f));
-	AddEntity("E_BouncerCylinder",		1, 3, XMFLOAT3( 0.0f, 0.0f, 3.0f));
-	entities[11]->GetTransform()->Scale(XMFLOAT3(1.2f, 1.0f, 1.2f));
+	// Positioned relative to the bouncer, which moves them both
+	bouncerTransform = make_shared<Transform>();
+	bouncerTransform->SetPosition(0.0f, 0.0f, 3.0f);
+	bouncerSpringEntity = AddEntity("E_BouncerSpring",	2, 7, XMFLOAT3( 0.0f, 0.0f, 0.0f));
+	AddEntity("E_BouncerCylinder",		1, 3, XMFLOAT3( 0.0f, 2.0f, 0.0f));
+	entities.GetTransform(11)->Scale(XMFLOAT3(1.2f, 1.0f, 1.2f));
+	for (unsigned int i = 10; i <= 11; i++) {
+		entities.GetTransform(i)->SetParent(bouncerTransform);
+	}
 }
 
 // --------------------------------------------------------
@@ -311,22 +438,21 @@ void Game::Update(float deltaTime, float totalTime)
 	// Update current camera
 	cameras[pCameraCurrent]->Update(deltaTime);
 
-	// Rotate meshes
-	for (int i = 0; i <= 6; i++) {
-		entities[i]->GetTransform()->Rotate(0.0f, deltaTime * pObjectRotationSpeed, 0.0f);
+	// Rotate meshes that spin
+	float spin = deltaTime * pObjectRotationSpeed;
+	for (unsigned int i = 0; i < entities.GetCount(); i++) {
+		if (entities.GetSpinSpeed(i) != 0.0f) {
+			entities.GetTransform(i)->Rotate(0.0f, spin * entities.GetSpinSpeed(i), 0.0f);
+		}
 	}
 
-	// Move bouncer
-	shared_ptr<Transform> bouncerSpringTransform = entities[10]->GetTransform();
-	bouncerSpringTransform->SetPosition(0.0f,
-		sin(totalTime * 4.0f) * 2.0f - sin((totalTime + 0.225f) * 8.0f) * 0.8f,
-		3.0f);
-	bouncerSpringTransform->SetScale(1.0f,
-		1.2f + sin((totalTime + 0.225f) * 8.0f) * 0.8f,
-		1.0f);
-	entities[11]->GetTransform()->SetPosition(0.0f,
-		sin(totalTime * 4.0f) * 2.0f + 2.0f,
-		3.0f);
+	// Move bouncer, which carries the cylinder with it, then squash
+	// and stretch the spring underneath
+	bouncerTransform->SetPosition(0.0f, sin(totalTime * 4.0f) * 2.0f, 3.0f);
+	float springStretch = sin((totalTime + 0.225f) * 8.0f) * 0.8f;
+	const shared_ptr<Transform>& bouncerSpringTransform = entities.GetTransform(entities.GetIndex(bouncerSpringEntity));
+	bouncerSpringTransform->SetPosition(0.0f, -springStretch, 0.0f);
+	bouncerSpringTransform->SetScale(1.0f, 1.2f + springStretch, 1.0f);
 
 	ImGuiUpdate(deltaTime);
 	ImGuiBuild();
@@ -349,44 +475,193 @@ void Game::Draw(float deltaTime, float totalTime)
 		// Clear the back buffer (erase what's on screen) and depth buffer
 		Graphics::Context->ClearRenderTargetView(Graphics::BackBufferRTV.Get(),	pBackgroundColor);
 		Graphics::Context->ClearDepthStencilView(Graphics::DepthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+
+		// Start counting this frame's constant buffer uploads
+		ISimpleShader::UploadCount = 0;
+		ISimpleShader::SkippedUploadCount = 0;
+		ISimpleShader::UploadedBytes = 0;
+
+		// ImGui and the end of last frame changed bindings behind
+		// the state cache's back, so start it over
+		stateCache->Invalidate();
+		stateCache->ResetStats();
+
+		// Everything allocated for last frame is done with
+		frameArena.Reset();
+		if (constantRing) {
+			constantRing->ResetStats();
+		}
+		instanceRing->ResetStats();
+
+		drawCalls = 0;
+		shadowDrawCalls = 0;
+	}
+
+
+	// TRANSFORMS
+	// Rebuild the matrices of everything that moved since last
+	// frame in one batch, rather than one at a time as they're used
+	transformsRebuilt = TransformSystem::Global().UpdateMatrices();
+
+
+	// CULLING
+	// Find which entities are inside the current camera's view
+	unsigned int entityCount = entities.GetCount();
+	entityBounds.resize(entityCount);
+	entityVisible.resize(entityCount);
+	for (unsigned int i = 0; i < entityCount; i++) {
+		entityBounds[i] = entities.GetWorldBoxBounds(i);
 	}
+	if (pCullEntities) {
+		Frustum cameraFrustum = Culling::ExtractFrustum(cameras[pCameraCurrent]->GetViewMatrix(), cameras[pCameraCurrent]->GetProjectionMatrix());
+		cullingStats = Culling::TestBoxes(cameraFrustum, entityBounds.data(), entityBounds.size(), entityVisible.data());
+	}
+	else {
+		fill(entityVisible.begin(), entityVisible.end(), (uint8_t)1);
+		cullingStats = { entityCount, entityCount, 0 };
+	}
+
 
 
 	// RENDER SHADOW MAP
-	// Clear shadow map depth buffer
-	Graphics::Context->ClearDepthStencilView(shadowDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
-	// Set shadow map rasterizer state
-	Graphics::Context->RSSetState(shadowRasterizer.Get());
+	// Fit the cascades around the current camera's view
+	BuildShadowCascades();
+
+	// Find which entities moved since last frame. Entities entering or
+	// leaving a cascade must have moved (or the cascade did), so
+	// Transform versions cover those too
+	bool shadowLightChanged = shadowLightVersion != shadowDrawnLightVersion;
+	shadowDrawnLightVersion = shadowLightVersion;
+	shadowCasterVersions.resize(entityCount, ULLONG_MAX);
+	shadowCasterMoved.resize(entityCount);
+	for (unsigned int i = 0; i < entityCount; i++) {
+		unsigned long long version = entities.GetVersion(i);
+		shadowCasterMoved[i] = version != shadowCasterVersions[i];
+		shadowCasterVersions[i] = version;
+	}
 
-	// Set render target to nothing, depth buffer to shadow map
-	ID3D11RenderTargetView* nullRTV{};
-	Graphics::Context->OMSetRenderTargets(1, &nullRTV, shadowDSV.Get());
+	shadowCullingStats = {};
+	shadowCascadesRedrawn = 0;
+	shadowStaticCascadesRedrawn = 0;
+	for (unsigned int c = 0; c < shadowCascadeCount; c++) {
+		const ShadowCascade& cascade = shadowCascades[c];
+
+		// Find which entities are inside the volume the cascade covers. The
+		// volume is extended back toward the light, since entities the camera
+		// can't see, or that are closer to the light than the cascade's
+		// near plane, can still cast shadows into it
+		std::vector<uint8_t>& casterVisible = shadowCasterVisible[c];
+		shadowCasterWasVisible.assign(casterVisible.begin(), casterVisible.end());
+		shadowCasterWasVisible.resize(entityCount, 1);
+		casterVisible.resize(entityCount);
+		CullingStats cascadeStats;
+		if (pCullShadowCasters) {
+			Frustum cascadeFrustum = Culling::RemoveNearPlane(Culling::ExtractFrustum(cascade.View, cascade.Projection));
+			cascadeStats = Culling::TestBoxes(cascadeFrustum, entityBounds.data(), entityBounds.size(), casterVisible.data());
+		}
+		else {
+			fill(casterVisible.begin(), casterVisible.end(), (uint8_t)1);
+			cascadeStats = { entityCount, entityCount, 0 };
+		}
+		shadowCullingStats.Tested += cascadeStats.Tested;
+		shadowCullingStats.Visible += cascadeStats.Visible;
+		shadowCullingStats.Culled += cascadeStats.Culled;
+
+		// Work out whether anything the cascade shows has changed since it
+		// was last drawn: the cascade itself, or a caster that moved within,
+		// into or out of it
+		bool cascadeMoved = shadowLightChanged
+			|| memcmp(&cascade.View, &shadowDrawnCascades[c].View, sizeof(XMFLOAT4X4)) != 0
+			|| memcmp(&cascade.Projection, &shadowDrawnCascades[c].Projection, sizeof(XMFLOAT4X4)) != 0;
+		bool staticShadowsChanged = cascadeMoved;
+		bool dynamicShadowsChanged = cascadeMoved;
+		for (unsigned int i = 0; i < entityCount; i++) {
+			if (shadowCasterMoved[i] && (casterVisible[i] || shadowCasterWasVisible[i])) {
+				if (entities.IsStatic(i)) {
+					staticShadowsChanged = true;
+				}
+				else {
+					dynamicShadowsChanged = true;
+				}
+			}
+		}
 
-	// Change viewport
-	D3D11_VIEWPORT viewport = {};
-	viewport.Width		= (float)pShadowResolution;
-	viewport.Height		= (float)pShadowResolution;
-	viewport.MaxDepth	= 1.0f;
-	Graphics::Context->RSSetViewports(1, &viewport);
+		// Decide which maps need drawing
+		bool drawStaticShadows = false;
+		bool drawShadows = false;
+		int shadowCasters = SHADOW_CASTERS_ALL;
+		switch (pShadowCacheMode) {
+		case SHADOW_CACHE_OFF:
+			drawShadows = true;
+			break;
+		case SHADOW_CACHE_FULL:
+			drawShadows = staticShadowsChanged || dynamicShadowsChanged;
+			break;
+		case SHADOW_CACHE_SPLIT:
+			drawStaticShadows = staticShadowsChanged;
+			drawShadows = staticShadowsChanged || dynamicShadowsChanged;
+			shadowCasters = SHADOW_CASTERS_DYNAMIC;
+			break;
+		}
+		if (!drawShadows) {
+			continue;
+		}
+		shadowDrawnCascades[c] = cascade;
+		shadowCascadesRedrawn++;
+		shadowStaticCascadesRedrawn += drawStaticShadows ? 1 : 0;
+
+		// Set shadow map rasterizer state
+		Graphics::Context->RSSetState(shadowRasterizer.Get());
+
+		// Change viewport
+		D3D11_VIEWPORT viewport = {};
+		viewport.Width		= (float)pShadowResolution;
+		viewport.Height		= (float)pShadowResolution;
+		viewport.MaxDepth	= 1.0f;
+		Graphics::Context->RSSetViewports(1, &viewport);
+
+		// Set shaders
+		stateCache->SetPixelShader(0);
+		for (int packed = 0; packed < 2; packed++) {
+			for (int instanced = 0; instanced < 2; instanced++) {
+				const ShadowShaderHandles& handles = vsShadowMapHandles[packed][instanced];
+				vsShadowMaps[packed][instanced]->SetMatrix4x4(handles.View, cascade.View);
+				vsShadowMaps[packed][instanced]->SetMatrix4x4(handles.Projection, cascade.Projection);
+			}
+		}
 
-	// Set shaders
-	Graphics::Context->PSSetShader(0, 0, 0);
-	vsShadowMap->SetShader();
-	vsShadowMap->SetMatrix4x4("view", shadowLightViewMatrix);
-	vsShadowMap->SetMatrix4x4("projection", shadowLightProjectionMatrix);
+		// Set render target to nothing, depth buffer to a shadow map
+		ID3D11RenderTargetView* nullRTV{};
 
-	// Draw all entities
-	for (int i = 0; i < entities.size(); i++) {
-		vsShadowMap->SetMatrix4x4("world", entities[i]->GetTransform()->GetWorld());
-		vsShadowMap->CopyAllBufferData();
+		if (drawStaticShadows) {
+			Graphics::Context->ClearDepthStencilView(staticShadowDSVs[c].Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+			Graphics::Context->OMSetRenderTargets(1, &nullRTV, staticShadowDSVs[c].Get());
+			DrawShadowCasters(c, SHADOW_CASTERS_STATIC);
+		}
 
-		// Draw the entity's mesh
-		entities[i]->GetMesh()->Draw();
+		// Start from the static casters' depths if they're kept
+		// separately, otherwise start from nothing
+		if (pShadowCacheMode == SHADOW_CACHE_SPLIT) {
+			// Unbind the slice first, since it can't be copied into while bound
+			Graphics::Context->OMSetRenderTargets(1, &nullRTV, 0);
+			UINT slice = D3D11CalcSubresource(0, c, 1);
+			Graphics::Context->CopySubresourceRegion(shadowTexture.Get(), slice, 0, 0, 0, staticShadowTexture.Get(), slice, 0);
+		}
+		else {
+			Graphics::Context->ClearDepthStencilView(shadowDSVs[c].Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+		}
+		Graphics::Context->OMSetRenderTargets(1, &nullRTV, shadowDSVs[c].Get());
+		DrawShadowCasters(c, shadowCasters);
 	}
+	// Binding the shadow maps as depth targets unbinds them as SRVs
+	stateCache->InvalidateShaderResources();
+	shadowFramesReused = shadowCascadesRedrawn > 0 ? 0 : shadowFramesReused + 1;
 
-	// Reset viewport, render target, depth buffer, and rasterizer state for normal rendering
+	// Reset viewport for normal rendering
+	D3D11_VIEWPORT viewport = {};
 	viewport.Width = (float)Window::Width();
 	viewport.Height = (float)Window::Height();
+	viewport.MaxDepth = 1.0f;
 	Graphics::Context->RSSetViewports(1, &viewport);
 
 
@@ -433,63 +708,148 @@ void Game::Draw(float deltaTime, float totalTime)
 
 
 	// RENDER OBJECTS
-	// Loop through every entity and draw it
-	for (int i = 0; i < entities.size(); i++) {
+	// Data that's the same for every entity goes in each shader's PerFrame
+	// buffer, set here once. A shader only uploads a buffer when its data
+	// has changed, so each one is uploaded at most once this frame
+	XMFLOAT4X4 cameraView = cameras[pCameraCurrent]->GetViewMatrix();
+	XMFLOAT4X4 cameraProjection = cameras[pCameraCurrent]->GetProjectionMatrix();
+	XMFLOAT3 cameraPosition = cameras[pCameraCurrent]->GetTransform()->GetPosition();
+	for (auto& [shader, handles] : entityVertexShaderHandles) {
+		shader->SetMatrix4x4(handles.View, cameraView);
+		shader->SetMatrix4x4(handles.Projection, cameraProjection);
+	}
+	for (auto& [shader, handles] : entityPixelShaderHandles) {
+		shader->SetFloat3(handles.CameraPosition, cameraPosition);
+		shader->SetData(handles.Lights, &lights[0], sizeof(Light) * (int)lights.size());
+		shader->SetFloat3(handles.LightAmbient, skyboxAmbientColors[pSkyboxCurrent]);
+		shader->SetData(handles.ShadowCascadeMatrices, shadowCascadeViewProjections, sizeof(shadowCascadeViewProjections));
+		shader->SetFloat4(handles.ShadowCascadeSplits, shadowCascadeSplits);
+		shader->SetInt(handles.ShadowCascadeCount, (int)shadowCascadeCount);
+		shader->SetFloat(handles.TotalTime, totalTime);
+	}
 
-		// Get entity material
-		std::shared_ptr<Material> material = entities[i]->GetMaterial();
+	// Queue every entity the camera can see, keyed by the state it
+	// needs and how far away it is, then sort them so entities sharing
+	// shaders, materials and meshes are drawn together
+	XMMATRIX viewMatrix = XMLoadFloat4x4(&cameraView);
+	float cameraNear = cameras[pCameraCurrent]->GetNearClip();
+	float cameraFar = cameras[pCameraCurrent]->GetFarClip();
+	renderQueue.Clear();
+	for (unsigned int i = 0; i < entityCount; i++) {
+		if (!entityVisible[i]) {
+			continue;
+		}
+
+		unsigned int materialID = entities.GetMaterialID(i);
+		float depth = XMVectorGetZ(XMVector3TransformCoord(XMLoadFloat3(&entityBounds[i].Center), viewMatrix));
+		uint64_t key = RenderQueue::MakeKey(
+			RENDER_PASS_OPAQUE,
+			GetDrawVertexShaderHandles(materialID, entities.GetMesh(i))->SortID,
+			materialDrawHandles[materialID].PS->SortID,
+			materialID,
+			entities.GetMeshID(i),
+			(depth - cameraNear) / (cameraFar - cameraNear),
+			pRenderSortMode);
+		renderQueue.Add(key, i);
+	}
+	if (pRenderSortMode != RENDER_SORT_NONE) {
+		renderQueue.Sort();
+	}
+
+	// Group the sorted entities into runs sharing a mesh and material,
+	// and copy the instances of runs that can be instanced to the GPU
+	const std::vector<DrawPacket>& packets = renderQueue.GetPackets();
+	BuildDrawBatches(packets, false);
+
+	// Handles for the shaders the last entity was drawn with
+	const EntityVertexShaderHandles* lastVSHandles = nullptr;
+	const EntityPixelShaderHandles* lastPSHandles = nullptr;
+	// Material the last entity was drawn with
+	const Material* lastMaterial = nullptr;
+	drawShaderChanges = 0;
+	drawMaterialChanges = 0;
+
+	// Draw every batch in order
+	for (unsigned int b = 0; b < drawBatchCount; b++) {
+		const DrawBatch& batch = drawBatches[b];
+
+		// Get the batch's material, shared by all its entities
+		unsigned int first = packets[batch.FirstPacket].EntityIndex;
+		Material* material = entities.GetMaterial(first);
 		// Prepare the material for drawing
 		material->PrepareMaterial();
 
-		// Get entity's shaders
-		std::shared_ptr<SimpleVertexShader> vs = material->GetVertexShader();
-		std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
+		// Get the batch's shaders, reading world matrices from
+		// the instance buffer if the batch is instanced
+		Mesh* mesh = entities.GetMesh(first);
+		unsigned int materialID = entities.GetMaterialID(first);
+		const EntityVertexShaderHandles* vsHandles = GetDrawVertexShaderHandles(materialID, mesh);
+		if (batch.Instanced) {
+			vsHandles = vsHandles->Instanced;
+		}
+		const EntityPixelShaderHandles* psHandles = materialDrawHandles[materialID].PS;
+		SimpleVertexShader* vs = vsHandles->Shader;
+		SimplePixelShader* ps = psHandles->Shader;
 
 		// Set vertex and pixel shaders
 		vs->SetShader();
 		ps->SetShader();
 
-		// Fill constant buffers with entity's data
-		// VERTEX
-		vs->SetMatrix4x4("tfWorld", entities[i]->GetTransform()->GetWorld());
-		vs->SetMatrix4x4("tfView", cameras[pCameraCurrent]->GetViewMatrix());
-		vs->SetMatrix4x4("tfProjection", cameras[pCameraCurrent]->GetProjectionMatrix());
-		vs->SetMatrix4x4("tfWorldIT", entities[i]->GetTransform()->GetWorldInverseTranspose());
-		vs->SetMatrix4x4("tfShadowView", shadowLightViewMatrix);
-		vs->SetMatrix4x4("tfShadowProjection", shadowLightProjectionMatrix);
-		// PIXEL
-		ps->SetFloat4("colorTint", material->GetColorTint());
-		ps->SetFloat("roughness", material->GetRoughness());
-		ps->SetFloat3("cameraPosition", cameras[pCameraCurrent]->GetTransform()->GetPosition());
-
-		ps->SetFloat2("uvPosition", material->GetUVPosition());
-		ps->SetFloat2("uvScale", material->GetUVScale());
-
-		// Set lights on pixel shader
-		ps->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
-		// MATERIAL-SPECIFIC PIXEL SHADER CONSTANT BUFFER INPUTS
-		if (material->GetName() == "Mat_Custom") {
-			ps->SetFloat("totalTime", totalTime);
-			ps->SetFloat2("imageCenter", pMatCustomImage);
-			ps->SetFloat2("zoomCenter", pMatCustomZoom);
-			ps->SetInt("maxIterations", pMatCustomIterations);
+		// Count the times the shaders changed since the last entity
+		if (vsHandles != lastVSHandles || psHandles != lastPSHandles) {
+			drawShaderChanges++;
+			lastVSHandles = vsHandles;
+			lastPSHandles = psHandles;
 		}
 
-		if (material->isPBR) {
-			// Only use metalness for PBR materials
-			ps->SetFloat("metalness", material->GetMetalness());
+		// Fill the PerMaterial buffer, only if the material's changed
+		// since the last entity (variables a material's shader doesn't
+		// have, like metalness on non-PBR shaders, are ignored)
+		if (material != lastMaterial) {
+			lastMaterial = material;
+			drawMaterialChanges++;
+			ps->SetFloat4(psHandles->ColorTint, material->GetColorTint());
+			ps->SetFloat(psHandles->Roughness, material->GetRoughness());
+			ps->SetFloat2(psHandles->UVPosition, material->GetUVPosition());
+			ps->SetFloat2(psHandles->UVScale, material->GetUVScale());
+			ps->SetFloat(psHandles->Metalness, material->GetMetalness());
+			// Only the custom material's shader has these
+			ps->SetFloat2(psHandles->ImageCenter, pMatCustomImage);
+			ps->SetFloat2(psHandles->ZoomCenter, pMatCustomZoom);
+			ps->SetInt(psHandles->MaxIterations, pMatCustomIterations);
 		}
-		else {
-			// Only use ambient light for non-PBR materials
-			ps->SetFloat3("lightAmbient", skyboxAmbientColors[pSkyboxCurrent]);
+
+		// The mesh's quantization is shared by the whole batch
+		if (mesh->IsPacked()) {
+			vs->SetFloat3(vsHandles->QuantizationScale, mesh->GetQuantization().Scale);
+			vs->SetFloat3(vsHandles->QuantizationOffset, mesh->GetQuantization().Offset);
+		}
+
+		// Draw every entity in the batch at once
+		if (batch.Instanced) {
+			vs->CopyAllBufferData();
+			ps->CopyAllBufferData();
+			mesh->DrawInstanced(batch.PacketCount, batch.StartInstance);
+			drawCalls++;
+			continue;
 		}
 
-		// COPY DATA TO CONSTANT BUFFERS
-		vs->CopyAllBufferData();
-		ps->CopyAllBufferData();
+		for (unsigned int p = batch.FirstPacket; p < batch.FirstPacket + batch.PacketCount; p++) {
+			unsigned int i = packets[p].EntityIndex;
+
+			// Fill the PerObject buffer with the entity's data
+			vs->SetMatrix4x4(vsHandles->World, entities.GetWorld(i));
+			vs->SetMatrix4x4(vsHandles->WorldInverseTranspose, entities.GetWorldInverseTranspose(i));
+
+			// COPY DATA TO CONSTANT BUFFERS
+			// Only buffers whose data changed are uploaded
+			vs->CopyAllBufferData();
+			ps->CopyAllBufferData();
 
-		// Draw the entity's mesh
-		entities[i]->GetMesh()->Draw();
+			// Draw the entity's mesh
+			mesh->Draw();
+			drawCalls++;
+		}
 	}
 
 	// Draw the selected skybox
@@ -558,6 +918,15 @@ void Game::Draw(float deltaTime, float totalTime)
 		Graphics::Context->Draw(3, 0);
 	}
 
+	// Keep this frame's constant buffer uploads for the UI
+	bufferUploads = ISimpleShader::UploadCount;
+	bufferUploadsSkipped = ISimpleShader::SkippedUploadCount;
+	bufferBytesUploaded = ISimpleShader::UploadedBytes;
+	bindStats = stateCache->GetStats();
+	constantRingStats = constantRing ? constantRing->GetStats() : RingBufferStats{};
+	instanceRingStats = instanceRing->GetStats();
+	frameArenaUsed = frameArena.GetUsed();
+
 
 	// RENDER IMGUI
 	ImGui::Render(); // Turns this frames UI into renderable triangles
@@ -628,6 +997,56 @@ void Game::InitializeSimulationParameters() {
 	pShadowAreaWidth = 30.0f;
 	pShadowAreaCenter = XMFLOAT3(0.0f, -5.0f, 0.0f);
 	pShadowLightDistance = 500.0f;
+	pShadowCascades = true;
+	pShadowCascadeCount = SHADOW_CASCADE_COUNT;
+	pShadowCascadeLambda = 0.75f;
+	pShadowCascadeDistance = 60.0f;
+	pShadowPreviewCascade = 0;
+	shadowCascadeCount = 0;
+	pShadowCacheMode = SHADOW_CACHE_SPLIT;
+	shadowLightVersion = 0;
+	shadowDrawnLightVersion = ULLONG_MAX;
+	shadowCascadesRedrawn = 0;
+	shadowStaticCascadesRedrawn = 0;
+	shadowFramesReused = 0;
+
+	pCullEntities = true;
+	cullingStats = {};
+	pCullShadowCasters = true;
+	shadowCullingStats = {};
+
+	bufferUploads = 0;
+	bufferUploadsSkipped = 0;
+	bufferBytesUploaded = 0;
+	bindStats = {};
+
+	pRenderSortMode = RENDER_SORT_STATE;
+	drawShaderChanges = 0;
+	drawMaterialChanges = 0;
+
+	drawBatches = nullptr;
+	drawBatchCount = 0;
+	constantRingStats = {};
+	instanceRingStats = {};
+	frameArenaUsed = 0;
+	drawCalls = 0;
+	shadowDrawCalls = 0;
+	pInstancing = true;
+	pPropCount = 0;
+
+	transformsRebuilt = 0;
+	transformBenchmarkBaselineMs = 0.0;
+	transformBenchmarkPerObjectMs = 0.0;
+	transformBenchmarkBatchedMs = 0.0;
+	transformBenchmarkITError = 0.0f;
+	transformITTestError = 0.0f;
+	transformITTestPassed = true;
+	pTransformBenchmarkCount = 100000;
+	pTransformBenchmarkHierarchy = false;
+	for (int i = 0; i < ENTITY_BENCHMARK_SIZES; i++) {
+		entityBenchmarkStoreMs[i] = 0.0;
+		entityBenchmarkPointerMs[i] = 0.0;
+	}
 
 	ppPixelSize = XMFLOAT2(1.0f / Window::Width(), 1.0f / Window::Height());
 	
@@ -657,6 +1076,393 @@ void Game::InitializeSimulationParameters() {
 	isInitialized = true;
 }
 
+// --------------------------------------------------------
+// Gets the handles of the vertex shader an entity with the
+// given material and mesh is drawn with, which depends on
+// whether the mesh is packed
+// --------------------------------------------------------
+const EntityVertexShaderHandles* Game::GetDrawVertexShaderHandles(unsigned int _materialID, Mesh* _mesh)
+{
+	return materialDrawHandles[_materialID].VS[_mesh->IsPacked()];
+}
+
+// --------------------------------------------------------
+// Draws entities that can cast shadows into the bound shadow
+// map, using the shadow shaders set up by Game::Draw()
+//
+// _cascade is the cascade the bound map belongs to, and
+// _casters is a SHADOW_CASTERS_* value choosing whether to
+// draw every caster or only static or dynamic ones
+// --------------------------------------------------------
+void Game::DrawShadowCasters(unsigned int _cascade, int _casters)
+{
+	// Sort the casters by mesh, since the material doesn't
+	// matter here, so casters sharing a mesh can be instanced
+	shadowQueue.Clear();
+	for (unsigned int i = 0; i < entities.GetCount(); i++) {
+		if (!shadowCasterVisible[_cascade][i]
+			|| (_casters == SHADOW_CASTERS_STATIC && !entities.IsStatic(i))
+			|| (_casters == SHADOW_CASTERS_DYNAMIC && entities.IsStatic(i))) {
+			continue;
+		}
+		uint64_t key = RenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, 0, 0, entities.GetMeshID(i), 0.0f, RENDER_SORT_STATE);
+		shadowQueue.Add(key, i);
+	}
+	shadowQueue.Sort();
+	const std::vector<DrawPacket>& packets = shadowQueue.GetPackets();
+	BuildDrawBatches(packets, true);
+
+	for (unsigned int b = 0; b < drawBatchCount; b++) {
+		const DrawBatch& batch = drawBatches[b];
+
+		// Packed meshes need the shader that unpacks them
+		Mesh* mesh = entities.GetMesh(packets[batch.FirstPacket].EntityIndex);
+		std::shared_ptr<SimpleVertexShader> vs = vsShadowMaps[mesh->IsPacked()][batch.Instanced];
+		const ShadowShaderHandles& handles = vsShadowMapHandles[mesh->IsPacked()][batch.Instanced];
+		vs->SetShader();
+
+		if (mesh->IsPacked()) {
+			vs->SetFloat3(handles.QuantizationScale, mesh->GetQuantization().Scale);
+			vs->SetFloat3(handles.QuantizationOffset, mesh->GetQuantization().Offset);
+		}
+
+		if (batch.Instanced) {
+			vs->CopyAllBufferData();
+			mesh->DrawInstanced(batch.PacketCount, batch.StartInstance);
+			shadowDrawCalls++;
+			continue;
+		}
+
+		for (unsigned int p = batch.FirstPacket; p < batch.FirstPacket + batch.PacketCount; p++) {
+			vs->SetMatrix4x4(handles.World, entities.GetWorld(packets[p].EntityIndex));
+			vs->CopyAllBufferData();
+
+			// Draw the entity's mesh
+			mesh->Draw();
+			shadowDrawCalls++;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Splits sorted packets into runs sharing a mesh (and a
+// material, unless _shadowPass is set, since shadows don't
+// use materials). Runs long enough to be worth instancing,
+// drawn with a shader that has an instanced version, get
+// their instances written to the instance ring, which is
+// then bound to input slot 1 where they start
+// --------------------------------------------------------
+void Game::BuildDrawBatches(const std::vector<DrawPacket>& _packets, bool _shadowPass)
+{
+	// There can't be more runs than packets, and the batches
+	// only need to last until they're drawn this frame
+	drawBatches = frameArena.Allocate<DrawBatch>(_packets.size());
+	drawBatchCount = 0;
+
+	unsigned int instanceCount = 0;
+	size_t first = 0;
+	while (first < _packets.size()) {
+		Mesh* mesh = entities.GetMesh(_packets[first].EntityIndex);
+		Material* material = entities.GetMaterial(_packets[first].EntityIndex);
+		unsigned int materialID = entities.GetMaterialID(_packets[first].EntityIndex);
+		size_t end = first + 1;
+		while (end < _packets.size()) {
+			unsigned int i = _packets[end].EntityIndex;
+			if (entities.GetMesh(i) != mesh
+				|| (!_shadowPass && entities.GetMaterial(i) != material)) {
+				break;
+			}
+			end++;
+		}
+
+		DrawBatch batch = { (unsigned int)first, (unsigned int)(end - first), false, 0 };
+		bool hasInstancedShader = _shadowPass
+			|| GetDrawVertexShaderHandles(materialID, mesh)->Instanced != nullptr;
+		if (pInstancing && batch.PacketCount >= INSTANCING_MIN_GROUP && hasInstancedShader) {
+			batch.Instanced = true;
+			batch.StartInstance = instanceCount;
+			instanceCount += batch.PacketCount;
+		}
+		drawBatches[drawBatchCount++] = batch;
+		first = end;
+	}
+
+	if (instanceCount == 0) {
+		return;
+	}
+
+	// Write every instanced batch's matrices straight into the ring
+	unsigned int offset = 0;
+	InstanceData* instances = (InstanceData*)instanceRing->Map(sizeof(InstanceData) * instanceCount, 16, offset);
+	if (!instances) {
+		// Fall back to drawing one at a time
+		for (unsigned int b = 0; b < drawBatchCount; b++) {
+			drawBatches[b].Instanced = false;
+		}
+		return;
+	}
+	for (unsigned int b = 0; b < drawBatchCount; b++) {
+		const DrawBatch& batch = drawBatches[b];
+		if (!batch.Instanced) {
+			continue;
+		}
+		for (unsigned int p = batch.FirstPacket; p < batch.FirstPacket + batch.PacketCount; p++) {
+			unsigned int i = _packets[p].EntityIndex;
+			InstanceData& instance = instances[batch.StartInstance + p - batch.FirstPacket];
+			instance.World = entities.GetWorld(i);
+			instance.WorldInverseTranspose = entities.GetWorldInverseTranspose(i);
+		}
+	}
+	instanceRing->Unmap();
+
+	UINT stride = sizeof(InstanceData);
+	ID3D11Buffer* buffer = instanceRing->GetBuffer();
+	Graphics::Context->IASetVertexBuffers(1, 1, &buffer, &stride, &offset);
+}
+
+// --------------------------------------------------------
+// Replaces the props with a square grid of _count copies
+// of a sphere, alternating between two materials, to
+// stress test drawing
+// --------------------------------------------------------
+void Game::SetPropCount(int _count)
+{
+	for (unsigned int handle : propEntities) {
+		entities.Destroy(handle);
+	}
+	propEntities.clear();
+
+	int gridWidth = (int)ceil(sqrt((double)_count));
+	for (int i = 0; i < _count; i++) {
+		float x = (i % gridWidth - (gridWidth - 1) * 0.5f) * 1.0f;
+		float z = 8.0f + (i / gridWidth) * 1.0f;
+		unsigned int index = entities.GetIndex(AddEntity("E_Prop", 5, (i % 2) ? 7 : 9, XMFLOAT3(x, -1.7f, z)));
+		entities.GetTransform(index)->SetScale(0.4f, 0.4f, 0.4f);
+		entities.SetStatic(index, true);
+		propEntities.push_back(entities.GetHandle(index));
+	}
+
+	// Props that were removed may still be in the cached shadow maps,
+	// and destroying them moved entities around in the store
+	shadowLightVersion++;
+}
+
+// --------------------------------------------------------
+// Times how long rebuilding the matrices of a large number
+// of moved transforms takes one at a time, as each one's
+// matrices are read, against rebuilding them all in one
+// TransformSystem::UpdateMatrices() batch. The transforms
+// are in their own system, so the scene isn't touched.
+// With the hierarchy option, they make one tree where each
+// has 4 children, and moving the root moves them all
+// --------------------------------------------------------
+void Game::RunTransformBenchmark()
+{
+	// What Transform used to be: its own heap allocation holding its
+	// components and both matrices, rebuilt when read after a change
+	struct PointerTransform {
+		XMFLOAT3 position;
+		XMFLOAT3 rotation;
+		XMFLOAT3 scale;
+		XMFLOAT4X4 world;
+		XMFLOAT4X4 worldInverseTranspose;
+		bool areMatricesDirty;
+		XMFLOAT4X4 GetWorld() {
+			if (areMatricesDirty) {
+				XMMATRIX newWorld =
+					XMMatrixScalingFromVector(XMLoadFloat3(&scale)) *
+					XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&rotation)) *
+					XMMatrixTranslationFromVector(XMLoadFloat3(&position));
+				XMStoreFloat4x4(&world, newWorld);
+				XMStoreFloat4x4(&worldInverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(newWorld)));
+				areMatricesDirty = false;
+			}
+			return world;
+		}
+	};
+
+	TransformSystem system;
+	vector<shared_ptr<Transform>> transforms;
+	transforms.reserve(pTransformBenchmarkCount);
+	for (int i = 0; i < pTransformBenchmarkCount; i++) {
+		shared_ptr<Transform> transform = make_shared<Transform>(system);
+		transform->SetPosition((float)(i % 100), (float)(i / 100 % 100), (float)(i / 10000));
+		transform->SetRotation(i * 0.1f, i * 0.2f, i * 0.3f);
+		transform->SetScale(1.0f + (i % 7) * 0.1f, 1.0f, 1.0f + (i % 3) * 0.1f);
+		if (pTransformBenchmarkHierarchy && i > 0) {
+			transform->SetParent(transforms[(i - 1) / 4]);
+		}
+		transforms.push_back(transform);
+	}
+	// Rotating the root of the tree is enough to move everything
+	size_t movedCount = pTransformBenchmarkHierarchy ? 1 : transforms.size();
+
+	// The same transforms in the old layout. It has no hierarchy, so
+	// every one of them is moved whether or not the others are parented
+	vector<shared_ptr<PointerTransform>> pointerTransforms;
+	pointerTransforms.reserve(pTransformBenchmarkCount);
+	for (int i = 0; i < pTransformBenchmarkCount; i++) {
+		shared_ptr<PointerTransform> transform = make_shared<PointerTransform>();
+		transform->position = XMFLOAT3((float)(i % 100), (float)(i / 100 % 100), (float)(i / 10000));
+		transform->rotation = XMFLOAT3(i * 0.1f, i * 0.2f, i * 0.3f);
+		transform->scale = XMFLOAT3(1.0f + (i % 7) * 0.1f, 1.0f, 1.0f + (i % 3) * 0.1f);
+		transform->areMatricesDirty = true;
+		pointerTransforms.push_back(transform);
+	}
+
+	// Best of a few runs each, moving every transform before each one
+	// (outside the timing) so all their matrices need rebuilding
+	const int runs = 5;
+	double baselineSeconds = DBL_MAX;
+	double perObjectSeconds = DBL_MAX;
+	double batchedSeconds = DBL_MAX;
+	volatile float sink = 0.0f;
+	for (int run = 0; run < runs; run++) {
+		for (shared_ptr<PointerTransform>& transform : pointerTransforms) {
+			transform->rotation.x += 0.01f;
+			transform->areMatricesDirty = true;
+		}
+		auto startTime = chrono::steady_clock::now();
+		for (shared_ptr<PointerTransform>& transform : pointerTransforms) {
+			sink = sink + transform->GetWorld()._41;
+		}
+		baselineSeconds = min(baselineSeconds, chrono::duration<double>(chrono::steady_clock::now() - startTime).count());
+
+		for (size_t i = 0; i < movedCount; i++) {
+			transforms[i]->Rotate(0.01f, 0.0f, 0.0f);
+		}
+		startTime = chrono::steady_clock::now();
+		for (shared_ptr<Transform>& transform : transforms) {
+			sink = sink + transform->GetWorld()._41;
+		}
+		perObjectSeconds = min(perObjectSeconds, chrono::duration<double>(chrono::steady_clock::now() - startTime).count());
+
+		for (size_t i = 0; i < movedCount; i++) {
+			transforms[i]->Rotate(0.01f, 0.0f, 0.0f);
+		}
+		startTime = chrono::steady_clock::now();
+		system.UpdateMatrices();
+		batchedSeconds = min(batchedSeconds, chrono::duration<double>(chrono::steady_clock::now() - startTime).count());
+	}
+
+	transformBenchmarkBaselineMs = baselineSeconds * 1000.0;
+	transformBenchmarkPerObjectMs = perObjectSeconds * 1000.0;
+	transformBenchmarkBatchedMs = batchedSeconds * 1000.0;
+
+	// Make sure building the inverse transposes without a general inverse is still accurate,
+	// both for these transforms and for the cases that take different paths through the rebuild
+	transformBenchmarkITError = system.MeasureInverseTransposeError();
+	transformITTestPassed = TransformSystem::TestInverseTransposes(transformITTestError);
+}
+
+// --------------------------------------------------------
+// Times a pass over scenes of each size in
+// entityBenchmarkSizes, doing what Update() and Draw() do per
+// entity, once with an EntityStore and once with each entity
+// on the heap behind a pointer, the way Entity used to be
+// --------------------------------------------------------
+void Game::RunEntityBenchmark()
+{
+	// Each entity holds pointers to its parts, and hands out copies of them
+	struct PointerEntity {
+		shared_ptr<Mesh> mesh;
+		shared_ptr<Material> material;
+		shared_ptr<Transform> transform;
+		bool isStatic;
+		float spinSpeed;
+		shared_ptr<Mesh> GetMesh() { return mesh; }
+		shared_ptr<Material> GetMaterial() { return material; }
+		shared_ptr<Transform> GetTransform() { return transform; }
+	};
+
+	for (int size = 0; size < ENTITY_BENCHMARK_SIZES; size++) {
+		unsigned int count = entityBenchmarkSizes[size];
+		TransformSystem system;
+		EntityStore store(system);
+		vector<shared_ptr<PointerEntity>> pointerEntities;
+		pointerEntities.reserve(count);
+		for (unsigned int i = 0; i < count; i++) {
+			unsigned int handle = store.Create("Benchmark", meshes[i % meshes.size()], materials[i % materials.size()]);
+			unsigned int index = store.GetIndex(handle);
+			store.GetTransform(index)->SetPosition((float)(i % 100), (float)(i / 100 % 100), (float)(i / 10000));
+			store.SetStatic(index, i % 2 == 0);
+			store.SetSpinSpeed(index, (i % 3) * 0.5f);
+
+			// Both share the same Transforms, so only getting to them differs
+			shared_ptr<PointerEntity> entity = make_shared<PointerEntity>();
+			entity->mesh = meshes[i % meshes.size()];
+			entity->material = materials[i % materials.size()];
+			entity->transform = store.GetTransform(index);
+			entity->isStatic = store.IsStatic(index);
+			entity->spinSpeed = store.GetSpinSpeed(index);
+			pointerEntities.push_back(entity);
+		}
+		system.UpdateMatrices();
+
+		// Best of a few runs each of: checking whether to spin,
+		// getting world bounds for culling, checking for static
+		// shadow casters, and making a sort key from the mesh and material
+		const int runs = 3;
+		double storeSeconds = DBL_MAX;
+		double pointerSeconds = DBL_MAX;
+		volatile float sink = 0.0f;
+		for (int run = 0; run < runs; run++) {
+			auto startTime = chrono::steady_clock::now();
+			float sum = 0.0f;
+			for (unsigned int i = 0; i < count; i++) {
+				if (store.GetSpinSpeed(i) != 0.0f) {
+					sum += 1.0f;
+				}
+				BoundingBox bounds = store.GetWorldBoxBounds(i);
+				if (store.IsStatic(i)) {
+					sum += (float)store.GetVersion(i);
+				}
+				unsigned int key = store.GetMeshID(i) ^ store.GetMaterialID(i);
+				sum += bounds.Center.x + (float)(key & 1);
+			}
+			sink = sink + sum;
+			storeSeconds = min(storeSeconds, chrono::duration<double>(chrono::steady_clock::now() - startTime).count());
+
+			startTime = chrono::steady_clock::now();
+			sum = 0.0f;
+			for (unsigned int i = 0; i < count; i++) {
+				shared_ptr<PointerEntity> entity = pointerEntities[i];
+				if (entity->spinSpeed != 0.0f) {
+					sum += 1.0f;
+				}
+				shared_ptr<Transform> transform = entity->GetTransform();
+				shared_ptr<Mesh> mesh = entity->GetMesh();
+				XMFLOAT4X4 world = transform->GetWorld();
+				BoundingBox bounds;
+				mesh->GetBoxBounds().Transform(bounds, XMLoadFloat4x4(&world));
+				if (entity->isStatic) {
+					sum += (float)transform->GetVersion();
+				}
+				size_t key = (size_t)mesh.get() ^ (size_t)entity->GetMaterial().get();
+				sum += bounds.Center.x + (float)(key & 1);
+			}
+			sink = sink + sum;
+			pointerSeconds = min(pointerSeconds, chrono::duration<double>(chrono::steady_clock::now() - startTime).count());
+		}
+
+		entityBenchmarkStoreMs[size] = storeSeconds * 1000.0;
+		entityBenchmarkPointerMs[size] = pointerSeconds * 1000.0;
+	}
+}
+
+// --------------------------------------------------------
+// Loads every mesh's source file again and compares its
+// tangents from CalculateTangents() with the original
+// scalar code's, so the results can be shown in the UI
+// --------------------------------------------------------
+void Game::CheckMeshTangents()
+{
+	meshTangentErrors.resize(meshSourcePaths.size());
+	WorkerPool::Global().ParallelFor(meshSourcePaths.size(), [&](size_t i) {
+		meshTangentErrors[i] = Mesh::MeasureTangentError(meshSourcePaths[i].c_str());
+	});
+}
+
 // --------------------------------------------------------
 // Adds a vertex shader to the list of vertex shaders
 // --------------------------------------------------------
@@ -667,6 +1473,23 @@ void Game::AddVertexShader(const wchar_t* _path, std::shared_ptr<SimpleVertexSha
 		Graphics::Context,
 		FixPath(_path).c_str()
 	);
+	FindShaderHandles(_shader);
+}
+
+// --------------------------------------------------------
+// Adds a vertex shader whose input layout is made from the
+// given elements instead of the shader's inputs
+// --------------------------------------------------------
+void Game::AddVertexShader(const wchar_t* _path, std::shared_ptr<SimpleVertexShader>& _shader, const D3D11_INPUT_ELEMENT_DESC* _inputElements, unsigned int _inputElementCount)
+{
+	_shader = make_shared<SimpleVertexShader>(
+		Graphics::Device,
+		Graphics::Context,
+		FixPath(_path).c_str(),
+		_inputElements,
+		_inputElementCount
+	);
+	FindShaderHandles(_shader);
 }
 
 // --------------------------------------------------------
@@ -679,6 +1502,101 @@ void Game::AddPixelShader(const wchar_t* _path, std::shared_ptr<SimplePixelShade
 		Graphics::Context,
 		FixPath(_path).c_str()
 	);
+	FindShaderHandles(_shader);
+}
+
+// --------------------------------------------------------
+// Looks up the handles of the variables Game::Draw() sets
+// on each entity's vertex shader, or returns the ones
+// already looked up
+// --------------------------------------------------------
+EntityVertexShaderHandles& Game::FindShaderHandles(std::shared_ptr<SimpleVertexShader> _shader)
+{
+	auto existing = entityVertexShaderHandles.find(_shader.get());
+	if (existing != entityVertexShaderHandles.end()) {
+		return existing->second;
+	}
+
+	EntityVertexShaderHandles& handles = entityVertexShaderHandles[_shader.get()];
+	handles.Shader					= _shader.get();
+	handles.SortID					= (unsigned int)entityVertexShaderHandles.size() - 1;
+	handles.World					= _shader->GetVariableHandle("tfWorld");
+	handles.View					= _shader->GetVariableHandle("tfView");
+	handles.Projection				= _shader->GetVariableHandle("tfProjection");
+	handles.WorldInverseTranspose	= _shader->GetVariableHandle("tfWorldIT");
+	handles.QuantizationScale		= _shader->GetVariableHandle("quantizationScale");
+	handles.QuantizationOffset		= _shader->GetVariableHandle("quantizationOffset");
+
+	// Every draw changes the PerObject buffer, so write it into the ring
+	_shader->SetBufferFromRing("PerObject");
+	return handles;
+}
+
+// --------------------------------------------------------
+// Looks up the handles of the variables Game::Draw() sets
+// on each entity's pixel shader, or returns the ones
+// already looked up
+// --------------------------------------------------------
+EntityPixelShaderHandles& Game::FindShaderHandles(std::shared_ptr<SimplePixelShader> _shader)
+{
+	auto existing = entityPixelShaderHandles.find(_shader.get());
+	if (existing != entityPixelShaderHandles.end()) {
+		return existing->second;
+	}
+
+	EntityPixelShaderHandles& handles = entityPixelShaderHandles[_shader.get()];
+	handles.Shader					= _shader.get();
+	handles.SortID					= (unsigned int)entityPixelShaderHandles.size() - 1;
+	handles.ColorTint				= _shader->GetVariableHandle("colorTint");
+	handles.Roughness				= _shader->GetVariableHandle("roughness");
+	handles.CameraPosition			= _shader->GetVariableHandle("cameraPosition");
+	handles.UVPosition				= _shader->GetVariableHandle("uvPosition");
+	handles.UVScale					= _shader->GetVariableHandle("uvScale");
+	handles.Lights					= _shader->GetVariableHandle("lights");
+	handles.Metalness				= _shader->GetVariableHandle("metalness");
+	handles.LightAmbient			= _shader->GetVariableHandle("lightAmbient");
+	handles.ShadowCascadeMatrices	= _shader->GetVariableHandle("shadowCascadeMatrices");
+	handles.ShadowCascadeSplits		= _shader->GetVariableHandle("shadowCascadeSplits");
+	handles.ShadowCascadeCount		= _shader->GetVariableHandle("shadowCascadeCount");
+	handles.TotalTime				= _shader->GetVariableHandle("totalTime");
+	handles.ImageCenter				= _shader->GetVariableHandle("imageCenter");
+	handles.ZoomCenter				= _shader->GetVariableHandle("zoomCenter");
+	handles.MaxIterations			= _shader->GetVariableHandle("maxIterations");
+	return handles;
+}
+
+// --------------------------------------------------------
+// Gives the last material added its sort ID, and finds the
+// handles of the shaders it's drawn with so Game::Draw()
+// can get them by that ID
+// --------------------------------------------------------
+void Game::FindMaterialDrawHandles()
+{
+	Material* material = materials.back().get();
+	material->SetSortID((unsigned int)materials.size() - 1);
+
+	// Packed meshes need the version of the material's shader
+	// that unpacks them (only PBR materials are used with packed meshes)
+	MaterialDrawHandles handles;
+	handles.VS[0] = &FindShaderHandles(material->GetVertexShader());
+	handles.VS[1] = material->GetVertexShader() == vsPBR ? &FindShaderHandles(vsPBRPacked) : handles.VS[0];
+	handles.PS = &FindShaderHandles(material->GetPixelShader());
+	materialDrawHandles.push_back(handles);
+}
+
+// --------------------------------------------------------
+// Looks up the handles of the variables
+// Game::DrawShadowCasters() sets on a shadow shader
+// --------------------------------------------------------
+ShadowShaderHandles Game::FindShadowShaderHandles(std::shared_ptr<SimpleVertexShader> _shader)
+{
+	ShadowShaderHandles handles;
+	handles.World				= _shader->GetVariableHandle("world");
+	handles.View				= _shader->GetVariableHandle("view");
+	handles.Projection			= _shader->GetVariableHandle("projection");
+	handles.QuantizationScale	= _shader->GetVariableHandle("quantizationScale");
+	handles.QuantizationOffset	= _shader->GetVariableHandle("quantizationOffset");
+	return handles;
 }
 
 // --------------------------------------------------------
@@ -732,6 +1650,7 @@ void Game::AddMaterial(const char* _name, std::shared_ptr<SimpleVertexShader> _v
 		_roughness,
 		_useGlobalEnvironmentMap
 	));
+	FindMaterialDrawHandles();
 }
 
 void Game::AddMaterial(const char* _name, std::shared_ptr<SimpleVertexShader> _vertexShader, std::shared_ptr<SimplePixelShader> _pixelShader, DirectX::XMFLOAT4 _colorTint, float _roughness)
@@ -769,6 +1688,7 @@ void Game::AddPBRMaterial(const char* _name, std::shared_ptr<SimpleVertexShader>
 		_roughness,
 		_metalness
 	));
+	FindMaterialDrawHandles();
 }
 
 void Game::AddPBRMaterial(const char* _name, std::shared_ptr<SimpleVertexShader> _vertexShader, std::shared_ptr<SimplePixelShader> _pixelShader, float _roughness, float _metalness)
@@ -777,18 +1697,18 @@ void Game::AddPBRMaterial(const char* _name, std::shared_ptr<SimpleVertexShader>
 }
 
 // --------------------------------------------------------
-// Adds an Entity to the list of Entities
+// Adds an entity to the entity store, returning its handle
 // --------------------------------------------------------
-void Game::AddEntity(const char* _name, unsigned int _meshIndex, unsigned int _materialIndex, DirectX::XMFLOAT3 _position)
+unsigned int Game::AddEntity(const char* _name, unsigned int _meshIndex, unsigned int _materialIndex, DirectX::XMFLOAT3 _position)
 {
-	shared_ptr<Entity> entity = make_shared<Entity>(
+	unsigned int handle = entities.Create(
 		_name,
 		meshes[_meshIndex],
 		materials[_materialIndex]
 	);
 
-	entity->GetTransform()->SetPosition(_position);
-	entities.push_back(entity);
+	entities.GetTransform(entities.GetIndex(handle))->SetPosition(_position);
+	return handle;
 }
 
 // --------------------------------------------------------
@@ -959,7 +1879,9 @@ void Game::BuildShadowMap() {
 	D3D11_RASTERIZER_DESC shadowRastDesc = {};
 	shadowRastDesc.FillMode = D3D11_FILL_SOLID;
 	shadowRastDesc.CullMode = D3D11_CULL_BACK;
-	shadowRastDesc.DepthClipEnable = true;
+	// Casters between the light and the near plane are kept by culling,
+	// so flatten them onto the near plane instead of clipping them
+	shadowRastDesc.DepthClipEnable = false;
 	shadowRastDesc.DepthBias = 1000; // Min. precision units, not world units!
 	shadowRastDesc.SlopeScaledDepthBias = 1.0f; // Bias more based on slope
 	Graphics::Device->CreateRasterizerState(&shadowRastDesc, &shadowRasterizer);
@@ -984,20 +1906,28 @@ void Game::BuildShadowMap() {
 }
 
 // --------------------------------------------------------
-// Rebuilds just the shadow map's DSV and SRV
+// Rebuilds just the shadow map's DSVs and SRVs, with one
+// array slice per cascade
 // Code written by Chris Cascioli
 // --------------------------------------------------------
 void Game::RebuildShadowMap()
 {
 	// Reset DSV and SRV pointers
-	shadowDSV.ReleaseAndGetAddressOf();
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+		shadowDSVs[i].ReleaseAndGetAddressOf();
+		staticShadowDSVs[i].ReleaseAndGetAddressOf();
+	}
 	shadowSRV.ReleaseAndGetAddressOf();
+	shadowPreviewSRV.ReleaseAndGetAddressOf();
+
+	// The new maps are empty, so they'll need to be drawn
+	shadowLightVersion++;
 
 	// Create the actual texture that will be the shadow map
 	D3D11_TEXTURE2D_DESC shadowTexDesc = {};
 	shadowTexDesc.Width = pShadowResolution;
 	shadowTexDesc.Height = pShadowResolution;
-	shadowTexDesc.ArraySize = 1;
+	shadowTexDesc.ArraySize = SHADOW_CASCADE_COUNT;
 	shadowTexDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 	shadowTexDesc.CPUAccessFlags = 0;
 	shadowTexDesc.Format = DXGI_FORMAT_R32_TYPELESS;
@@ -1006,30 +1936,60 @@ void Game::RebuildShadowMap()
 	shadowTexDesc.SampleDesc.Count = 1;
 	shadowTexDesc.SampleDesc.Quality = 0;
 	shadowTexDesc.Usage = D3D11_USAGE_DEFAULT;
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowTexture;
-	Graphics::Device->CreateTexture2D(&shadowTexDesc, 0, shadowTexture.GetAddressOf());
+	Graphics::Device->CreateTexture2D(&shadowTexDesc, 0, shadowTexture.ReleaseAndGetAddressOf());
+
+	// Create a matching texture for static casters, which
+	// is only ever drawn to and copied from
+	shadowTexDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	Graphics::Device->CreateTexture2D(&shadowTexDesc, 0, staticShadowTexture.ReleaseAndGetAddressOf());
 
-	// Create the depth/stencil view
+	// Create a single-slice texture cascades are copied into for the inspector
+	shadowTexDesc.ArraySize = 1;
+	shadowTexDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	Graphics::Device->CreateTexture2D(&shadowTexDesc, 0, shadowPreviewTexture.ReleaseAndGetAddressOf());
+
+	// Create a depth/stencil view for each slice
 	D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSVDesc = {};
 	shadowDSVDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	shadowDSVDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	shadowDSVDesc.Texture2D.MipSlice = 0;
-	Graphics::Device->CreateDepthStencilView(
-		shadowTexture.Get(),
-		&shadowDSVDesc,
-		shadowDSV.GetAddressOf());
+	shadowDSVDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+	shadowDSVDesc.Texture2DArray.MipSlice = 0;
+	shadowDSVDesc.Texture2DArray.ArraySize = 1;
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+		shadowDSVDesc.Texture2DArray.FirstArraySlice = i;
+		Graphics::Device->CreateDepthStencilView(
+			shadowTexture.Get(),
+			&shadowDSVDesc,
+			shadowDSVs[i].GetAddressOf());
+		Graphics::Device->CreateDepthStencilView(
+			staticShadowTexture.Get(),
+			&shadowDSVDesc,
+			staticShadowDSVs[i].GetAddressOf());
+	}
 
-	// Create the SRV for the shadow map
+	// Create the SRV for the whole shadow map array
 	D3D11_SHADER_RESOURCE_VIEW_DESC shadowSRVDesc = {};
 	shadowSRVDesc.Format = DXGI_FORMAT_R32_FLOAT;
-	shadowSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	shadowSRVDesc.Texture2D.MipLevels = 1;
-	shadowSRVDesc.Texture2D.MostDetailedMip = 0;
+	shadowSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	shadowSRVDesc.Texture2DArray.MipLevels = 1;
+	shadowSRVDesc.Texture2DArray.MostDetailedMip = 0;
+	shadowSRVDesc.Texture2DArray.FirstArraySlice = 0;
+	shadowSRVDesc.Texture2DArray.ArraySize = SHADOW_CASCADE_COUNT;
 	Graphics::Device->CreateShaderResourceView(
 		shadowTexture.Get(),
 		&shadowSRVDesc,
 		shadowSRV.GetAddressOf());
 
+	// Create the SRV for the inspector's copy
+	D3D11_SHADER_RESOURCE_VIEW_DESC previewSRVDesc = {};
+	previewSRVDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	previewSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	previewSRVDesc.Texture2D.MipLevels = 1;
+	previewSRVDesc.Texture2D.MostDetailedMip = 0;
+	Graphics::Device->CreateShaderResourceView(
+		shadowPreviewTexture.Get(),
+		&previewSRVDesc,
+		shadowPreviewSRV.GetAddressOf());
+
 	// Add shadow map texture to materials that need it
 	for (int i = 3; i < materials.size(); i++) {
 		materials[i]->AddTextureSRV("MapShadow", shadowSRV);
@@ -1042,6 +2002,9 @@ void Game::RebuildShadowMap()
 void Game::BuildShadowMatrices() {
 	// Only do so if a light exists
 	if (lights.size() > 0) {
+		// Anything drawn with the old matrices is out of date
+		shadowLightVersion++;
+
 		XMVECTOR lightDirection = XMLoadFloat3(&lights[0].Direction);
 
 		if (lights[0].Type == LIGHT_TYPE_DIRECTIONAL) {
@@ -1082,6 +2045,58 @@ void Game::BuildShadowMatrices() {
 	}
 }
 
+// --------------------------------------------------------
+// Fits the shadow cascades around the current camera's
+// view, or falls back to a single map using the light's
+// matrices for spot lights or when cascades are off
+// --------------------------------------------------------
+void Game::BuildShadowCascades()
+{
+	unsigned int previousCount = shadowCascadeCount;
+
+	shadowCascadeCount = 0;
+	if (pShadowCascades && lights.size() > 0 && lights[0].Type == LIGHT_TYPE_DIRECTIONAL) {
+		std::shared_ptr<Camera> camera = cameras[pCameraCurrent];
+		shadowCascadeCount = ShadowCascades::ComputeCascades(
+			camera->GetViewMatrix(),
+			camera->GetProjectionMatrix(),
+			camera->GetNearClip(),
+			camera->GetFarClip(),
+			pShadowCascadeDistance,
+			(unsigned int)pShadowCascadeCount,
+			pShadowCascadeLambda,
+			lights[0].Direction,
+			pShadowLightDistance,
+			(unsigned int)pShadowResolution,
+			shadowCascades
+		);
+	}
+	if (shadowCascadeCount == 0) {
+		shadowCascades[0] = {};
+		shadowCascades[0].View = shadowLightViewMatrix;
+		shadowCascades[0].Projection = shadowLightProjectionMatrix;
+		shadowCascades[0].FarDistance = FLT_MAX;
+		shadowCascadeCount = 1;
+	}
+
+	// Cascades that weren't used last frame have missed
+	// any changes since, so everything needs redrawing
+	if (shadowCascadeCount != previousCount) {
+		shadowLightVersion++;
+	}
+
+	// Pass each cascade to the pixel shader. Unused ones reach
+	// endlessly far, so the shader never picks them
+	float splits[SHADOW_CASCADE_COUNT];
+	for (unsigned int i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+		const ShadowCascade& cascade = shadowCascades[i < shadowCascadeCount ? i : 0];
+		XMStoreFloat4x4(&shadowCascadeViewProjections[i],
+			XMMatrixMultiply(XMLoadFloat4x4(&cascade.View), XMLoadFloat4x4(&cascade.Projection)));
+		splits[i] = i < shadowCascadeCount ? shadowCascades[i].FarDistance : FLT_MAX;
+	}
+	shadowCascadeSplits = XMFLOAT4(splits);
+}
+
 // --------------------------------------------------------
 // Builds post-process resources for the first time
 // --------------------------------------------------------
@@ -1227,6 +2242,93 @@ void Game::ImGuiBuild() {
 			ImGui::Text("Delta Time:   %6dus", (int)(ImGui::GetIO().DeltaTime * 1000000));
 			ImGui::SetItemTooltip("Time between frames in microseconds\n(I didn't want to break things by trying to print the mu)");
 
+			ImGui::Spacing();
+			ImGui::Checkbox("Frustum Culling", &pCullEntities);
+			ImGui::SetItemTooltip("Skip drawing entities whose bounds are outside the current camera's view");
+			ImGui::Text("Visible:      %6u", cullingStats.Visible);
+			ImGui::Text("Culled:       %6u", cullingStats.Culled);
+			ImGui::SetItemTooltip("Entities skipped by the main pass last frame\n(out of %u)", cullingStats.Tested);
+			ImGui::Spacing();
+
+			ImGui::Text("CB Uploads:   %6u", bufferUploads);
+			ImGui::SetItemTooltip("Constant buffers uploaded last frame\n(%u more were already up to date)", bufferUploadsSkipped);
+			ImGui::Text("CB Bytes:     %6llu", bufferBytesUploaded);
+			ImGui::SetItemTooltip("Bytes of constant buffer data uploaded last frame");
+			ImGui::Text("Binds:        %6u", bindStats.Issued);
+			ImGui::SetItemTooltip("Shader, constant buffer, SRV and sampler binds made last frame\n(%u more were skipped since nothing would change)", bindStats.Skipped);
+			ImGui::Spacing();
+
+			const char* renderSortModes[] = { "Unsorted", "By State", "Front to Back" };
+			ImGui::Combo("Draw Order", &pRenderSortMode, renderSortModes, IM_ARRAYSIZE(renderSortModes));
+			ImGui::SetItemTooltip("How the main pass orders entities:\n- Unsorted: the order they were added in\n- By State: grouped by shaders, material and mesh, then front to back\n- Front to Back: nearest first, to cut down on overdraw");
+			ImGui::Text("Shader Swaps: %6u", drawShaderChanges);
+			ImGui::Text("Mat. Swaps:   %6u", drawMaterialChanges);
+			ImGui::SetItemTooltip("Times the main pass switched materials last frame\n(radix sort ran %u byte passes)", renderQueue.GetSortPasses());
+			ImGui::Spacing();
+
+			ImGui::Checkbox("Instancing", &pInstancing);
+			ImGui::SetItemTooltip("Draw entities sharing a mesh and material (or just a mesh, for shadows)\nwith one instanced draw call, if their shaders support it");
+			if (ImGui::SliderInt("Props", &pPropCount, 0, 4096)) {
+				SetPropCount(pPropCount);
+			}
+			ImGui::SetItemTooltip("Copies of a sphere to add to the scene, to stress test drawing");
+			ImGui::Text("Draw Calls:   %6u", drawCalls);
+			ImGui::SetItemTooltip("Draw calls the main pass made last frame\n(the shadow pass made %u more)", shadowDrawCalls);
+			ImGui::Spacing();
+
+			if (constantRing) {
+				ImGui::Text("CB Ring:      %6llu", constantRingStats.Bytes);
+				ImGui::SetItemTooltip("Bytes of per-draw constants written into the constant ring last frame\n(%u writes, wrapped %u times, ring is %u bytes)", constantRingStats.Allocations, constantRingStats.Wraps, constantRing->GetSize());
+			}
+			else {
+				ImGui::TextDisabled("CB Ring:         off");
+				ImGui::SetItemTooltip("This driver can't bind constant buffers by offset,\nso per-draw constants go in each shader's own buffers");
+			}
+			ImGui::Text("Inst. Ring:   %6llu", instanceRingStats.Bytes);
+			ImGui::SetItemTooltip("Bytes of instance data written into the instance ring last frame\n(%u writes, wrapped %u times, ring is %u bytes)", instanceRingStats.Allocations, instanceRingStats.Wraps, instanceRing->GetSize());
+			ImGui::Text("Frame Arena:  %6zu", frameArenaUsed);
+			ImGui::SetItemTooltip("Bytes of per-frame data allocated from the frame arena last frame\n(it has room for %zu)", frameArena.GetCapacity());
+			ImGui::Spacing();
+
+			ImGui::Text("Transforms:   %6u", transformsRebuilt);
+			ImGui::SetItemTooltip("Transforms whose matrices were rebuilt in last frame's batch\n(out of %u)", TransformSystem::Global().GetCount());
+			if (ImGui::TreeNode("Transform Benchmark")) {
+				ImGui::SetItemTooltip("Compares rebuilding transforms' matrices in the old layout, one at a time\nin the TransformSystem, and in one batch");
+				ImGui::SliderInt("Count", &pTransformBenchmarkCount, 1000, 200000);
+				ImGui::Checkbox("Hierarchy", &pTransformBenchmarkHierarchy);
+				ImGui::SetItemTooltip("Parent each transform to an earlier one, 4 children each, and only move the root");
+				if (ImGui::Button("Run")) {
+					RunTransformBenchmark();
+				}
+				ImGui::Text("Old Layout: %9.3fms", transformBenchmarkBaselineMs);
+				ImGui::SetItemTooltip("Each transform in its own heap allocation with its own matrices,\nrebuilt with a general inverse when read, the way Transform used to work\n(it has no hierarchy, so every transform is moved)");
+				ImGui::Text("Per Object: %9.3fms", transformBenchmarkPerObjectMs);
+				ImGui::SetItemTooltip("Each transform's matrices rebuilt on their own when read");
+				ImGui::Text("Batched:    %9.3fms", transformBenchmarkBatchedMs);
+				ImGui::SetItemTooltip("Every transform's matrices rebuilt in one pass, four at a time");
+				ImGui::Text("IT Error:   %9.2e%s", transformBenchmarkITError,
+					transformBenchmarkITError > TRANSFORM_IT_TOLERANCE ? " FAILED" : "");
+				ImGui::SetItemTooltip("Largest difference between the World Inverse Transpose matrices built from\nscale and rotation and ones from a general inverse, relative to their size\n(fails above %.0e)", TRANSFORM_IT_TOLERANCE);
+				ImGui::Text("IT Test:    %9.2e%s", transformITTestError, transformITTestPassed ? "" : " FAILED");
+				ImGui::SetItemTooltip("Largest error in a fixed set of uniform and non-uniform transforms, with\nand without non-uniform parents, rebuilt in batches and one at a time\n(fails above %.0e)", TRANSFORM_IT_TOLERANCE);
+				ImGui::TreePop();
+			}
+			ImGui::Spacing();
+
+			if (ImGui::TreeNode("Entity Benchmark")) {
+				ImGui::SetItemTooltip("Compares going through scenes of entities stored in dense arrays with going through pointers to each entity");
+				if (ImGui::Button("Run")) {
+					RunEntityBenchmark();
+				}
+				ImGui::Text("Entities     Store       Pointers");
+				for (int i = 0; i < ENTITY_BENCHMARK_SIZES; i++) {
+					ImGui::Text("%8u: %9.3fms %9.3fms", entityBenchmarkSizes[i], entityBenchmarkStoreMs[i], entityBenchmarkPointerMs[i]);
+				}
+				ImGui::SetItemTooltip("Store: every entity's components in an EntityStore\nPointers: each entity on the heap, with pointers to its parts");
+				ImGui::TreePop();
+			}
+			ImGui::Spacing();
+
 			if (ImGui::TreeNode("Framerate Graph")) {					// Graph of framerate over time
 				// Sets tooptip of enclosing TreeNode
 				ImGui::SetItemTooltip("Records the framerate over time\n(Slows down performance in Debug build while open)");
@@ -1334,6 +2436,29 @@ void Game::ImGuiBuild() {
 	if (ImGui::CollapsingHeader("Meshes")) {					// Info about each mesh
 		ImGui::Spacing();
 
+		ImGui::Text("Load Time: %9.3fms", meshLoadSeconds * 1000.0);
+		ImGui::SetItemTooltip("Time taken to load every mesh at startup\n(decoded across %d threads)", WorkerPool::Global().GetThreadCount());
+		if (ImGui::Button("Check Tangents")) {
+			CheckMeshTangents();
+		}
+		ImGui::SetItemTooltip("Loads every mesh's .OBJ file again and compares the tangents\ncalculated four at a time with the original code's");
+		if (!meshTangentErrors.empty()) {
+			int failures = 0;
+			for (float error : meshTangentErrors) {
+				failures += (error < 0.0f || error > TANGENT_CHECK_TOLERANCE) ? 1 : 0;
+			}
+			ImGui::SameLine();
+			if (failures == 0) {
+				ImGui::Text("All match");
+			}
+			else {
+				ImGui::Text("%d FAILED", failures);
+			}
+			ImGui::SetItemTooltip("Meshes whose tangents differ by more than %.0e, or couldn't be loaded", TANGENT_CHECK_TOLERANCE);
+		}
+
+		ImGui::Spacing();
+
 		ImGui::PushID("MESH");
 		for (int i = 0; i < meshes.size(); i++) {
 
@@ -1343,8 +2468,57 @@ void Game::ImGuiBuild() {
 				ImGui::Spacing();
 
 				ImGui::Text("Triangles: %6d", meshes[i]->GetIndexCount() / 3);
+				if (i < meshTangentErrors.size()) {
+					ImGui::Text("Tangent Error: %9.2e%s", meshTangentErrors[i],
+						(meshTangentErrors[i] < 0.0f || meshTangentErrors[i] > TANGENT_CHECK_TOLERANCE) ? " FAILED" : "");
+					ImGui::SetItemTooltip("Largest difference between a tangent calculated four at a time\nand by the original code (negative if the file couldn't be loaded)");
+				}
 				ImGui::Text("Vertices:  %6d", meshes[i]->GetVertexCount());
-				ImGui::Text("Indices:   %6d", meshes[i]->GetIndexCount());
+				ImGui::Text("Unwelded:  %6d", meshes[i]->GetUnweldedVertexCount());
+				ImGui::SetItemTooltip("Vertices before duplicates were welded together\n(%.2fx as many)",
+					meshes[i]->GetUnweldedVertexCount() / fmaxf(1.0f, (float)meshes[i]->GetVertexCount()));
+				ImGui::Text("Indices:   %6d (%d-bit)", meshes[i]->GetIndexCount(), meshes[i]->GetIndexFormat() == DXGI_FORMAT_R16_UINT ? 16 : 32);
+
+				const BoundingBox& boxBounds = meshes[i]->GetBoxBounds();
+				ImGui::Spacing();
+				ImGui::Text("Size:      %.2f x %.2f x %.2f", boxBounds.Extents.x * 2.0f, boxBounds.Extents.y * 2.0f, boxBounds.Extents.z * 2.0f);
+				ImGui::Text("Radius:    %.3f", meshes[i]->GetSphereBounds().Radius);
+				ImGui::SetItemTooltip("Radius of the sphere around the mesh's vertices");
+
+				const VertexCacheStats& cacheStats = meshes[i]->GetVertexCacheStats();
+				const VertexCacheStats& unoptimizedCacheStats = meshes[i]->GetUnoptimizedVertexCacheStats();
+				ImGui::Spacing();
+				ImGui::Text("ACMR:      %6.3f (was %.3f)", cacheStats.ACMR, unoptimizedCacheStats.ACMR);
+				ImGui::SetItemTooltip("Average cache miss ratio: vertex shader runs per triangle\nwith a 16-entry FIFO cache (0.5 is ideal, 3.0 is worst)");
+				ImGui::Text("ATVR:      %6.3f (was %.3f)", cacheStats.ATVR, unoptimizedCacheStats.ATVR);
+				ImGui::SetItemTooltip("Average transform to vertex ratio: vertex shader runs per vertex\nwith a 16-entry FIFO cache (1.0 is ideal)");
+
+				// Only meshes loaded from files have load times
+				const ObjLoadStats& loadStats = meshes[i]->GetLoadStats();
+				if (loadStats.Bytes > 0) {
+					ImGui::Spacing();
+					ImGui::Text("Source:    %s", meshes[i]->IsCached() ? "Cache" : "OBJ");
+					ImGui::SetItemTooltip("Whether the mesh was loaded from its .meshcache file\nor parsed from its .OBJ file");
+					ImGui::Text("File Size: %6dKB", (int)(loadStats.Bytes / 1024));
+					ImGui::Text("Load Time: %9.3fms", loadStats.Seconds * 1000.0);
+					ImGui::Text("Load Rate: %9.1fMB/s", loadStats.BytesPerSecond() / (1024.0 * 1024.0));
+					ImGui::SetItemTooltip("Bytes of the source file mapped and processed per second");
+				}
+
+				ImGui::Spacing();
+				ImGui::Text("Vertex Size: %4dB (%dKB total)", meshes[i]->GetVertexStride(),
+					(int)((size_t)meshes[i]->GetVertexStride() * meshes[i]->GetVertexCount() / 1024));
+				ImGui::SetItemTooltip("Bytes per vertex in the vertex buffer\n(%dB unpacked)", (int)sizeof(Vertex));
+				if (meshes[i]->IsPacked()) {
+					// How far vertices moved when they were packed
+					const VertexPackingError& packingError = meshes[i]->GetPackingError();
+					ImGui::Text("Packing Error (max / average)");
+					ImGui::Text("Position:  %.5f / %.5f", packingError.MaxPosition, packingError.AveragePosition);
+					ImGui::SetItemTooltip("Distance in local units");
+					ImGui::Text("Normal:    %.3f / %.3f deg", packingError.MaxNormalDegrees, packingError.AverageNormalDegrees);
+					ImGui::Text("Tangent:   %.3f / %.3f deg", packingError.MaxTangentDegrees, packingError.AverageTangentDegrees);
+					ImGui::Text("UV:        %.5f / %.5f", packingError.MaxUV, packingError.AverageUV);
+				}
 
 				ImGui::TreePop();
 				ImGui::Spacing();
@@ -1484,36 +2658,50 @@ void Game::ImGuiBuild() {
 		
 
 		ImGui::PushID("ENTITY");
-		for (int i = 0; i < entities.size(); i++) {
-			// Get position, rotation, scale, and tint
-			XMFLOAT3 entityPos = entities[i]->GetTransform()->GetPosition();
-			XMFLOAT3 entityRot = entities[i]->GetTransform()->GetRotation();
-			XMFLOAT3 entitySca = entities[i]->GetTransform()->GetScale();
-
+		for (unsigned int i = 0; i < entities.GetCount(); i++) {
 			// Each entity gets its own Tree Node
 			ImGui::PushID(i);
-			if (ImGui::TreeNode("", "(%06d) %s", i, entities[i]->GetName())) {
+			if (ImGui::TreeNode("", "(%06u) %s", i, entities.GetName(i))) {
+				// Get position, rotation, scale, and tint
+				const shared_ptr<Transform>& transform = entities.GetTransform(i);
+				XMFLOAT3 entityPos = transform->GetPosition();
+				XMFLOAT3 entityRot = transform->GetRotation();
+				XMFLOAT3 entitySca = transform->GetScale();
 				ImGui::Spacing();
 
-				ImGui::Text("Mesh:      %s", (entities[i]->GetMesh()->GetName()));
-				ImGui::Text("Material:  %s", (entities[i]->GetMaterial()->GetName()));
+				ImGui::Text("Mesh:      %s", (entities.GetMesh(i)->GetName()));
+				ImGui::Text("Material:  %s", (entities.GetMaterial(i)->GetName()));
 				ImGui::Spacing();
 
 				if (ImGui::DragFloat3("Position", &entityPos.x, 0.01f)) {
-					entities[i]->GetTransform()->SetPosition(entityPos);
+					transform->SetPosition(entityPos);
 				}
 				if (ImGui::DragFloat3("Rotation", &entityRot.x, 0.01f)) {
-					entities[i]->GetTransform()->SetRotation(entityRot);
+					transform->SetRotation(entityRot);
 				}
 				ImGui::SetItemTooltip("In radians");
+				bool quaternionRotation = transform->GetQuaternionRotation();
+				if (ImGui::Checkbox("Quaternion Rotation", &quaternionRotation)) {
+					transform->SetQuaternionRotation(quaternionRotation);
+				}
+				ImGui::SetItemTooltip("Keeps the rotation as only a quaternion, so rotating composes it instead of adding to the angles\n(The angles above are worked out from it)");
 				if (ImGui::DragFloat3("Scale", &entitySca.x, 0.01f, 0.0f)) {
-					entities[i]->GetTransform()->SetScale(entitySca);
+					transform->SetScale(entitySca);
 				}
 				// Clamp scale to 0
 				if (entitySca.x < 0.0f) entitySca.x = 0.0f;
 				if (entitySca.y < 0.0f) entitySca.y = 0.0f;
 				if (entitySca.z < 0.0f) entitySca.z = 0.0f;
 
+				// World-space bounds, from the mesh's local bounds
+				BoundingBox worldBox = entities.GetWorldBoxBounds(i);
+				BoundingSphere worldSphere = entities.GetWorldSphereBounds(i);
+				ImGui::Spacing();
+				ImGui::Text("Bounds Center:  %7.2f %7.2f %7.2f", worldBox.Center.x, worldBox.Center.y, worldBox.Center.z);
+				ImGui::Text("Bounds Extents: %7.2f %7.2f %7.2f", worldBox.Extents.x, worldBox.Extents.y, worldBox.Extents.z);
+				ImGui::SetItemTooltip("Half the size of the world-space box around the mesh");
+				ImGui::Text("Bounds Radius:  %7.2f", worldSphere.Radius);
+
 				ImGui::TreePop();
 				ImGui::Spacing();
 			}
@@ -1751,30 +2939,69 @@ void Game::ImGuiBuild() {
 		ImGui::SetItemTooltip("Shadows are cast from the first light in the scene.");
 		ImGui::Spacing();
 
+		if (ImGui::Checkbox("Cull shadow casters?", &pCullShadowCasters)) {
+			shadowLightVersion++;
+		}
+		ImGui::SetItemTooltip("Skip drawing entities into each shadow cascade if they're outside the area it covers\n(extended back toward the light).");
+		ImGui::Text("Casters: %u drawn, %u culled", shadowCullingStats.Visible, shadowCullingStats.Culled);
+		ImGui::Spacing();
+
+		const char* shadowCacheModes[] = { "Off", "Cached", "Cached (static + dynamic)" };
+		if (ImGui::Combo("Shadow Caching", &pShadowCacheMode, shadowCacheModes, IM_ARRAYSIZE(shadowCacheModes))) {
+			shadowLightVersion++;
+		}
+		ImGui::SetItemTooltip("Cached: only redraw a shadow cascade when it, the light or a caster in it moves.\nStatic + dynamic: keep static casters in their own map, and only\nredraw dynamic casters over a copy of it.");
+		ImGui::Text("Last frame: %u of %u cascades redrawn (%u with static casters)", shadowCascadesRedrawn, shadowCascadeCount, shadowStaticCascadesRedrawn);
+		ImGui::Text("Reused for: %u frames", shadowFramesReused);
+		ImGui::Spacing();
+
 		if (pRenderShadows) {
 			if (ImGui::SliderInt("Shadow Map Resolution", &pShadowResolutionExponent, 1, 12)) {
 				pShadowResolution = (int)pow(2, pShadowResolutionExponent);
 				RebuildShadowMap();
 			}
-			ImGui::SetItemTooltip("Shadow map will be rendered at %d tx.", pShadowResolution);
-			
-			if (ImGui::SliderFloat("Shadow Area Width", &pShadowAreaWidth, 0.1f, 100.0f, "%.1f", ImGuiSliderFlags_Logarithmic)) {
-				BuildShadowMatrices();
+			ImGui::SetItemTooltip("Each shadow cascade will be rendered at %d tx.", pShadowResolution);
+
+			ImGui::Checkbox("Cascaded shadows?", &pShadowCascades);
+			ImGui::SetItemTooltip("Split the current camera's view into slices, each with its own shadow map fit around it.\nOnly used for directional lights.");
+
+			if (pShadowCascades) {
+				ImGui::SliderInt("Cascade Count", &pShadowCascadeCount, 1, SHADOW_CASCADE_COUNT);
+				ImGui::SetItemTooltip("How many slices the camera's view is split into.");
+
+				ImGui::SliderFloat("Cascade Split Lambda", &pShadowCascadeLambda, 0.0f, 1.0f, "%.2f");
+				ImGui::SetItemTooltip("0 splits the view evenly, 1 splits it logarithmically (smaller slices up close).");
+
+				ImGui::SliderFloat("Shadow Distance", &pShadowCascadeDistance, 1.0f, 1000.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+				ImGui::SetItemTooltip("How far in front of the camera shadows reach, if closer than its far clip plane.");
+
+				for (unsigned int i = 0; i < shadowCascadeCount; i++) {
+					ImGui::Text("Cascade %u: %.1f to %.1f, %.3f units per texel", i, shadowCascades[i].NearDistance, shadowCascades[i].FarDistance, shadowCascades[i].TexelSize);
+				}
 			}
-			ImGui::SetItemTooltip("The width of the area in the world onto which shadows will be cast.");
-			
-			if (ImGui::DragFloat3("Shadow Area Center", &pShadowAreaCenter.x, 0.1f, NULL, NULL, "%.1f")) {
-				BuildShadowMatrices();
+			else {
+				if (ImGui::SliderFloat("Shadow Area Width", &pShadowAreaWidth, 0.1f, 100.0f, "%.1f", ImGuiSliderFlags_Logarithmic)) {
+					BuildShadowMatrices();
+				}
+				ImGui::SetItemTooltip("The width of the area in the world onto which shadows will be cast.");
+
+				if (ImGui::DragFloat3("Shadow Area Center", &pShadowAreaCenter.x, 0.1f, NULL, NULL, "%.1f")) {
+					BuildShadowMatrices();
+				}
+				ImGui::SetItemTooltip("The center of the area in the world onto which shadows will be cast.\nThe shadow map's far clip plane intersects this point.");
 			}
-			ImGui::SetItemTooltip("The center of the area in the world onto which shadows will be cast.\nThe shadow map's far clip plane intersects this point.");
 
 			if (ImGui::SliderFloat("Shadow Light Distance", &pShadowLightDistance, 0.2f, 1000.0f, "%.1f", ImGuiSliderFlags_Logarithmic)) {
 				BuildShadowMatrices();
 			}
-			ImGui::SetItemTooltip("The distance from the area center to pull back the camera.");
+			ImGui::SetItemTooltip("The distance from the area center (or each cascade's center) to pull back the camera.");
 
 			ImGui::Spacing();
-			ImGui::Image((void*)shadowSRV.Get(), ImVec2(256, 256));
+			pShadowPreviewCascade = min(pShadowPreviewCascade, (int)shadowCascadeCount - 1);
+			ImGui::SliderInt("Shown Cascade", &pShadowPreviewCascade, 0, (int)shadowCascadeCount - 1);
+			UINT previewSlice = D3D11CalcSubresource(0, (UINT)pShadowPreviewCascade, 1);
+			Graphics::Context->CopySubresourceRegion(shadowPreviewTexture.Get(), 0, 0, 0, 0, shadowTexture.Get(), previewSlice, 0);
+			ImGui::Image((void*)shadowPreviewSRV.Get(), ImVec2(256, 256));
 		}
 
 		ImGui::Spacing();
@@ -3,16 +3,108 @@
 #include <d3d11.h>
 #include <wrl/client.h>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #include <DirectXMath.h>
 
 #include "Mesh.h"
 #include "Material.h"
-#include "Entity.h"
+#include "EntityStore.h"
 #include "Lights.h"
 #include "Camera.h"
+#include "InstanceData.h"
+#include "Culling.h"
+#include "ShadowCascades.h"
+#include "RenderQueue.h"
 #include "Skybox.h"
 #include "SimpleShader.h"
+#include "StateCache.h"
+#include "RingBuffer.h"
+#include "FrameArena.h"
+
+// Scene sizes Game::RunEntityBenchmark() tries, from 12 to 1M entities
+#define ENTITY_BENCHMARK_SIZES	6
+
+// Largest difference Game::CheckMeshTangents() allows between
+// a mesh's fast and original tangents
+#define TANGENT_CHECK_TOLERANCE	1e-3f
+
+// Which shadow casters Game::DrawShadowCasters() draws
+#define SHADOW_CASTERS_ALL		0
+#define SHADOW_CASTERS_STATIC	1
+#define SHADOW_CASTERS_DYNAMIC	2
+
+// How the shadow map is reused between frames
+#define SHADOW_CACHE_OFF		0	// Redraw every frame
+#define SHADOW_CACHE_FULL		1	// Redraw when the light or any caster changes
+#define SHADOW_CACHE_SPLIT		2	// Keep static casters in their own map, and only redraw dynamic casters over it when they change
+
+// Handles to the variables Game::Draw() sets on each entity's shaders,
+// looked up once per shader so drawing never looks them up by name.
+// Variables a shader doesn't have get invalid handles, which are ignored.
+// They're grouped by the constant buffer they're in, which matches how
+// often they change: once per frame, per material or per entity
+struct EntityVertexShaderHandles
+{
+	SimpleVertexShader* Shader = nullptr;
+	// Small ID for RenderQueue sort keys
+	unsigned int SortID = 0;
+	// Handles of the shader's instanced version, if it has one
+	const EntityVertexShaderHandles* Instanced = nullptr;
+	// PerFrame
+	SimpleShaderHandle View;
+	SimpleShaderHandle Projection;
+	// PerObject
+	SimpleShaderHandle World;
+	SimpleShaderHandle WorldInverseTranspose;
+	SimpleShaderHandle QuantizationScale;
+	SimpleShaderHandle QuantizationOffset;
+};
+
+struct EntityPixelShaderHandles
+{
+	SimplePixelShader* Shader = nullptr;
+	unsigned int SortID = 0;
+	// PerFrame
+	SimpleShaderHandle CameraPosition;
+	SimpleShaderHandle Lights;
+	SimpleShaderHandle LightAmbient;
+	SimpleShaderHandle ShadowCascadeMatrices;
+	SimpleShaderHandle ShadowCascadeSplits;
+	SimpleShaderHandle ShadowCascadeCount;
+	SimpleShaderHandle TotalTime;
+	// PerMaterial
+	SimpleShaderHandle ColorTint;
+	SimpleShaderHandle Roughness;
+	SimpleShaderHandle UVPosition;
+	SimpleShaderHandle UVScale;
+	SimpleShaderHandle Metalness;
+	SimpleShaderHandle ImageCenter;
+	SimpleShaderHandle ZoomCenter;
+	SimpleShaderHandle MaxIterations;
+};
+
+// Handles of the shaders a material is drawn with, found once when
+// it's added so drawing never looks its shaders up per entity
+struct MaterialDrawHandles
+{
+	// Indexed by whether the mesh is packed, since packed meshes
+	// need the version of the vertex shader that unpacks them
+	const EntityVertexShaderHandles* VS[2] = {};
+	const EntityPixelShaderHandles* PS = nullptr;
+};
+
+// Handles to the variables Game::DrawShadowCasters() sets on the shadow shaders
+struct ShadowShaderHandles
+{
+	// PerCascade
+	SimpleShaderHandle View;
+	SimpleShaderHandle Projection;
+	// PerObject
+	SimpleShaderHandle World;
+	SimpleShaderHandle QuantizationScale;
+	SimpleShaderHandle QuantizationOffset;
+};
 
 class Game
 {
@@ -40,7 +132,12 @@ private:
 	void CreateSkyboxes();
 	void InitializeSimulationParameters();
 	void AddVertexShader(const wchar_t* _path, std::shared_ptr<SimpleVertexShader>& _shader);
+	void AddVertexShader(const wchar_t* _path, std::shared_ptr<SimpleVertexShader>& _shader, const D3D11_INPUT_ELEMENT_DESC* _inputElements, unsigned int _inputElementCount);
 	void AddPixelShader(const wchar_t* _path, std::shared_ptr<SimplePixelShader>& _shader);
+	EntityVertexShaderHandles& FindShaderHandles(std::shared_ptr<SimpleVertexShader> _shader);
+	EntityPixelShaderHandles& FindShaderHandles(std::shared_ptr<SimplePixelShader> _shader);
+	void FindMaterialDrawHandles();
+	ShadowShaderHandles FindShadowShaderHandles(std::shared_ptr<SimpleVertexShader> _shader);
 	void AddTexture(const wchar_t* _path);
 	void LoadTexture(const wchar_t* _path, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& _srv);
 	void LoadTexture(const wchar_t* _path, std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>& _srvVector);
@@ -52,7 +149,7 @@ private:
 	void AddMaterial(const char* _name, std::shared_ptr<SimpleVertexShader> _vertexShader, std::shared_ptr<SimplePixelShader> _pixelShader);
 	void AddPBRMaterial(const char* _name, std::shared_ptr<SimpleVertexShader> _vertexShader, std::shared_ptr<SimplePixelShader> _pixelShader, DirectX::XMFLOAT4 _colorTint, float _roughness, float _metalness);
 	void AddPBRMaterial(const char* _name, std::shared_ptr<SimpleVertexShader> _vertexShader, std::shared_ptr<SimplePixelShader> _pixelShader, float _roughness, float _metalness);
-	void AddEntity(const char* _name, unsigned int _meshIndex, unsigned int _materialIndex, DirectX::XMFLOAT3 _position);
+	unsigned int AddEntity(const char* _name, unsigned int _meshIndex, unsigned int _materialIndex, DirectX::XMFLOAT3 _position);
 	void AddLightDirectional(DirectX::XMFLOAT3 _direction, DirectX::XMFLOAT3 _color, float _intensity, bool _isActive);
 	void AddLightPoint(DirectX::XMFLOAT3 _position, DirectX::XMFLOAT3 _color, float _intensity, float _range, bool _isActive);
 	void AddLightSpot(DirectX::XMFLOAT3 _position, DirectX::XMFLOAT3 _direction, DirectX::XMFLOAT3 _color, float _intensity, float _range, float _innerAngle, float _outerAngle, bool _isActive);
@@ -67,6 +164,7 @@ private:
 	void BuildShadowMap();
 	void RebuildShadowMap();
 	void BuildShadowMatrices();
+	void BuildShadowCascades();
 	void BuildPostProcesses();
 	void RebuildPostProcesses();
 	void RebuildPostProcess(Microsoft::WRL::ComPtr<ID3D11RenderTargetView>& _ppRTV, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& _ppSRV);
@@ -76,6 +174,13 @@ private:
 	void ImGuiBuild();
 
 	// Draw helper methods
+	const EntityVertexShaderHandles* GetDrawVertexShaderHandles(unsigned int _materialID, Mesh* _mesh);
+	void BuildDrawBatches(const std::vector<DrawPacket>& _packets, bool _shadowPass);
+	void DrawShadowCasters(unsigned int _cascade, int _casters);
+	void SetPropCount(int _count);
+	void RunTransformBenchmark();
+	void RunEntityBenchmark();
+	void CheckMeshTangents();
 
 	// Destructor helper methods
 	void CleanupSimulationParameters();
@@ -128,6 +233,11 @@ private:
 	std::shared_ptr<SimpleVertexShader> vsDiffuseSpecular;
 	std::shared_ptr<SimpleVertexShader> vsDiffuseNormal;
 	std::shared_ptr<SimpleVertexShader> vsPBR;
+	// Version of vsPBR for meshes with packed vertices
+	std::shared_ptr<SimpleVertexShader> vsPBRPacked;
+	// Versions of vsPBR and vsPBRPacked for instanced draws
+	std::shared_ptr<SimpleVertexShader> vsPBRInstanced;
+	std::shared_ptr<SimpleVertexShader> vsPBRPackedInstanced;
 
 	std::shared_ptr<SimplePixelShader> psDiffuseSpecular;
 	std::shared_ptr<SimplePixelShader> psDiffuseNormal;
@@ -136,8 +246,21 @@ private:
 	std::shared_ptr<SimplePixelShader> psUVs;
 	std::shared_ptr<SimplePixelShader> psCustom;
 
+	// Handles for every shader, filled in by AddVertexShader() and AddPixelShader()
+	std::unordered_map<ISimpleShader*, EntityVertexShaderHandles> entityVertexShaderHandles;
+	std::unordered_map<ISimpleShader*, EntityPixelShaderHandles> entityPixelShaderHandles;
+	// Handles for each material's shaders, indexed by its sort ID
+	std::vector<MaterialDrawHandles> materialDrawHandles;
+
 	// MESHES
 	std::vector<std::shared_ptr<Mesh>> meshes;
+	// Time taken to load every mesh in CreateGeometry()
+	double meshLoadSeconds;
+	// Source file of each mesh, so checks can load them again
+	std::vector<std::wstring> meshSourcePaths;
+	// Largest difference between each mesh's fast and original tangents
+	// when CheckMeshTangents() last ran (empty if it hasn't)
+	std::vector<float> meshTangentErrors;
 	
 	// TEXTURES
 	std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textures;
@@ -148,7 +271,10 @@ private:
 	std::vector<std::shared_ptr<Material>> materials;
 
 	// ENTITIES
-	std::vector<std::shared_ptr<Entity>> entities;
+	EntityStore entities;
+	// Parent of the bouncer's spring and cylinder, which bobs them both up and down
+	std::shared_ptr<Transform> bouncerTransform;
+	unsigned int bouncerSpringEntity;
 
 	// LIGHTS
 	std::vector<Light> lights;
@@ -169,14 +295,31 @@ private:
 	int pSkyboxCurrent;
 
 	// SHADOWS
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSV;
+	// Array texture with one slice per cascade
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowTexture;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSVs[SHADOW_CASCADE_COUNT];
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowSRV;
+	// Maps holding only static casters, copied into the
+	// main ones before dynamic casters are drawn over them
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> staticShadowTexture;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> staticShadowDSVs[SHADOW_CASCADE_COUNT];
+	// Single cascade copied out for the inspector, which can't show array slices
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowPreviewTexture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowPreviewSRV;
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> shadowRasterizer;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> shadowSampler;
 	DirectX::XMFLOAT4X4 shadowLightViewMatrix;
 	DirectX::XMFLOAT4X4 shadowLightProjectionMatrix;
-	// Vertex Shader
-	std::shared_ptr<SimpleVertexShader> vsShadowMap;
+	// Cascades fit around the current camera's view this frame. Without
+	// cascades, there's one covering the fixed shadow area instead
+	ShadowCascade shadowCascades[SHADOW_CASCADE_COUNT];
+	unsigned int shadowCascadeCount;
+	// Each cascade's view-projection matrix and far distance, for the pixel shader
+	DirectX::XMFLOAT4X4 shadowCascadeViewProjections[SHADOW_CASCADE_COUNT];
+	DirectX::XMFLOAT4 shadowCascadeSplits;
+	// Vertex Shaders, indexed by [packed vertices][instanced]
+	std::shared_ptr<SimpleVertexShader> vsShadowMaps[2][2];
+	ShadowShaderHandles vsShadowMapHandles[2][2];
 	// Parameters
 	// Whether to render shadows
 	bool pRenderShadows;
@@ -190,6 +333,130 @@ private:
 	DirectX::XMFLOAT3 pShadowAreaCenter;
 	// Distance from the shadow map's center to pull the camera back when rendering the shadow map
 	float pShadowLightDistance;
+	// Whether to fit cascades around the camera's view for directional lights, instead of covering the fixed shadow area
+	bool pShadowCascades;
+	// Number of cascades the camera's view is split into
+	int pShadowCascadeCount;
+	// How logarithmic the cascade splits are, from 0 (even) to 1 (logarithmic)
+	float pShadowCascadeLambda;
+	// Distance in front of the camera shadows end at, if closer than the far clip plane
+	float pShadowCascadeDistance;
+	// Which cascade the inspector shows
+	int pShadowPreviewCascade;
+	// How the shadow map is reused between frames (SHADOW_CACHE_*)
+	int pShadowCacheMode;
+	// Caching
+	// Goes up whenever the light's matrices or the shadow maps themselves change
+	unsigned long long shadowLightVersion;
+	// Light version and each cascade when the shadow maps were last drawn
+	unsigned long long shadowDrawnLightVersion;
+	ShadowCascade shadowDrawnCascades[SHADOW_CASCADE_COUNT];
+	// Each entity's Transform version last frame, and whether it's changed since
+	std::vector<unsigned long long> shadowCasterVersions;
+	std::vector<uint8_t> shadowCasterMoved;
+	// How many cascades were redrawn last frame, and how many frames in a row none were
+	unsigned int shadowCascadesRedrawn;
+	unsigned int shadowStaticCascadesRedrawn;
+	unsigned int shadowFramesReused;
+
+	// CULLING
+	// World-space bounds of each entity, updated every frame
+	std::vector<DirectX::BoundingBox> entityBounds;
+	// Whether each entity is inside the current camera's view this frame
+	std::vector<uint8_t> entityVisible;
+	// How many entities the main pass drew and skipped last frame
+	CullingStats cullingStats;
+	// Whether each entity can cast a shadow into each cascade this frame, and
+	// whether it could last frame (to catch entities leaving a cascade)
+	std::vector<uint8_t> shadowCasterVisible[SHADOW_CASCADE_COUNT];
+	std::vector<uint8_t> shadowCasterWasVisible;
+	// How many entities the shadow pass drew and skipped last frame, across all cascades
+	CullingStats shadowCullingStats;
+	// Parameters
+	// Whether to skip drawing entities outside the camera's view
+	bool pCullEntities;
+	// Whether to skip drawing entities that can't cast shadows into the shadow map
+	bool pCullShadowCasters;
+
+	// RENDER QUEUE
+	// Visible entities, sorted each frame before they're drawn
+	RenderQueue renderQueue;
+	// How many times the main pass switched shaders and materials last frame
+	unsigned int drawShaderChanges;
+	unsigned int drawMaterialChanges;
+	// Parameters
+	// RENDER_SORT_ mode the main pass draws entities in
+	int pRenderSortMode;
+
+	// INSTANCING
+	// Runs of queued draws to submit, allocated from frameArena,
+	// with the instances of instanced runs written to instanceRing
+	DrawBatch* drawBatches;
+	unsigned int drawBatchCount;
+	// Shadow casters, sorted by mesh so casters sharing one can be instanced
+	RenderQueue shadowQueue;
+	// Draw calls the main and shadow passes made last frame
+	unsigned int drawCalls;
+	unsigned int shadowDrawCalls;
+	// Handles to extra copies of a prop, for stress testing
+	std::vector<unsigned int> propEntities;
+	// Parameters
+	// Whether to draw entities sharing a mesh and material with one instanced draw
+	bool pInstancing;
+	// Number of props
+	int pPropCount;
+
+	// CONSTANT BUFFERS
+	// How many constant buffers were uploaded and skipped (already up
+	// to date) last frame, and how many bytes were uploaded
+	unsigned int bufferUploads;
+	unsigned int bufferUploadsSkipped;
+	unsigned long long bufferBytesUploaded;
+
+	// STATE CACHE
+	// Filters out binds that wouldn't change anything, for every SimpleShader
+	std::shared_ptr<StateCache> stateCache;
+	// How many binds it passed on and dropped last frame
+	StateCacheStats bindStats;
+
+	// FRAME MEMORY
+	// Per-draw constant buffers are written here, if the
+	// driver supports binding constant buffers by offset
+	std::shared_ptr<RingBuffer> constantRing;
+	// Instance data for instanced draws is written here
+	std::shared_ptr<RingBuffer> instanceRing;
+	// Memory for things that only last one frame
+	FrameArena frameArena;
+	// Usage last frame
+	RingBufferStats constantRingStats;
+	RingBufferStats instanceRingStats;
+	size_t frameArenaUsed;
+
+	// TRANSFORMS
+	// Transforms whose matrices were rebuilt in last frame's batch
+	unsigned int transformsRebuilt;
+	// Milliseconds RunTransformBenchmark() took to rebuild every
+	// transform's matrices in the old one-allocation-per-transform
+	// layout, one at a time, and in one batch
+	double transformBenchmarkBaselineMs;
+	double transformBenchmarkPerObjectMs;
+	double transformBenchmarkBatchedMs;
+	// Largest relative difference between RunTransformBenchmark()'s World
+	// Inverse Transpose matrices and ones from a general inverse
+	float transformBenchmarkITError;
+	// Largest error TransformSystem::TestInverseTransposes() found when
+	// the benchmark last ran, and whether it was within tolerance
+	float transformITTestError;
+	bool transformITTestPassed;
+	// Parameters
+	// Number of transforms RunTransformBenchmark() rebuilds
+	int pTransformBenchmarkCount;
+	// Whether RunTransformBenchmark() puts its transforms in one tree and only moves the root
+	bool pTransformBenchmarkHierarchy;
+	// Milliseconds RunEntityBenchmark() took to go through each size of
+	// scene in an EntityStore, and in a vector of pointers to entities
+	double entityBenchmarkStoreMs[ENTITY_BENCHMARK_SIZES];
+	double entityBenchmarkPointerMs[ENTITY_BENCHMARK_SIZES];
 
 	// POST-PROCESSING
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> ppSampler;
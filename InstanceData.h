@@ -0,0 +1,19 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// Minimum number of entities sharing a mesh and material
+// before they're drawn with one instanced draw
+#define INSTANCING_MIN_GROUP	2
+
+// --------------------------------------------------------
+// Data for one instance in an instanced draw, read from
+// input slot 1 once per instance
+//
+// Must match InstanceInput in ShaderStructs.hlsli
+// --------------------------------------------------------
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 WorldInverseTranspose;
+};
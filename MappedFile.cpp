@@ -0,0 +1,241 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+namespace
+{
+	// Encodes a wide (UTF-32 on POSIX) path as the UTF-8 string open() expects
+	std::string WidePathToUTF8(const wchar_t* _path)
+	{
+		std::string result;
+		for (const wchar_t* c = _path; *c != 0; c++) {
+			unsigned int cp = (unsigned int)*c;
+			if (cp < 0x80) {
+				result.push_back((char)cp);
+			}
+			else if (cp < 0x800) {
+				result.push_back((char)(0xC0 | (cp >> 6)));
+				result.push_back((char)(0x80 | (cp & 0x3F)));
+			}
+			else if (cp < 0x10000) {
+				result.push_back((char)(0xE0 | (cp >> 12)));
+				result.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+				result.push_back((char)(0x80 | (cp & 0x3F)));
+			}
+			else {
+				result.push_back((char)(0xF0 | (cp >> 18)));
+				result.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+				result.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+				result.push_back((char)(0x80 | (cp & 0x3F)));
+			}
+		}
+		return result;
+	}
+}
+#endif
+
+/// <summary>
+/// Constructs a MappedFile with nothing mapped
+/// </summary>
+MappedFile::MappedFile() :
+	data(nullptr),
+	size(0),
+	isOpen(false),
+#ifdef _WIN32
+	fileHandle(INVALID_HANDLE_VALUE),
+	mappingHandle(nullptr)
+#else
+	fileDescriptor(-1)
+#endif
+{
+}
+
+/// <summary>
+/// Unmaps the file, if one is mapped
+/// </summary>
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+/// <summary>
+/// Takes ownership of another MappedFile's mapping
+/// </summary>
+/// <param name="_other">The MappedFile to move from, which is left closed</param>
+MappedFile::MappedFile(MappedFile&& _other) noexcept :
+	MappedFile()
+{
+	TakeFrom(_other);
+}
+
+/// <summary>
+/// Closes this MappedFile and takes ownership of another's mapping
+/// </summary>
+/// <param name="_other">The MappedFile to move from, which is left closed</param>
+/// <returns>This MappedFile</returns>
+MappedFile& MappedFile::operator=(MappedFile&& _other) noexcept
+{
+	if (this != &_other) {
+		Close();
+		TakeFrom(_other);
+	}
+	return *this;
+}
+
+/// <summary>
+/// Maps an entire file into memory as read-only
+/// </summary>
+/// <param name="_path">The path of the file to map</param>
+/// <returns>Whether the file was opened and mapped</returns>
+bool MappedFile::Open(const wchar_t* _path)
+{
+	Close();
+
+#ifdef _WIN32
+	fileHandle = CreateFileW(_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(fileHandle, &fileSize)) {
+		Close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+
+	// Zero-length files can't be mapped, but they're still valid (empty) files
+	if (size > 0) {
+		mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle == nullptr) {
+			Close();
+			return false;
+		}
+
+		data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (data == nullptr) {
+			Close();
+			return false;
+		}
+	}
+#else
+	fileDescriptor = open(WidePathToUTF8(_path).c_str(), O_RDONLY);
+	if (fileDescriptor < 0) {
+		return false;
+	}
+
+	struct stat fileStats = {};
+	if (fstat(fileDescriptor, &fileStats) != 0) {
+		Close();
+		return false;
+	}
+	size = (size_t)fileStats.st_size;
+
+	if (size > 0) {
+		void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (view == MAP_FAILED) {
+			Close();
+			return false;
+		}
+		data = (const char*)view;
+
+		// The whole file is about to be read front to back
+		madvise(view, size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	isOpen = true;
+	return true;
+}
+
+/// <summary>
+/// Unmaps the file and releases its handles
+/// </summary>
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data != nullptr) {
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle != nullptr) {
+		CloseHandle(mappingHandle);
+		mappingHandle = nullptr;
+	}
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		CloseHandle(fileHandle);
+		fileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (data != nullptr) {
+		munmap((void*)data, size);
+	}
+	if (fileDescriptor >= 0) {
+		close(fileDescriptor);
+		fileDescriptor = -1;
+	}
+#endif
+
+	data = nullptr;
+	size = 0;
+	isOpen = false;
+}
+
+/// <summary>
+/// Gets the start of the mapped contents
+/// </summary>
+/// <returns>A pointer to the first byte of the file, or nullptr if nothing (or an empty file) is mapped</returns>
+const char* MappedFile::GetData() const
+{
+	return data;
+}
+
+/// <summary>
+/// Gets the length of the mapped contents
+/// </summary>
+/// <returns>The size of the file in bytes</returns>
+size_t MappedFile::GetSize() const
+{
+	return size;
+}
+
+/// <summary>
+/// Gets whether a file is currently mapped
+/// </summary>
+/// <returns>Whether the last call to Open() succeeded</returns>
+bool MappedFile::IsOpen() const
+{
+	return isOpen;
+}
+
+/// <summary>
+/// Moves another MappedFile's handles into this one, which must already be closed
+/// </summary>
+/// <param name="_other">The MappedFile to move from, which is left closed</param>
+void MappedFile::TakeFrom(MappedFile& _other)
+{
+	data = _other.data;
+	size = _other.size;
+	isOpen = _other.isOpen;
+#ifdef _WIN32
+	fileHandle = _other.fileHandle;
+	mappingHandle = _other.mappingHandle;
+	_other.fileHandle = INVALID_HANDLE_VALUE;
+	_other.mappingHandle = nullptr;
+#else
+	fileDescriptor = _other.fileDescriptor;
+	_other.fileDescriptor = -1;
+#endif
+	_other.data = nullptr;
+	_other.size = 0;
+	_other.isOpen = false;
+}
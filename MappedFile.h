@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+
+// Read-only view of an entire file mapped into memory.
+// Uses file mappings on Windows and mmap() everywhere else,
+// so the contents can be parsed in place without copying them
+class MappedFile
+{
+public:
+	// Constructors/Destructor
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete; // Remove copy constructor
+	MappedFile& operator=(const MappedFile&) = delete; // Remove copy-assignment operator
+	MappedFile(MappedFile&& _other) noexcept;
+	MappedFile& operator=(MappedFile&& _other) noexcept;
+
+	// Maps a file, closing any file that was already mapped
+	bool Open(const wchar_t* _path);
+	// Unmaps the file
+	void Close();
+
+	// Accessors for the mapped contents
+	const char* GetData() const;
+	size_t GetSize() const;
+	bool IsOpen() const;
+
+private:
+	// Start and length of the mapped contents
+	const char* data;
+	size_t size;
+	// Whether Open() succeeded (empty files are open but have no data)
+	bool isOpen;
+
+#ifdef _WIN32
+	// Handles to the file and its mapping object
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	// Descriptor of the mapped file
+	int fileDescriptor;
+#endif
+
+	// Moves another MappedFile's handles into this one
+	void TakeFrom(MappedFile& _other);
+};
@@ -22,6 +22,7 @@ Material::Material(const char* _name, std::shared_ptr<SimpleVertexShader> _verte
 	useGlobalEnvironmentMap = false;
 	isSamplerStateLocked = false;
 	isPBR = false;
+	sortID = 0;
 }
 
 /// <summary>
@@ -46,6 +47,7 @@ Material::Material(const char* _name, std::shared_ptr<SimpleVertexShader> _verte
 	useGlobalEnvironmentMap = _useGlobalEnvironmentMap;
 	isSamplerStateLocked = false;
 	isPBR = false;
+	sortID = 0;
 }
 
 /// <summary>
@@ -70,13 +72,14 @@ Material::Material(const char* _name, std::shared_ptr<SimpleVertexShader> _verte
 	useGlobalEnvironmentMap = false;
 	isSamplerStateLocked = false;
 	isPBR = true;
+	sortID = 0;
 }
 
 /// <summary>
 /// Gets the Vertex Shader the Material is using
 /// </summary>
 /// <returns>The Material's Vertex Shader</returns>
-std::shared_ptr<SimpleVertexShader> Material::GetVertexShader()
+const std::shared_ptr<SimpleVertexShader>& Material::GetVertexShader()
 {
 	return vertexShader;
 }
@@ -85,7 +88,7 @@ std::shared_ptr<SimpleVertexShader> Material::GetVertexShader()
 /// Gets the Pixel Shader the Material is using
 /// </summary>
 /// <returns>The Material's Pixel Shader</returns>
-std::shared_ptr<SimplePixelShader> Material::GetPixelShader()
+const std::shared_ptr<SimplePixelShader>& Material::GetPixelShader()
 {
 	return pixelShader;
 }
@@ -126,6 +129,15 @@ const char* Material::GetName()
 	return name;
 }
 
+/// <summary>
+/// Gets the small ID RenderQueue sort keys use to group entities drawn with the Material
+/// </summary>
+/// <returns>The Material's sort ID</returns>
+unsigned int Material::GetSortID()
+{
+	return sortID;
+}
+
 /// <summary>
 /// Sets the Material's UV position
 /// </summary>
@@ -168,6 +180,15 @@ void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> _pixelShader)
 	pixelShader = _pixelShader;
 }
 
+/// <summary>
+/// Sets the small ID RenderQueue sort keys use to group entities drawn with the Material
+/// </summary>
+/// <param name="_sortID">The Material's new sort ID, unique among the Materials drawn together</param>
+void Material::SetSortID(unsigned int _sortID)
+{
+	sortID = _sortID;
+}
+
 /// <summary>
 /// Sets the Material's color tint
 /// </summary>
@@ -12,18 +12,20 @@ public:
 	Material(const char* _name, std::shared_ptr<SimpleVertexShader> _vertexShader, std::shared_ptr<SimplePixelShader> _pixelShader, DirectX::XMFLOAT4 _colorTint, float _roughness, bool _useGlobalEnvironmentMap);
 	Material(const char* _name, std::shared_ptr<SimpleVertexShader> _vertexShader, std::shared_ptr<SimplePixelShader> _pixelShader, DirectX::XMFLOAT4 _colorTint, float _roughness, float _metalness);
 
-	std::shared_ptr<SimpleVertexShader> GetVertexShader();
-	std::shared_ptr<SimplePixelShader> GetPixelShader();
+	const std::shared_ptr<SimpleVertexShader>& GetVertexShader();
+	const std::shared_ptr<SimplePixelShader>& GetPixelShader();
 	DirectX::XMFLOAT4 GetColorTint();
 	float GetRoughness();
 	float GetMetalness();
 	const char* GetName();
+	unsigned int GetSortID();
 	DirectX::XMFLOAT2 GetUVPosition();
 	DirectX::XMFLOAT2 GetUVScale();
 	std::vector<ID3D11ShaderResourceView*> GetTextures();
 
 	void SetVertexShader(std::shared_ptr<SimpleVertexShader> _vertexShader);
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> _pixelShader);
+	void SetSortID(unsigned int _sortID);
 	void SetColorTint(DirectX::XMFLOAT4 _colorTint);
 	void SetRoughness(float _roughness);
 	void SetMetalness(float _metalness);
@@ -63,5 +65,7 @@ private:
 	bool isSamplerStateLocked;
 
 	const char* name;
+	// Small ID for RenderQueue sort keys
+	unsigned int sortID;
 };
 
@@ -1,9 +1,112 @@
-#include <fstream>
+#include <chrono>
+#include <cmath>
 #include <vector>
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "WorkerPool.h"
 
 using namespace DirectX;
 
+namespace
+{
+	// Meshes are only split across threads when every
+	// thread would get at least this many triangles
+	const size_t TANGENT_MIN_TRIANGLES_PER_THREAD = 8192;
+
+	// Adds each triangle in [_firstTriangle, _lastTriangle) to the tangent sums
+	// of its three vertices. Four triangles are transposed into the four lanes
+	// of each SIMD register, so every step of the math handles all four at once
+	void AccumulateTangents(const Vertex* _vertices, const unsigned int* _indices, size_t _firstTriangle, size_t _lastTriangle, XMFLOAT3* _tangents)
+	{
+		for (size_t first = _firstTriangle; first < _lastTriangle; first += 4) {
+			XMMATRIX edge1;	// Triangle edges from the first corner (one triangle per row)
+			XMMATRIX edge2;
+			XMMATRIX uvEdges;	// UV edges from the first corner as (s1, s2, t1, t2)
+			const unsigned int* corners[4];
+
+			for (size_t lane = 0; lane < 4; lane++) {
+				// Lanes past the end repeat the last triangle and are never stored
+				size_t triangle = first + lane < _lastTriangle ? first + lane : _lastTriangle - 1;
+				corners[lane] = &_indices[triangle * 3];
+
+				const Vertex& v1 = _vertices[corners[lane][0]];
+				const Vertex& v2 = _vertices[corners[lane][1]];
+				const Vertex& v3 = _vertices[corners[lane][2]];
+
+				XMVECTOR p1 = XMLoadFloat3(&v1.Position);
+				XMVECTOR uv1 = XMLoadFloat2(&v1.UV);
+				edge1.r[lane] = XMLoadFloat3(&v2.Position) - p1;
+				edge2.r[lane] = XMLoadFloat3(&v3.Position) - p1;
+				uvEdges.r[lane] = XMVectorMergeXY(XMLoadFloat2(&v2.UV) - uv1, XMLoadFloat2(&v3.UV) - uv1);
+			}
+
+			// Rows become components (x, y, z, ...), columns become triangles
+			edge1 = XMMatrixTranspose(edge1);
+			edge2 = XMMatrixTranspose(edge2);
+			uvEdges = XMMatrixTranspose(uvEdges);
+			XMVECTOR s1 = uvEdges.r[0];
+			XMVECTOR s2 = uvEdges.r[1];
+			XMVECTOR t1 = uvEdges.r[2];
+			XMVECTOR t2 = uvEdges.r[3];
+
+			// Same math as CalculateTangentsScalar(), four triangles wide
+			XMVECTOR r = XMVectorReciprocal(s1 * t2 - s2 * t1);
+			XMMATRIX tangents;
+			tangents.r[0] = (t2 * edge1.r[0] - t1 * edge2.r[0]) * r;
+			tangents.r[1] = (t2 * edge1.r[1] - t1 * edge2.r[1]) * r;
+			tangents.r[2] = (t2 * edge1.r[2] - t1 * edge2.r[2]) * r;
+			tangents.r[3] = XMVectorZero();
+			tangents = XMMatrixTranspose(tangents);
+
+			// Scatter each triangle's tangent to its corners, in
+			// the same order the scalar version adds them
+			for (size_t lane = 0; lane < 4 && first + lane < _lastTriangle; lane++) {
+				for (int corner = 0; corner < 3; corner++) {
+					XMFLOAT3& sum = _tangents[corners[lane][corner]];
+					XMStoreFloat3(&sum, XMLoadFloat3(&sum) + tangents.r[lane]);
+				}
+			}
+		}
+	}
+
+	// Turns summed tangents in [_first, _last) into unit vectors orthogonal to
+	// their vertices' normals (Gram-Schmidt), four vertices at a time
+	void OrthonormalizeTangents(Vertex* _vertices, const XMFLOAT3* _tangents, size_t _first, size_t _last)
+	{
+		for (size_t first = _first; first < _last; first += 4) {
+			XMMATRIX normals;
+			XMMATRIX tangents;
+			for (size_t lane = 0; lane < 4; lane++) {
+				size_t vertex = first + lane < _last ? first + lane : _last - 1;
+				normals.r[lane] = XMLoadFloat3(&_vertices[vertex].Normal);
+				tangents.r[lane] = XMLoadFloat3(&_tangents[vertex]);
+			}
+			normals = XMMatrixTranspose(normals);
+			tangents = XMMatrixTranspose(tangents);
+
+			// tangent - normal * dot(normal, tangent)
+			XMVECTOR dot = normals.r[0] * tangents.r[0] + normals.r[1] * tangents.r[1] + normals.r[2] * tangents.r[2];
+			XMVECTOR x = tangents.r[0] - normals.r[0] * dot;
+			XMVECTOR y = tangents.r[1] - normals.r[1] * dot;
+			XMVECTOR z = tangents.r[2] - normals.r[2] * dot;
+
+			// Normalize, leaving zero-length tangents at zero like XMVector3Normalize() does
+			XMVECTOR lengthSquared = x * x + y * y + z * z;
+			XMVECTOR hasLength = XMVectorGreater(lengthSquared, XMVectorZero());
+			XMVECTOR inverseLength = XMVectorSelect(XMVectorZero(), XMVectorReciprocal(XMVectorSqrt(lengthSquared)), hasLength);
+			tangents.r[0] = x * inverseLength;
+			tangents.r[1] = y * inverseLength;
+			tangents.r[2] = z * inverseLength;
+			tangents.r[3] = XMVectorZero();
+			tangents = XMMatrixTranspose(tangents);
+
+			for (size_t lane = 0; lane < 4 && first + lane < _last; lane++) {
+				XMStoreFloat3(&_vertices[first + lane].Tangent, tangents.r[lane]);
+			}
+		}
+	}
+}
+
 // --------------------------------------------------------
 // Constructs Mesh from list of vertices and indices
 // --------------------------------------------------------
@@ -13,219 +116,119 @@ Mesh::Mesh(const char* _name, Vertex* _vertices, size_t _vertexCount, unsigned i
 
 	vertexCount = 0;
 	indexCount = 0;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	unweldedVertexCount = (unsigned int)_vertexCount;
+	loadStats = {};
+	isCached = false;
+	vertexCacheStats = MeshOptimizer::AnalyzeVertexCache(_indices, _indexCount, _vertexCount);
+	unoptimizedVertexCacheStats = vertexCacheStats;
+	isPacked = false;
+	quantization = {};
+	packingError = {};
+	sortID = 0;
 
 	CalculateTangents(_vertices, (unsigned int)_vertexCount, _indices, (unsigned int)_indexCount);
-	InitializeBuffers(_vertices, (unsigned int)_vertexCount, _indices, (unsigned int)_indexCount);
+	CalculateBounds(_vertices, _vertexCount, boxBounds, sphereBounds);
+	InitializeBuffers(_vertices, sizeof(Vertex), (unsigned int)_vertexCount, _indices, (unsigned int)_indexCount);
 }
 
-Mesh::Mesh(const char* _name, const wchar_t* _path)
+// --------------------------------------------------------
+// Constructs Mesh from an .OBJ file
+// --------------------------------------------------------
+Mesh::Mesh(const char* _name, const wchar_t* _path, unsigned int _processingFlags)
 {
 	name = _name;
 
-	vertexCount = 0;
-	indexCount = 0;
-
-	// Author: Chris Cascioli
-	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
-	// 
-	// - You are allowed to directly copy/paste this into your code base
-	//   for assignments, given that you clearly cite that this is not
-	//   code of your own design.
-	//
-	// - NOTE: You'll need to #include <fstream>
-
+	MeshData data;
+	Decode(_path, data, _processingFlags);
+	Upload(data);
+}
 
-	// File input object
-	std::ifstream obj(_path);
+// --------------------------------------------------------
+// Constructs Mesh from data that was already decoded
+// (possibly on another thread) with Mesh::Decode()
+// --------------------------------------------------------
+Mesh::Mesh(const char* _name, const MeshData& _data)
+{
+	name = _name;
 
-	// Check for successful open
-	if (!obj.is_open())
-		return;
+	Upload(_data);
+}
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;	// Positions from the file
-	std::vector<XMFLOAT3> normals;		// Normals from the file
-	std::vector<XMFLOAT2> uvs;		// UVs from the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
-	char chars[100];			// String for line reading
-
-	// Still have data left?
-	while (obj.good())
-	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
-
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12];
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
-			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(XMFLOAT2(0, 0));
-			}
+// --------------------------------------------------------
+// Loads an .OBJ file and processes it into vertices and
+// indices that are ready to upload. Only touches _data,
+// so multiple meshes can be decoded at once
+//
+// _processingFlags is a combination of MESH_OPTIMIZE_*
+// flags choosing which optional steps to run
+// --------------------------------------------------------
+bool Mesh::Decode(const wchar_t* _path, MeshData& _data, unsigned int _processingFlags)
+{
+	_data.Vertices.clear();
+	_data.Indices.clear();
+	_data.IsCached = false;
+	_data.Cache = {};
+	_data.UnweldedVertexCount = 0;
+	_data.LoadStats = {};
+	_data.UnoptimizedCacheStats = {};
+	_data.CacheStats = {};
+	_data.PackedVertices.clear();
+	_data.Quantization = {};
+	_data.PackingError = {};
+	_data.BoxBounds = BoundingBox();
+	_data.SphereBounds = BoundingSphere();
+
+	// Packing happens after the cache is loaded or saved,
+	// so it doesn't need caches of its own
+	unsigned int cacheFlags = _processingFlags & ~MESH_OPTIMIZE_PACK_VERTICES;
+
+	// Use the processed mesh from the last time this file
+	// was loaded if it's still up to date. Its vertices and
+	// indices are read straight out of the mapped file
+	auto cacheStartTime = std::chrono::steady_clock::now();
+	if (MeshCache::Load(_path, cacheFlags, _data.CacheFile, _data.Cache)) {
+		_data.IsCached = true;
+		_data.UnweldedVertexCount = _data.Cache.Header->UnweldedVertexCount;
+		_data.UnoptimizedCacheStats.ACMR = _data.Cache.Header->UnoptimizedACMR;
+		_data.UnoptimizedCacheStats.ATVR = _data.Cache.Header->UnoptimizedATVR;
+		_data.CacheStats.ACMR = _data.Cache.Header->ACMR;
+		_data.CacheStats.ATVR = _data.Cache.Header->ATVR;
+		// The bounds were found when the cache was written
+		BoundingBox::CreateFromPoints(_data.BoxBounds, XMLoadFloat3(&_data.Cache.Header->BoundsMin), XMLoadFloat3(&_data.Cache.Header->BoundsMax));
+		_data.SphereBounds = BoundingSphere(_data.Cache.Header->SphereCenter, _data.Cache.Header->SphereRadius);
+
+		_data.LoadStats.Bytes = _data.CacheFile.GetSize();
+		_data.LoadStats.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - cacheStartTime).count();
+		_data.LoadStats.Faces = _data.Cache.Header->IndexCount / 3;
+	}
+	else if (!DecodeSource(_path, _data, cacheFlags)) {
+		return false;
+	}
 
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal's Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal's Z
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-			}
-		}
+	// Compress the vertices, checking how far each one
+	// moves so the precision loss can be reported
+	if (_processingFlags & MESH_OPTIMIZE_PACK_VERTICES) {
+		_data.Quantization = VertexPacking::ComputeQuantization(_data.GetVertices(), _data.GetVertexCount());
+		_data.PackedVertices.resize(_data.GetVertexCount());
+		_data.PackingError = VertexPacking::Pack(_data.GetVertices(), _data.GetVertexCount(), _data.Quantization, _data.PackedVertices.data());
 	}
+	return true;
+}
 
-	// Close the file and create the actual buffers
-	obj.close();
+// --------------------------------------------------------
+// Parses and processes a mesh's source file into _data
+// and saves the results to its cache
+// --------------------------------------------------------
+bool Mesh::DecodeSource(const wchar_t* _path, MeshData& _data, unsigned int _processingFlags)
+{
+	// The file is memory-mapped and tokenized in place, which is
+	// much faster than reading it line by line through sscanf_s
+	// (see ObjLoader for details)
+	std::vector<Vertex>& verts = _data.Vertices;		// Verts we're assembling
+	std::vector<unsigned int>& indices = _data.Indices;	// Indices of these verts
+	if (!ObjLoader::Load(_path, verts, indices, &_data.LoadStats) || verts.empty())
+		return false;
 
 	// - At this point, "verts" is a vector of Vertex structs, and can be used
 	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
@@ -233,15 +236,40 @@ Mesh::Mesh(const char* _name, const wchar_t* _path)
 	// - The vector "indices" is similar. It's a vector of unsigned ints and
 	//    can be used directly for the index buffer: &indices[0] is the address of the first int
 	//
-	// - "vertCounter" is the number of vertices
-	// - "indexCounter" is the number of indices
-	// - Yes, these are effectively the same since OBJs do not index entire vertices!  This means
-	//    an index buffer isn't doing much for us.  We could try to optimize the mesh ourselves
-	//    and detect duplicate vertices, but at that point it would be better to use a more
-	//    sophisticated model loading library like TinyOBJLoader or The Open Asset Importer Library
-
-	CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
-	InitializeBuffers(&verts[0], vertCounter, &indices[0], indexCounter);
+	// - OBJs do not index entire vertices, so every triangle comes out with
+	//    3 unique vertices. Welding identical ones back together lets
+	//    neighboring triangles share them, so the index buffer actually saves
+	//    memory and vertex shader work
+	_data.UnweldedVertexCount = (unsigned int)verts.size();
+	MeshOptimizer::WeldVertices(verts, indices);
+	_data.UnoptimizedCacheStats = MeshOptimizer::AnalyzeVertexCache(&indices[0], indices.size(), verts.size());
+
+	// The triangle order from the file is arbitrary, so reorder triangles
+	// to reuse vertices while they're still in the post-transform cache,
+	// then reorder vertices so they're fetched in order
+	if (_processingFlags & MESH_OPTIMIZE_VERTEX_CACHE) {
+		MeshOptimizer::OptimizeVertexCache(indices, verts.size());
+		MeshOptimizer::OptimizeVertexFetch(verts, indices);
+	}
+	_data.CacheStats = MeshOptimizer::AnalyzeVertexCache(&indices[0], indices.size(), verts.size());
+
+	CalculateTangents(&verts[0], (int)verts.size(), &indices[0], (int)indices.size());
+	CalculateBounds(&verts[0], verts.size(), _data.BoxBounds, _data.SphereBounds);
+
+	// Save all that work for next time
+	MeshCacheHeader cacheHeader = {};
+	cacheHeader.UnweldedVertexCount = _data.UnweldedVertexCount;
+	cacheHeader.ProcessingFlags = _processingFlags;
+	cacheHeader.UnoptimizedACMR = _data.UnoptimizedCacheStats.ACMR;
+	cacheHeader.UnoptimizedATVR = _data.UnoptimizedCacheStats.ATVR;
+	cacheHeader.ACMR = _data.CacheStats.ACMR;
+	cacheHeader.ATVR = _data.CacheStats.ATVR;
+	XMStoreFloat3(&cacheHeader.BoundsMin, XMLoadFloat3(&_data.BoxBounds.Center) - XMLoadFloat3(&_data.BoxBounds.Extents));
+	XMStoreFloat3(&cacheHeader.BoundsMax, XMLoadFloat3(&_data.BoxBounds.Center) + XMLoadFloat3(&_data.BoxBounds.Extents));
+	cacheHeader.SphereCenter = _data.SphereBounds.Center;
+	cacheHeader.SphereRadius = _data.SphereBounds.Radius;
+	MeshCache::Save(_path, cacheHeader, &verts[0], verts.size(), &indices[0], indices.size());
+	return true;
 }
 
 // --------------------------------------------------------
@@ -269,10 +297,10 @@ void Mesh::Draw()
 		//  - For this demo, this step *could* simply be done once during Init()
 		//  - However, this needs to be done between EACH DrawIndexed() call
 		//     when drawing different geometry, so it's here as an example
-		UINT stride = sizeof(Vertex);
+		UINT stride = vertexStride;
 		UINT offset = 0;
 		Graphics::Context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-		Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+		Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), indexFormat, 0);
 
 		// Tell Direct3D to draw
 		//  - Begins the rendering pipeline on the GPU
@@ -287,6 +315,26 @@ void Mesh::Draw()
 	}
 }
 
+// --------------------------------------------------------
+// Binds relevant buffers for the Mesh and sends one
+// instanced draw call for a range of the instances in
+// the buffer bound to input slot 1
+// --------------------------------------------------------
+void Mesh::DrawInstanced(unsigned int _instanceCount, unsigned int _startInstance)
+{
+	UINT stride = vertexStride;
+	UINT offset = 0;
+	Graphics::Context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
+	Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), indexFormat, 0);
+
+	Graphics::Context->DrawIndexedInstanced(
+		indexCount,			// Indices per instance
+		_instanceCount,		// Number of instances to draw
+		0,					// Offset to the first index
+		0,					// Offset to add to each index
+		_startInstance);	// First instance in the instance buffer
+}
+
 // --------------------------------------------------------
 // Returns this Mesh's vertex buffer
 // --------------------------------------------------------
@@ -311,6 +359,15 @@ int Mesh::GetVertexCount()
 	return vertexCount;
 }
 
+// --------------------------------------------------------
+// Returns the number of vertices this mesh had before
+// duplicates were welded together
+// --------------------------------------------------------
+int Mesh::GetUnweldedVertexCount()
+{
+	return unweldedVertexCount;
+}
+
 // --------------------------------------------------------
 // Returns the number of indices this mesh has
 // --------------------------------------------------------
@@ -319,11 +376,232 @@ int Mesh::GetIndexCount()
 	return indexCount;
 }
 
+// --------------------------------------------------------
+// Returns the format of this mesh's index buffer
+// (16-bit whenever the vertex count allows it)
+// --------------------------------------------------------
+DXGI_FORMAT Mesh::GetIndexFormat()
+{
+	return indexFormat;
+}
+
 const char* Mesh::GetName()
 {
 	return name;
 }
 
+// --------------------------------------------------------
+// Returns timing info from loading this mesh's file
+// (all zeroes if it wasn't loaded from a file)
+// --------------------------------------------------------
+const ObjLoadStats& Mesh::GetLoadStats()
+{
+	return loadStats;
+}
+
+// --------------------------------------------------------
+// Returns whether this mesh was loaded from its binary
+// cache instead of being parsed from its source file
+// --------------------------------------------------------
+bool Mesh::IsCached()
+{
+	return isCached;
+}
+
+// --------------------------------------------------------
+// Returns how well this mesh's indices reuse vertices
+// in a simulated post-transform cache
+// --------------------------------------------------------
+const VertexCacheStats& Mesh::GetVertexCacheStats()
+{
+	return vertexCacheStats;
+}
+
+// --------------------------------------------------------
+// Returns how well this mesh's indices reused vertices
+// before they were optimized (same as the above if they
+// weren't optimized)
+// --------------------------------------------------------
+const VertexCacheStats& Mesh::GetUnoptimizedVertexCacheStats()
+{
+	return unoptimizedVertexCacheStats;
+}
+
+// --------------------------------------------------------
+// Returns whether this mesh's vertex buffer holds
+// PackedVertex instead of Vertex, meaning it has to be
+// drawn with a vertex shader that unpacks them
+// --------------------------------------------------------
+bool Mesh::IsPacked()
+{
+	return isPacked;
+}
+
+// --------------------------------------------------------
+// Returns the size of each vertex in the vertex buffer
+// --------------------------------------------------------
+unsigned int Mesh::GetVertexStride()
+{
+	return vertexStride;
+}
+
+// --------------------------------------------------------
+// Returns the scale and offset that turn this mesh's
+// packed positions back into local positions
+// --------------------------------------------------------
+const VertexQuantization& Mesh::GetQuantization()
+{
+	return quantization;
+}
+
+// --------------------------------------------------------
+// Returns how far this mesh's vertices moved when they
+// were packed (all zeroes if they weren't)
+// --------------------------------------------------------
+const VertexPackingError& Mesh::GetPackingError()
+{
+	return packingError;
+}
+
+// --------------------------------------------------------
+// Returns the axis-aligned box around this mesh's
+// vertices in local space
+// --------------------------------------------------------
+const BoundingBox& Mesh::GetBoxBounds()
+{
+	return boxBounds;
+}
+
+// --------------------------------------------------------
+// Returns the sphere around this mesh's vertices
+// in local space
+// --------------------------------------------------------
+const BoundingSphere& Mesh::GetSphereBounds()
+{
+	return sphereBounds;
+}
+
+// --------------------------------------------------------
+// Returns the small ID RenderQueue sort keys use to group
+// entities drawn with this mesh
+// --------------------------------------------------------
+unsigned int Mesh::GetSortID()
+{
+	return sortID;
+}
+
+void Mesh::SetSortID(unsigned int _sortID)
+{
+	sortID = _sortID;
+}
+
+// --------------------------------------------------------
+// Calculates the tangents of the vertices in a mesh, giving the
+// same results as CalculateTangentsScalar() (within rounding)
+//
+// - Triangles and vertices are processed four at a time with SIMD
+// - If _allowThreads is set, big meshes are split into one chunk
+//   of triangles per thread. Each chunk sums tangents into its own
+//   array, so threads never write to the same vertex, and the
+//   arrays are added together afterwards
+// --------------------------------------------------------
+void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices, bool _allowThreads)
+{
+	size_t vertexCount = (size_t)numVerts;
+	size_t triangleCount = (size_t)numIndices / 3;
+	if (vertexCount == 0)
+		return;
+
+	// Threads are only worth it if each one gets plenty of triangles,
+	// and can't help if this is already running on a worker
+	WorkerPool& pool = WorkerPool::Global();
+	size_t chunkCount = 1;
+	if (_allowThreads && !WorkerPool::IsInsideJob()) {
+		chunkCount = triangleCount / TANGENT_MIN_TRIANGLES_PER_THREAD;
+		chunkCount = chunkCount < pool.GetThreadCount() ? chunkCount : pool.GetThreadCount();
+		chunkCount = chunkCount > 1 ? chunkCount : 1;
+	}
+
+	// Sum every triangle's tangent into its vertices
+	std::vector<std::vector<XMFLOAT3>> sums(chunkCount, std::vector<XMFLOAT3>(vertexCount, XMFLOAT3(0, 0, 0)));
+	pool.ParallelFor(chunkCount, [&](size_t chunk) {
+		AccumulateTangents(verts, indices,
+			triangleCount * chunk / chunkCount,
+			triangleCount * (chunk + 1) / chunkCount,
+			sums[chunk].data());
+	});
+
+	// Combine each chunk's sums, then ensure all of the
+	// tangents are orthogonal to the normals
+	pool.ParallelFor(chunkCount, [&](size_t chunk) {
+		size_t first = vertexCount * chunk / chunkCount;
+		size_t last = vertexCount * (chunk + 1) / chunkCount;
+		for (size_t other = 1; other < chunkCount; other++) {
+			for (size_t i = first; i < last; i++) {
+				XMStoreFloat3(&sums[0][i], XMLoadFloat3(&sums[0][i]) + XMLoadFloat3(&sums[other][i]));
+			}
+		}
+		OrthonormalizeTangents(verts, sums[0].data(), first, last);
+	});
+}
+
+/// <summary>
+/// Finds the local-space bounding box and sphere of a set of vertices
+/// </summary>
+/// <param name="_vertices">An array of vertices</param>
+/// <param name="_vertexCount">The number of vertices in the array</param>
+/// <param name="_box">Box the bounds are written to</param>
+/// <param name="_sphere">Sphere the bounds are written to</param>
+void Mesh::CalculateBounds(const Vertex* _vertices, size_t _vertexCount, BoundingBox& _box, BoundingSphere& _sphere)
+{
+	_box = BoundingBox(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0));
+	_sphere = BoundingSphere(XMFLOAT3(0, 0, 0), 0.0f);
+	if (_vertexCount == 0)
+		return;
+
+	BoundingBox::CreateFromPoints(_box, _vertexCount, &_vertices[0].Position, sizeof(Vertex));
+
+	// Centering the sphere on the box and reaching out to the farthest
+	// vertex is tighter than the box's own bounding sphere, and
+	// (unlike BoundingSphere::CreateFromPoints) exact for that center
+	XMVECTOR center = XMLoadFloat3(&_box.Center);
+	XMVECTOR maxDistanceSquared = XMVectorZero();
+	for (size_t i = 0; i < _vertexCount; i++) {
+		maxDistanceSquared = XMVectorMax(maxDistanceSquared, XMVector3LengthSq(XMLoadFloat3(&_vertices[i].Position) - center));
+	}
+	_sphere.Center = _box.Center;
+	_sphere.Radius = XMVectorGetX(XMVectorSqrt(maxDistanceSquared));
+}
+
+// --------------------------------------------------------
+// Loads a mesh's source file and calculates its tangents
+// with both CalculateTangents() and the original
+// CalculateTangentsScalar(), to check they still match
+//
+// Returns the largest distance between the two versions of
+// any vertex's tangent, or a negative number if the file
+// couldn't be loaded
+// --------------------------------------------------------
+float Mesh::MeasureTangentError(const wchar_t* _path)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	if (!ObjLoader::Load(_path, verts, indices) || verts.empty())
+		return -1.0f;
+	MeshOptimizer::WeldVertices(verts, indices);
+
+	std::vector<Vertex> reference = verts;
+	CalculateTangents(&verts[0], (int)verts.size(), &indices[0], (int)indices.size());
+	CalculateTangentsScalar(&reference[0], (int)reference.size(), &indices[0], (int)indices.size());
+
+	float maxDifference = 0.0f;
+	for (size_t i = 0; i < verts.size(); i++) {
+		XMVECTOR difference = XMLoadFloat3(&verts[i].Tangent) - XMLoadFloat3(&reference[i].Tangent);
+		maxDifference = fmaxf(maxDifference, XMVectorGetX(XMVector3Length(difference)));
+	}
+	return maxDifference;
+}
+
 // --------------------------------------------------------
 // Author: Chris Cascioli
 // Purpose: Calculates the tangents of the vertices in a mesh
@@ -340,8 +618,11 @@ const char* Mesh::GetName()
 //         contain an XMFLOAT3 called Tangent
 //
 // - Be sure to call this BEFORE creating your D3D vertex/index buffers
+//
+// - This is the original version, which CalculateTangents() is
+//   checked against by MeasureTangentError()
 // --------------------------------------------------------
-void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+void Mesh::CalculateTangentsScalar(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
 {
 	// Reset tangents
 	for (int i = 0; i < numVerts; i++)
@@ -414,31 +695,66 @@ void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices,
 	}
 }
 
+/// <summary>
+/// Creates this Mesh's GPU buffers from decoded data
+/// </summary>
+/// <param name="_data">Data decoded by Mesh::Decode()</param>
+void Mesh::Upload(const MeshData& _data)
+{
+	vertexCount = 0;
+	indexCount = 0;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	unweldedVertexCount = _data.UnweldedVertexCount;
+	loadStats = _data.LoadStats;
+	isCached = _data.IsCached;
+	vertexCacheStats = _data.CacheStats;
+	unoptimizedVertexCacheStats = _data.UnoptimizedCacheStats;
+	isPacked = !_data.PackedVertices.empty();
+	vertexStride = sizeof(Vertex);
+	quantization = _data.Quantization;
+	packingError = _data.PackingError;
+	boxBounds = _data.BoxBounds;
+	sphereBounds = _data.SphereBounds;
+	sortID = 0;
+
+	// Nothing to upload if the file couldn't be loaded
+	if (_data.GetVertexCount() == 0)
+		return;
+
+	if (isPacked) {
+		InitializeBuffers(_data.PackedVertices.data(), sizeof(PackedVertex), (unsigned int)_data.GetVertexCount(), _data.GetIndices(), (unsigned int)_data.GetIndexCount());
+		return;
+	}
+	InitializeBuffers(_data.GetVertices(), sizeof(Vertex), (unsigned int)_data.GetVertexCount(), _data.GetIndices(), (unsigned int)_data.GetIndexCount());
+}
+
 // Code migrated from Game::CreateGeometry()
 
 /// <summary>
 /// Initializes a vertex and index buffer given arrays of vertices/indices
 /// </summary>
 /// <param name="_vertices">An array of vertices</param>
+/// <param name="_vertexStride">The size of each vertex (sizeof(Vertex) or sizeof(PackedVertex))</param>
 /// <param name="_vertexCount">The number of vertices in the array</param>
 /// <param name="_indices">An array of indices</param>
 /// <param name="_indexCount">The number of indices in the array</param>
-void Mesh::InitializeBuffers(Vertex* _vertices, unsigned int _vertexCount, unsigned int* _indices, unsigned int _indexCount)
+void Mesh::InitializeBuffers(const void* _vertices, unsigned int _vertexStride, unsigned int _vertexCount, const unsigned int* _indices, unsigned int _indexCount)
 {
 	// Create a VERTEX BUFFER
 	// - This holds the vertex data of triangles for a single object
 	// - This buffer is created on the GPU, which is where the data needs to
 	//    be if we want the GPU to act on it (as in: draw it to the screen)
 
-	// Record number of vertices in this mesh
+	// Record number and size of vertices in this mesh
 	vertexCount = _vertexCount;
+	vertexStride = _vertexStride;
 
 	// First, we need to describe the buffer we want Direct3D to make on the GPU
 	//  - Note that this variable is created on the stack since we only need it once
 	//  - After the buffer is created, this description variable is unnecessary
 	D3D11_BUFFER_DESC vbd = {};
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-	vbd.ByteWidth = sizeof(Vertex) * vertexCount;       // 3 = number of vertices in the buffer
+	vbd.ByteWidth = vertexStride * vertexCount;       // 3 = number of vertices in the buffer
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells Direct3D this is a vertex buffer
 	vbd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
 	vbd.MiscFlags = 0;
@@ -465,12 +781,26 @@ void Mesh::InitializeBuffers(Vertex* _vertices, unsigned int _vertexCount, unsig
 	// Record number of indices
 	indexCount = _indexCount;
 
+	// If every index fits in 16 bits, store them that way to
+	// halve the buffer's size and the bandwidth used reading it
+	// - 0xFFFF is left out since it's the strip cut value
+	std::vector<unsigned short> shortIndices;
+	const void* indexData = _indices;
+	unsigned int indexSize = sizeof(unsigned int);
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	if (vertexCount <= 0xFFFF) {
+		shortIndices.assign(_indices, _indices + indexCount);
+		indexData = shortIndices.data();
+		indexSize = sizeof(unsigned short);
+		indexFormat = DXGI_FORMAT_R16_UINT;
+	}
+
 	// Describe the buffer, as we did above, with two major differences
-	//  - Byte Width (3 unsigned integers vs. 3 whole vertices)
+	//  - Byte Width (3 indices vs. 3 whole vertices)
 	//  - Bind Flag (used as an index buffer instead of a vertex buffer) 
 	D3D11_BUFFER_DESC ibd = {};
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-	ibd.ByteWidth = sizeof(unsigned int) * indexCount;	// 3 = number of indices in the buffer
+	ibd.ByteWidth = indexSize * indexCount;	// 3 = number of indices in the buffer
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;	// Tells Direct3D this is an index buffer
 	ibd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
 	ibd.MiscFlags = 0;
@@ -478,9 +808,43 @@ void Mesh::InitializeBuffers(Vertex* _vertices, unsigned int _vertexCount, unsig
 
 	// Specify the initial data for this buffer, similar to above
 	D3D11_SUBRESOURCE_DATA initialIndexData = {};
-	initialIndexData.pSysMem = _indices; // pSysMem = Pointer to System Memory
+	initialIndexData.pSysMem = indexData; // pSysMem = Pointer to System Memory
 
 	// Actually create the buffer with the initial data
 	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
 	Graphics::Device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
 }
+
+// --------------------------------------------------------
+// Returns the number of decoded vertices
+// --------------------------------------------------------
+size_t MeshData::GetVertexCount() const
+{
+	return IsCached ? Cache.Header->VertexCount : Vertices.size();
+}
+
+// --------------------------------------------------------
+// Returns the number of decoded indices
+// --------------------------------------------------------
+size_t MeshData::GetIndexCount() const
+{
+	return IsCached ? Cache.Header->IndexCount : Indices.size();
+}
+
+// --------------------------------------------------------
+// Returns the decoded vertices, which point into the
+// mapped cache file if that's where they came from
+// --------------------------------------------------------
+const Vertex* MeshData::GetVertices() const
+{
+	return IsCached ? Cache.Vertices : Vertices.data();
+}
+
+// --------------------------------------------------------
+// Returns the decoded indices, which point into the
+// mapped cache file if that's where they came from
+// --------------------------------------------------------
+const unsigned int* MeshData::GetIndices() const
+{
+	return IsCached ? Cache.Indices : Indices.data();
+}
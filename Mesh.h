@@ -1,26 +1,93 @@
 #pragma once
 
 #include <d3d11.h>
+#include <DirectXCollision.h>
 #include <wrl/client.h>
 
+#include <vector>
+
 #include "Graphics.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
 #include "Vertex.h"
+#include "VertexPacking.h"
+
+// A mesh that's been loaded and processed on the CPU,
+// but doesn't have any GPU resources yet
+struct MeshData
+{
+	// Processed vertices and indices, unless the mesh came from its cache
+	std::vector<Vertex> Vertices;
+	std::vector<unsigned int> Indices;
+
+	// The mapped cache the mesh came from, if it did
+	bool IsCached = false;
+	MappedFile CacheFile;
+	MeshCacheData Cache = {};
+
+	unsigned int UnweldedVertexCount = 0;
+	ObjLoadStats LoadStats = {};
+
+	// How well the indices use the vertex cache, before and after optimizing
+	VertexCacheStats UnoptimizedCacheStats = {};
+	VertexCacheStats CacheStats = {};
+
+	// Local-space bounds of the vertices
+	DirectX::BoundingBox BoxBounds;
+	DirectX::BoundingSphere SphereBounds;
+
+	// Compressed copies of the vertices, if MESH_OPTIMIZE_PACK_VERTICES was set
+	std::vector<PackedVertex> PackedVertices;
+	VertexQuantization Quantization = {};
+	VertexPackingError PackingError = {};
+
+	// Number of vertices/indices and pointers to them, wherever they came from
+	size_t GetVertexCount() const;
+	size_t GetIndexCount() const;
+	const Vertex* GetVertices() const;
+	const unsigned int* GetIndices() const;
+};
 
 class Mesh
 {
 public:
 	// Constructors/Destructor
 	Mesh(const char* _name, Vertex* _vertices, size_t _vertexCount, unsigned int* _indices, size_t _indexCount);
-	Mesh(const char* _name, const wchar_t* _path);
+	Mesh(const char* _name, const wchar_t* _path, unsigned int _processingFlags = MESH_OPTIMIZE_VERTEX_CACHE);
+	Mesh(const char* _name, const MeshData& _data);
 	~Mesh();
+	// Loads and processes a mesh file without touching the GPU,
+	// so it's safe to run on any thread
+	static bool Decode(const wchar_t* _path, MeshData& _data, unsigned int _processingFlags = MESH_OPTIMIZE_VERTEX_CACHE);
+	// Checks the fast tangent code against the original on a mesh file
+	static float MeasureTangentError(const wchar_t* _path);
 	// Draws Mesh to screen
 	void Draw();
+	// Draws many copies of the Mesh, using the instance
+	// data already bound to input slot 1
+	void DrawInstanced(unsigned int _instanceCount, unsigned int _startInstance);
 	// Accessors for Mesh info
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
 	int GetVertexCount();
+	int GetUnweldedVertexCount();
 	int GetIndexCount();
+	DXGI_FORMAT GetIndexFormat();
 	const char* GetName();
+	const ObjLoadStats& GetLoadStats();
+	bool IsCached();
+	const VertexCacheStats& GetVertexCacheStats();
+	const VertexCacheStats& GetUnoptimizedVertexCacheStats();
+	bool IsPacked();
+	unsigned int GetVertexStride();
+	const VertexQuantization& GetQuantization();
+	const VertexPackingError& GetPackingError();
+	const DirectX::BoundingBox& GetBoxBounds();
+	const DirectX::BoundingSphere& GetSphereBounds();
+	// Small ID for RenderQueue sort keys, given out by whoever owns the Mesh
+	unsigned int GetSortID();
+	void SetSortID(unsigned int _sortID);
 
 private:
 	// Vertex and index buffers, as well as the size of each
@@ -28,13 +95,44 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
 	unsigned int vertexCount;
 	unsigned int indexCount;
+	// Format of the index buffer (16 or 32-bit)
+	DXGI_FORMAT indexFormat;
+	// Number of vertices before duplicates were welded
+	unsigned int unweldedVertexCount;
 
 	// Name for UI
 	const char* name;
+	// How long the source file took to load, if there was one
+	ObjLoadStats loadStats;
+	// Whether the mesh came from its binary cache
+	bool isCached;
+	// How well the indices use the vertex cache, before and after optimizing
+	VertexCacheStats vertexCacheStats;
+	VertexCacheStats unoptimizedVertexCacheStats;
+	// Whether the vertex buffer holds PackedVertex instead of Vertex,
+	// and what's needed to unpack its positions in the vertex shader
+	bool isPacked;
+	unsigned int vertexStride;
+	VertexQuantization quantization;
+	// How much precision packing lost
+	VertexPackingError packingError;
+	// Local-space bounds of the vertices
+	DirectX::BoundingBox boxBounds;
+	DirectX::BoundingSphere sphereBounds;
+	// Small ID for RenderQueue sort keys
+	unsigned int sortID;
 
 	// Code for calculating tangents
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	static void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices, bool _allowThreads = true);
+	// Original one-triangle-at-a-time version, used to check the one above
+	static void CalculateTangentsScalar(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	// Code for finding the bounds of a set of vertices
+	static void CalculateBounds(const Vertex* _vertices, size_t _vertexCount, DirectX::BoundingBox& _box, DirectX::BoundingSphere& _sphere);
+	// Code for loading a mesh's source file when its cache can't be used
+	static bool DecodeSource(const wchar_t* _path, MeshData& _data, unsigned int _processingFlags);
+	// Code for creating a Mesh from decoded data
+	void Upload(const MeshData& _data);
 	// Code for creating vertex and index buffers
-	void InitializeBuffers(Vertex* _vertices, unsigned int _vertexCount, unsigned int* _indices, unsigned int _indexCount);
+	void InitializeBuffers(const void* _vertices, unsigned int _vertexStride, unsigned int _vertexCount, const unsigned int* _indices, unsigned int _indexCount);
 };
 
@@ -0,0 +1,194 @@
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+
+#include "MeshCache.h"
+
+namespace
+{
+	// Size and timestamp of a source file, used for quick validity checks
+	struct SourceInfo
+	{
+		uint64_t Size;
+		int64_t Time;
+	};
+
+	bool GetSourceInfo(const wchar_t* _sourcePath, SourceInfo& _info)
+	{
+		std::error_code error;
+		std::filesystem::path path(_sourcePath);
+
+		uintmax_t size = std::filesystem::file_size(path, error);
+		if (error) return false;
+		auto time = std::filesystem::last_write_time(path, error);
+		if (error) return false;
+
+		_info.Size = (uint64_t)size;
+		_info.Time = (int64_t)time.time_since_epoch().count();
+		return true;
+	}
+
+	// Hashes a source file's entire contents
+	bool HashSourceFile(const wchar_t* _sourcePath, uint64_t& _hash)
+	{
+		MappedFile source;
+		if (!source.Open(_sourcePath)) return false;
+
+		_hash = MeshCache::Hash(source.GetData(), source.GetSize());
+		return true;
+	}
+
+	// Rewrites the source timestamp in a cache's header, so the
+	// next load can trust the size and timestamp without hashing
+	bool UpdateSourceTime(const wchar_t* _cachePath, int64_t _time)
+	{
+		std::fstream file(std::filesystem::path(_cachePath), std::ios::in | std::ios::out | std::ios::binary);
+		if (!file.is_open()) return false;
+
+		file.seekp(offsetof(MeshCacheHeader, SourceTime));
+		file.write((const char*)&_time, sizeof(_time));
+		return file.good();
+	}
+}
+
+/// <summary>
+/// Gets the path a source file's cache is stored at
+/// </summary>
+/// <param name="_sourcePath">Path to the source file</param>
+/// <returns>The source path with ".meshcache" appended</returns>
+std::wstring MeshCache::GetCachePath(const wchar_t* _sourcePath)
+{
+	return std::wstring(_sourcePath) + L".meshcache";
+}
+
+/// <summary>
+/// Maps a source file's cache, if there is one and it still matches the source
+/// </summary>
+/// <param name="_sourcePath">Path to the source file</param>
+/// <param name="_processingFlags">MESH_OPTIMIZE_* flags the cached mesh must have been processed with</param>
+/// <param name="_file">MappedFile that keeps the cache mapped</param>
+/// <param name="_data">Pointers to the contents of the cache</param>
+/// <returns>Whether a valid cache was found and mapped</returns>
+bool MeshCache::Load(const wchar_t* _sourcePath, uint32_t _processingFlags, MappedFile& _file, MeshCacheData& _data)
+{
+	std::wstring cachePath = GetCachePath(_sourcePath);
+	if (!_file.Open(cachePath.c_str())) {
+		return false;
+	}
+
+	// Check that the file is a cache this build can read
+	const MeshCacheHeader* header = (const MeshCacheHeader*)_file.GetData();
+	if (_file.GetSize() < sizeof(MeshCacheHeader)
+		|| header->Magic != MESH_CACHE_MAGIC
+		|| header->Version != MESH_CACHE_VERSION
+		|| header->VertexStride != sizeof(Vertex)
+		|| header->ProcessingFlags != _processingFlags
+		|| _file.GetSize() != sizeof(MeshCacheHeader)
+			+ (size_t)header->VertexCount * sizeof(Vertex)
+			+ (size_t)header->IndexCount * sizeof(unsigned int)) {
+		_file.Close();
+		return false;
+	}
+
+	// Check that the source hasn't changed since the cache was written.
+	// If the source is missing entirely, the cache is all there is
+	SourceInfo info = {};
+	if (GetSourceInfo(_sourcePath, info)
+		&& (info.Size != header->SourceSize || info.Time != header->SourceTime)) {
+		// A new timestamp doesn't always mean new contents
+		// (e.g. after a fresh checkout), so check those too
+		uint64_t hash = 0;
+		if (info.Size != header->SourceSize
+			|| !HashSourceFile(_sourcePath, hash)
+			|| hash != header->SourceHash) {
+			_file.Close();
+			return false;
+		}
+
+		// Only the timestamp changed, so store the new one and skip
+		// hashing next time. The cache can't be written while it's
+		// mapped, so it's unmapped and mapped again around the write
+		_file.Close();
+		UpdateSourceTime(cachePath.c_str(), info.Time);
+		if (!_file.Open(cachePath.c_str()) || _file.GetSize() < sizeof(MeshCacheHeader)) {
+			_file.Close();
+			return false;
+		}
+		header = (const MeshCacheHeader*)_file.GetData();
+	}
+
+	_data.Header = header;
+	_data.Vertices = (const Vertex*)(_file.GetData() + sizeof(MeshCacheHeader));
+	_data.Indices = (const unsigned int*)(_data.Vertices + header->VertexCount);
+	return true;
+}
+
+/// <summary>
+/// Writes processed mesh data to a source file's cache, replacing any existing cache
+/// </summary>
+/// <param name="_sourcePath">Path to the source file the data was loaded from</param>
+/// <param name="_header">Header with the fields describing how the mesh was processed and its bounds filled in</param>
+/// <param name="_vertices">Array of processed vertices</param>
+/// <param name="_vertexCount">Number of vertices in the array</param>
+/// <param name="_indices">Array of indices</param>
+/// <param name="_indexCount">Number of indices in the array</param>
+/// <returns>Whether the cache was written</returns>
+bool MeshCache::Save(const wchar_t* _sourcePath, const MeshCacheHeader& _header, const Vertex* _vertices, size_t _vertexCount, const unsigned int* _indices, size_t _indexCount)
+{
+	SourceInfo info = {};
+	MeshCacheHeader header = _header;
+	if (!GetSourceInfo(_sourcePath, info) || !HashSourceFile(_sourcePath, header.SourceHash)) {
+		return false;
+	}
+
+	header.Magic = MESH_CACHE_MAGIC;
+	header.Version = MESH_CACHE_VERSION;
+	header.VertexStride = sizeof(Vertex);
+	header.VertexCount = (uint32_t)_vertexCount;
+	header.IndexCount = (uint32_t)_indexCount;
+	header.Padding = 0;
+	header.SourceSize = info.Size;
+	header.SourceTime = info.Time;
+
+	// Write to a temporary file first so a crash halfway
+	// through can never leave a truncated cache behind
+	std::filesystem::path cachePath(GetCachePath(_sourcePath));
+	std::filesystem::path tempPath(cachePath);
+	tempPath += L".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) {
+			return false;
+		}
+
+		out.write((const char*)&header, sizeof(MeshCacheHeader));
+		out.write((const char*)_vertices, _vertexCount * sizeof(Vertex));
+		out.write((const char*)_indices, _indexCount * sizeof(unsigned int));
+		if (!out.good()) {
+			out.close();
+			std::error_code error;
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, cachePath, error);
+	return !error;
+}
+
+/// <summary>
+/// Hashes a block of memory with 64-bit FNV-1a
+/// </summary>
+/// <param name="_data">Start of the memory to hash</param>
+/// <param name="_size">Number of bytes to hash</param>
+/// <returns>The hash of the memory</returns>
+uint64_t MeshCache::Hash(const char* _data, size_t _size)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < _size; i++) {
+		hash ^= (unsigned char)_data[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
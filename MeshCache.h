@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "MappedFile.h"
+#include "Vertex.h"
+
+// Header at the start of every .meshcache file, followed
+// directly by the vertex array and then the index array
+struct MeshCacheHeader
+{
+	uint32_t Magic;					// Always MESH_CACHE_MAGIC
+	uint32_t Version;				// Always MESH_CACHE_VERSION
+	uint32_t VertexStride;			// sizeof(Vertex) when the file was written
+	uint32_t VertexCount;			// Number of vertices in the vertex array
+	uint32_t IndexCount;			// Number of (32-bit) indices in the index array
+	uint32_t UnweldedVertexCount;	// Number of vertices before welding
+	uint32_t ProcessingFlags;		// MESH_OPTIMIZE_* flags the mesh was processed with
+	float UnoptimizedACMR;			// Vertex cache stats before optimizing
+	float UnoptimizedATVR;
+	float ACMR;						// Vertex cache stats after optimizing
+	float ATVR;
+	uint32_t Padding;
+
+	uint64_t SourceSize;			// Size of the source file in bytes
+	int64_t SourceTime;				// Last write time of the source file
+	uint64_t SourceHash;			// FNV-1a hash of the source file's contents
+
+	DirectX::XMFLOAT3 BoundsMin;	// Minimum corner of the local-space bounding box
+	DirectX::XMFLOAT3 BoundsMax;	// Maximum corner of the local-space bounding box
+	DirectX::XMFLOAT3 SphereCenter;	// Center of the local-space bounding sphere
+	float SphereRadius;				// Radius of the local-space bounding sphere
+};
+
+// Pointers into a mapped .meshcache file
+struct MeshCacheData
+{
+	const MeshCacheHeader* Header;
+	const Vertex* Vertices;
+	const unsigned int* Indices;
+};
+
+// --------------------------------------------------------
+// Binary cache of fully processed mesh data, stored next
+// to its source file with ".meshcache" appended
+//
+// A cache is valid as long as its source file has the same
+// size and timestamp, or the same contents if only the
+// timestamp changed (the new timestamp is then written
+// back, so the contents are only hashed once). Bump MESH_CACHE_VERSION whenever the
+// way meshes are processed after loading changes, so old
+// caches are rebuilt.
+// --------------------------------------------------------
+namespace MeshCache
+{
+	const uint32_t MESH_CACHE_MAGIC = 0x4853454D; // "MESH"
+	const uint32_t MESH_CACHE_VERSION = 4;
+
+	// Gets the path a source file's cache is stored at
+	std::wstring GetCachePath(const wchar_t* _sourcePath);
+
+	// Maps a source file's cache if it exists, is up to date and was
+	// processed the same way. The data stays valid for as long as _file stays open
+	bool Load(const wchar_t* _sourcePath, uint32_t _processingFlags, MappedFile& _file, MeshCacheData& _data);
+
+	// Writes processed mesh data to a source file's cache. Fields of _header
+	// describing how the mesh was processed and its bounds are written as given,
+	// and the rest (source info, counts) are filled in here
+	bool Save(const wchar_t* _sourcePath, const MeshCacheHeader& _header, const Vertex* _vertices, size_t _vertexCount, const unsigned int* _indices, size_t _indexCount);
+
+	// Hashes a block of memory (64-bit FNV-1a)
+	uint64_t Hash(const char* _data, size_t _size);
+}
@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "MeshOptimizer.h"
+
+namespace
+{
+	// The attributes that make two vertices identical, stored as raw bits
+	// so comparisons are exact and hashing doesn't touch the FPU. Tangents
+	// are left out since they're calculated after welding
+	struct VertexKey
+	{
+		uint32_t Bits[8];
+	};
+
+	// Gets a float's bits, treating -0.0 the same as 0.0
+	inline uint32_t FloatBits(float _value)
+	{
+		_value += 0.0f;
+		uint32_t bits;
+		memcpy(&bits, &_value, sizeof(bits));
+		return bits;
+	}
+
+	inline VertexKey MakeKey(const Vertex& _vertex)
+	{
+		VertexKey key;
+		key.Bits[0] = FloatBits(_vertex.Position.x);
+		key.Bits[1] = FloatBits(_vertex.Position.y);
+		key.Bits[2] = FloatBits(_vertex.Position.z);
+		key.Bits[3] = FloatBits(_vertex.Normal.x);
+		key.Bits[4] = FloatBits(_vertex.Normal.y);
+		key.Bits[5] = FloatBits(_vertex.Normal.z);
+		key.Bits[6] = FloatBits(_vertex.UV.x);
+		key.Bits[7] = FloatBits(_vertex.UV.y);
+		return key;
+	}
+
+	// MurmurHash3-style mixing of each word
+	inline uint32_t HashKey(const VertexKey& _key)
+	{
+		uint32_t hash = 0x9747b28c;
+		for (int i = 0; i < 8; i++) {
+			uint32_t k = _key.Bits[i] * 0xcc9e2d51;
+			k = (k << 15) | (k >> 17);
+			hash ^= k * 0x1b873593;
+			hash = ((hash << 13) | (hash >> 19)) * 5 + 0xe6546b64;
+		}
+		hash ^= hash >> 16;
+		hash *= 0x85ebca6b;
+		hash ^= hash >> 13;
+		return hash;
+	}
+}
+
+/// <summary>
+/// Merges vertices whose position, normal and UV are bitwise identical,
+/// so triangles share vertices instead of each having their own three
+/// </summary>
+/// <param name="_vertices">List of vertices, which is compacted in place</param>
+/// <param name="_indices">List of indices, which is remapped to the compacted vertices</param>
+/// <returns>The number of vertices left after welding</returns>
+size_t MeshOptimizer::WeldVertices(std::vector<Vertex>& _vertices, std::vector<unsigned int>& _indices)
+{
+	const unsigned int empty = 0xFFFFFFFF;
+
+	// Open-addressed hash table of indices into the welded vertex list,
+	// kept at most half full so probe sequences stay short
+	size_t tableSize = 16;
+	while (tableSize < _vertices.size() * 2) tableSize *= 2;
+	std::vector<unsigned int> table(tableSize, empty);
+	std::vector<VertexKey> weldedKeys;
+	weldedKeys.reserve(_vertices.size());
+
+	// Maps each original vertex to its welded one
+	std::vector<unsigned int> remap(_vertices.size());
+	size_t weldedCount = 0;
+
+	for (size_t i = 0; i < _vertices.size(); i++) {
+		VertexKey key = MakeKey(_vertices[i]);
+		size_t slot = HashKey(key) & (tableSize - 1);
+
+		// Linear probe until this vertex or an empty slot is found
+		while (table[slot] != empty && memcmp(&weldedKeys[table[slot]], &key, sizeof(VertexKey)) != 0) {
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		if (table[slot] == empty) {
+			// First time seeing this vertex, so move it to the end of the welded list
+			table[slot] = (unsigned int)weldedCount;
+			weldedKeys.push_back(key);
+			_vertices[weldedCount] = _vertices[i];
+			weldedCount++;
+		}
+
+		remap[i] = table[slot];
+	}
+
+	for (unsigned int& index : _indices) {
+		index = remap[index];
+	}
+
+	_vertices.resize(weldedCount);
+	return weldedCount;
+}
+
+namespace
+{
+	// Tuning values from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+	const int forsythCacheSize = 32;
+	const float forsythCacheDecayPower = 1.5f;
+	const float forsythLastTriangleScore = 0.75f;
+	const float forsythValenceBoostScale = 2.0f;
+	const float forsythValenceBoostPower = 0.5f;
+
+	// Scores how much a vertex wants to be used next, based on its
+	// position in the simulated cache and how many triangles still use it
+	float ForsythVertexScore(int _cachePosition, unsigned int _activeTriangles)
+	{
+		// Vertices no triangle needs anymore are worthless
+		if (_activeTriangles == 0) {
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (_cachePosition >= 0) {
+			if (_cachePosition < 3) {
+				// Used by the last triangle, so it gets a fixed score to
+				// avoid favoring the same triangle's edges over and over
+				score = forsythLastTriangleScore;
+			}
+			else {
+				// Falls off the further back in the cache it is
+				float scaler = 1.0f / (forsythCacheSize - 3);
+				score = powf(1.0f - (_cachePosition - 3) * scaler, forsythCacheDecayPower);
+			}
+		}
+
+		// Boost vertices with few triangles left so they get finished
+		// off instead of leaving lone triangles behind for later
+		score += forsythValenceBoostScale * powf((float)_activeTriangles, -forsythValenceBoostPower);
+		return score;
+	}
+}
+
+/// <summary>
+/// Reorders triangles to make the best use of the GPU's post-transform
+/// vertex cache, using Tom Forsyth's greedy scoring algorithm
+/// </summary>
+/// <param name="_indices">List of triangle indices, which is reordered in place</param>
+/// <param name="_vertexCount">Number of vertices the indices refer to</param>
+void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& _indices, size_t _vertexCount)
+{
+	size_t triangleCount = _indices.size() / 3;
+	if (triangleCount == 0 || _vertexCount == 0) {
+		return;
+	}
+
+	// Build a list of the triangles that use each vertex
+	std::vector<unsigned int> activeTriangles(_vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++) {
+		activeTriangles[_indices[i]]++;
+	}
+
+	std::vector<unsigned int> triangleOffsets(_vertexCount);
+	unsigned int offset = 0;
+	for (size_t v = 0; v < _vertexCount; v++) {
+		triangleOffsets[v] = offset;
+		offset += activeTriangles[v];
+	}
+
+	std::vector<unsigned int> vertexTriangles(triangleCount * 3);
+	std::vector<unsigned int> fillCounts(_vertexCount, 0);
+	for (size_t t = 0; t < triangleCount; t++) {
+		for (int c = 0; c < 3; c++) {
+			unsigned int v = _indices[t * 3 + c];
+			vertexTriangles[triangleOffsets[v] + fillCounts[v]++] = (unsigned int)t;
+		}
+	}
+
+	// Initial scores, with nothing in the cache yet
+	std::vector<int> cachePositions(_vertexCount, -1);
+	std::vector<float> vertexScores(_vertexCount);
+	for (size_t v = 0; v < _vertexCount; v++) {
+		vertexScores[v] = ForsythVertexScore(-1, activeTriangles[v]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> isTriangleAdded(triangleCount, false);
+	int bestTriangle = -1;
+	float bestScore = -1.0f;
+	for (size_t t = 0; t < triangleCount; t++) {
+		triangleScores[t] =
+			vertexScores[_indices[t * 3]] +
+			vertexScores[_indices[t * 3 + 1]] +
+			vertexScores[_indices[t * 3 + 2]];
+
+		if (triangleScores[t] > bestScore) {
+			bestScore = triangleScores[t];
+			bestTriangle = (int)t;
+		}
+	}
+
+	// The simulated cache, with room for the 3 vertices pushing others out
+	unsigned int cache[forsythCacheSize + 3];
+	unsigned int newCache[forsythCacheSize + 3];
+	int cacheCount = 0;
+
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+	size_t searchStart = 0;
+
+	for (size_t added = 0; added < triangleCount; added++) {
+		// If nothing in the cache has triangles left, start
+		// again from the next triangle that hasn't been added
+		if (bestTriangle < 0) {
+			while (isTriangleAdded[searchStart]) searchStart++;
+			bestTriangle = (int)searchStart;
+		}
+
+		// Add the best triangle to the output
+		const unsigned int* triangle = &_indices[bestTriangle * 3];
+		output.push_back(triangle[0]);
+		output.push_back(triangle[1]);
+		output.push_back(triangle[2]);
+		isTriangleAdded[bestTriangle] = true;
+
+		// Remove it from each of its vertices' lists of active triangles
+		for (int c = 0; c < 3; c++) {
+			unsigned int v = triangle[c];
+			unsigned int* list = &vertexTriangles[triangleOffsets[v]];
+			for (unsigned int i = 0; i < activeTriangles[v]; i++) {
+				if (list[i] == (unsigned int)bestTriangle) {
+					list[i] = list[activeTriangles[v] - 1];
+					activeTriangles[v]--;
+					break;
+				}
+			}
+		}
+
+		// Move its vertices to the front of the cache, keeping
+		// the order of everything else
+		int newCacheCount = 0;
+		for (int c = 0; c < 3; c++) {
+			bool isDuplicate = false;
+			for (int i = 0; i < newCacheCount; i++) {
+				isDuplicate |= newCache[i] == triangle[c];
+			}
+			if (!isDuplicate) {
+				newCache[newCacheCount++] = triangle[c];
+			}
+		}
+		for (int i = 0; i < cacheCount; i++) {
+			unsigned int v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+				newCache[newCacheCount++] = v;
+			}
+		}
+
+		// Rescore every vertex that was or still is in the cache,
+		// passing the change in score on to their triangles
+		for (int i = 0; i < newCacheCount; i++) {
+			unsigned int v = newCache[i];
+			cachePositions[v] = i < forsythCacheSize ? i : -1;
+
+			float newScore = ForsythVertexScore(cachePositions[v], activeTriangles[v]);
+			float scoreChange = newScore - vertexScores[v];
+			vertexScores[v] = newScore;
+
+			const unsigned int* list = &vertexTriangles[triangleOffsets[v]];
+			for (unsigned int j = 0; j < activeTriangles[v]; j++) {
+				triangleScores[list[j]] += scoreChange;
+			}
+		}
+
+		// Keep only what fits, then pick the best triangle that uses a cached vertex
+		cacheCount = newCacheCount < forsythCacheSize ? newCacheCount : forsythCacheSize;
+		bestTriangle = -1;
+		bestScore = -1.0f;
+		for (int i = 0; i < cacheCount; i++) {
+			cache[i] = newCache[i];
+
+			const unsigned int* list = &vertexTriangles[triangleOffsets[cache[i]]];
+			for (unsigned int j = 0; j < activeTriangles[cache[i]]; j++) {
+				if (triangleScores[list[j]] > bestScore) {
+					bestScore = triangleScores[list[j]];
+					bestTriangle = (int)list[j];
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), _indices.begin());
+}
+
+/// <summary>
+/// Reorders vertices into the order the indices first use them, so the
+/// GPU fetches vertex data sequentially instead of jumping around memory
+/// </summary>
+/// <param name="_vertices">List of vertices, which is reordered in place</param>
+/// <param name="_indices">List of indices, which is remapped to the reordered vertices</param>
+/// <returns>The number of vertices left, since unused vertices are removed</returns>
+size_t MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& _vertices, std::vector<unsigned int>& _indices)
+{
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(_vertices.size(), unused);
+	std::vector<Vertex> reordered;
+	reordered.reserve(_vertices.size());
+
+	for (unsigned int& index : _indices) {
+		if (remap[index] == unused) {
+			remap[index] = (unsigned int)reordered.size();
+			reordered.push_back(_vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	_vertices.swap(reordered);
+	return _vertices.size();
+}
+
+/// <summary>
+/// Measures how many times the vertex shader would run for a list of
+/// triangles, by simulating a FIFO post-transform cache
+/// </summary>
+/// <param name="_indices">Array of triangle indices</param>
+/// <param name="_indexCount">Number of indices in the array</param>
+/// <param name="_vertexCount">Number of vertices the indices refer to</param>
+/// <param name="_cacheSize">Number of vertices the simulated cache holds</param>
+/// <returns>The cache miss ratios of the indices</returns>
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const unsigned int* _indices, size_t _indexCount, size_t _vertexCount, unsigned int _cacheSize)
+{
+	VertexCacheStats stats = {};
+	if (_indexCount < 3 || _vertexCount == 0) {
+		return stats;
+	}
+
+	// Each vertex remembers when it entered the cache, measured in misses.
+	// With a FIFO cache, it's still cached if fewer than _cacheSize misses
+	// have happened since
+	std::vector<unsigned int> cachedAt(_vertexCount, 0);
+	std::vector<bool> isUsed(_vertexCount, false);
+	unsigned int misses = 0;
+	unsigned int usedVertices = 0;
+
+	for (size_t i = 0; i < _indexCount; i++) {
+		unsigned int v = _indices[i];
+		if (!isUsed[v] || misses - cachedAt[v] >= _cacheSize) {
+			cachedAt[v] = misses;
+			misses++;
+
+			if (!isUsed[v]) {
+				isUsed[v] = true;
+				usedVertices++;
+			}
+		}
+	}
+
+	stats.ACMR = (float)misses / (_indexCount / 3);
+	stats.ATVR = (float)misses / usedVertices;
+	return stats;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+#include "Vertex.h"
+
+// Optional processing steps applied to loaded meshes
+#define MESH_OPTIMIZE_NONE			0
+#define MESH_OPTIMIZE_VERTEX_CACHE	1	// Reorder triangles and vertices for the GPU's vertex caches
+#define MESH_OPTIMIZE_PACK_VERTICES	2	// Upload vertices in the compressed PackedVertex format
+
+// How well an index buffer reuses transformed vertices
+struct VertexCacheStats
+{
+	float ACMR;		// Average cache miss ratio: vertex shader runs per triangle (0.5 is ideal, 3 is worst)
+	float ATVR;		// Average transform to vertex ratio: vertex shader runs per vertex (1 is ideal)
+};
+
+// --------------------------------------------------------
+// CPU-side passes that make mesh data cheaper to render
+// before it's uploaded to the GPU
+// --------------------------------------------------------
+namespace MeshOptimizer
+{
+	// Merges vertices with identical positions, normals and UVs,
+	// remapping indices to match. Returns the new vertex count
+	size_t WeldVertices(std::vector<Vertex>& _vertices, std::vector<unsigned int>& _indices);
+
+	// Reorders triangles so vertices are reused while they're still
+	// in the post-transform cache (Tom Forsyth's linear-speed algorithm)
+	void OptimizeVertexCache(std::vector<unsigned int>& _indices, size_t _vertexCount);
+
+	// Reorders vertices into the order they're first used, so vertex
+	// fetches walk through memory linearly. Unused vertices are removed.
+	// Returns the new vertex count
+	size_t OptimizeVertexFetch(std::vector<Vertex>& _vertices, std::vector<unsigned int>& _indices);
+
+	// Simulates a FIFO post-transform cache to measure how well indices reuse vertices
+	VertexCacheStats AnalyzeVertexCache(const unsigned int* _indices, size_t _indexCount, size_t _vertexCount, unsigned int _cacheSize = 16);
+}
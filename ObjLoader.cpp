@@ -0,0 +1,387 @@
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+
+#include "MappedFile.h"
+#include "ObjLoader.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// One corner of a face, as 0-based indices into the
+	// position/UV/normal lists (-1 if not specified)
+	struct FaceCorner
+	{
+		int Position;
+		int UV;
+		int Normal;
+	};
+
+	// Exact powers of ten representable as doubles, for float parsing
+	const double powersOfTen[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	inline bool IsDigit(char _c)
+	{
+		return _c >= '0' && _c <= '9';
+	}
+
+	// Spaces, tabs and the '\r' of CRLF line endings all just separate tokens
+	inline bool IsBlank(char _c)
+	{
+		return _c == ' ' || _c == '\t' || _c == '\r';
+	}
+
+	inline void SkipBlanks(const char*& _p, const char* _end)
+	{
+		while (_p < _end && IsBlank(*_p)) _p++;
+	}
+
+	// Moves to the start of the next line
+	inline void SkipLine(const char*& _p, const char* _end)
+	{
+		while (_p < _end && *_p != '\n') _p++;
+		if (_p < _end) _p++;
+	}
+
+	// Checks whether the line at _p starts with the given keyword followed by a blank
+	inline bool IsKeyword(const char* _p, const char* _end, const char* _keyword)
+	{
+		while (*_keyword != 0) {
+			if (_p >= _end || *_p != *_keyword) return false;
+			_p++;
+			_keyword++;
+		}
+		return _p < _end && IsBlank(*_p);
+	}
+
+	// Parses a signed integer at _p, returning false if there are no
+	// digits or its magnitude doesn't fit in an int
+	bool ParseInt(const char*& _p, const char* _end, int& _out)
+	{
+		const char* p = _p;
+		bool negative = false;
+		if (p < _end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			p++;
+		}
+
+		if (p >= _end || !IsDigit(*p)) return false;
+
+		int64_t value = 0;
+		while (p < _end && IsDigit(*p)) {
+			value = value * 10 + (*p - '0');
+			if (value > INT_MAX) return false;
+			p++;
+		}
+
+		_out = negative ? -(int)value : (int)value;
+		_p = p;
+		return true;
+	}
+
+	// Parses a decimal float (with optional exponent) at _p, returning
+	// false if there are no digits. Accumulates up to 18 significant
+	// digits as an integer and scales it once, which is more than
+	// enough precision for a 32-bit result
+	bool ParseFloat(const char*& _p, const char* _end, float& _out)
+	{
+		SkipBlanks(_p, _end);
+
+		const char* p = _p;
+		bool negative = false;
+		if (p < _end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			p++;
+		}
+
+		uint64_t mantissa = 0;
+		int exponent = 0;
+		bool anyDigits = false;
+
+		// Integer part
+		while (p < _end && IsDigit(*p)) {
+			if (mantissa < 100000000000000000ull) {
+				mantissa = mantissa * 10 + (*p - '0');
+			}
+			else {
+				exponent++;
+			}
+			anyDigits = true;
+			p++;
+		}
+
+		// Fractional part
+		if (p < _end && *p == '.') {
+			p++;
+			while (p < _end && IsDigit(*p)) {
+				if (mantissa < 100000000000000000ull) {
+					mantissa = mantissa * 10 + (*p - '0');
+					exponent--;
+				}
+				anyDigits = true;
+				p++;
+			}
+		}
+
+		if (!anyDigits) return false;
+
+		// Exponent, only if it actually has digits
+		if (p < _end && (*p == 'e' || *p == 'E')) {
+			const char* e = p + 1;
+			int exponentPart = 0;
+			if (ParseInt(e, _end, exponentPart)) {
+				exponent += exponentPart;
+				p = e;
+			}
+		}
+
+		double value = (double)mantissa;
+		if (value != 0.0 && exponent != 0) {
+			if (exponent > 0 && exponent <= 22) {
+				value *= powersOfTen[exponent];
+			}
+			else if (exponent < 0 && exponent >= -22) {
+				value /= powersOfTen[-exponent];
+			}
+			else {
+				value *= std::pow(10.0, exponent);
+			}
+		}
+
+		_out = (float)(negative ? -value : value);
+		_p = p;
+		return true;
+	}
+
+	// Converts a 1-based (or negative, relative) OBJ index into
+	// a 0-based one, returning -1 if it's out of range
+	inline int ResolveIndex(int _index, size_t _count)
+	{
+		int resolved = _index > 0 ? _index - 1 : (int)_count + _index;
+		return (_index != 0 && resolved >= 0 && resolved < (int)_count) ? resolved : -1;
+	}
+
+	// Parses one "v", "v/vt", "v//vn" or "v/vt/vn" face token
+	bool ParseCorner(const char*& _p, const char* _end, FaceCorner& _corner, size_t _positionCount, size_t _uvCount, size_t _normalCount)
+	{
+		int index = 0;
+		if (!ParseInt(_p, _end, index)) return false;
+		_corner.Position = ResolveIndex(index, _positionCount);
+		_corner.UV = -1;
+		_corner.Normal = -1;
+
+		if (_p < _end && *_p == '/') {
+			_p++;
+			if (ParseInt(_p, _end, index)) {
+				_corner.UV = ResolveIndex(index, _uvCount);
+			}
+
+			if (_p < _end && *_p == '/') {
+				_p++;
+				if (ParseInt(_p, _end, index)) {
+					_corner.Normal = ResolveIndex(index, _normalCount);
+				}
+			}
+		}
+
+		// Skip anything else attached to the token
+		while (_p < _end && !IsBlank(*_p) && *_p != '\n') _p++;
+		return true;
+	}
+}
+
+/// <summary>
+/// Gets how quickly the file was loaded
+/// </summary>
+/// <returns>The number of bytes processed per second, or 0 if no time was recorded</returns>
+double ObjLoadStats::BytesPerSecond() const
+{
+	return Seconds > 0.0 ? Bytes / Seconds : 0.0;
+}
+
+/// <summary>
+/// Memory-maps an .OBJ file and parses it into a list of vertices and indices
+/// </summary>
+/// <param name="_path">Path to the .OBJ file</param>
+/// <param name="_vertices">List the loaded vertices are written to</param>
+/// <param name="_indices">List the loaded indices are written to</param>
+/// <param name="_stats">Optional stats about the load, including throughput</param>
+/// <returns>Whether the file could be opened</returns>
+bool ObjLoader::Load(const wchar_t* _path, std::vector<Vertex>& _vertices, std::vector<unsigned int>& _indices, ObjLoadStats* _stats)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	MappedFile file;
+	if (!file.Open(_path)) {
+		return false;
+	}
+
+	Parse(file.GetData(), file.GetSize(), _vertices, _indices, _stats);
+
+	// Include the time spent mapping the file in the total
+	if (_stats) {
+		_stats->Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Parses .OBJ text into a list of vertices and indices
+/// </summary>
+/// <param name="_data">Start of the .OBJ text</param>
+/// <param name="_size">Length of the .OBJ text in bytes</param>
+/// <param name="_vertices">List the parsed vertices are written to</param>
+/// <param name="_indices">List the parsed indices are written to</param>
+/// <param name="_stats">Optional stats about the parse</param>
+void ObjLoader::Parse(const char* _data, size_t _size, std::vector<Vertex>& _vertices, std::vector<unsigned int>& _indices, ObjLoadStats* _stats)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	_vertices.clear();
+	_indices.clear();
+
+	std::vector<XMFLOAT3> positions;	// Positions from the file
+	std::vector<XMFLOAT3> normals;		// Normals from the file
+	std::vector<XMFLOAT2> uvs;			// UVs from the file
+	std::vector<FaceCorner> corners;	// Corners of the face being read
+	std::vector<Vertex> faceVerts;		// Converted vertices of the face being read
+
+	// Rough guess at how much data is coming, based on the file size
+	positions.reserve(_size / 120);
+	normals.reserve(_size / 120);
+	uvs.reserve(_size / 120);
+	_vertices.reserve(_size / 40);
+	_indices.reserve(_size / 40);
+
+	unsigned int lineCount = 0;
+	unsigned int faceCount = 0;
+
+	const char* p = _data;
+	const char* end = _data + _size;
+
+	while (p < end)
+	{
+		lineCount++;
+		SkipBlanks(p, end);
+
+		if (IsKeyword(p, end, "v"))
+		{
+			p += 1;
+			XMFLOAT3 pos(0, 0, 0);
+			ParseFloat(p, end, pos.x);
+			ParseFloat(p, end, pos.y);
+			ParseFloat(p, end, pos.z);
+			positions.push_back(pos);
+		}
+		else if (IsKeyword(p, end, "vn"))
+		{
+			p += 2;
+			XMFLOAT3 norm(0, 0, 0);
+			ParseFloat(p, end, norm.x);
+			ParseFloat(p, end, norm.y);
+			ParseFloat(p, end, norm.z);
+			normals.push_back(norm);
+		}
+		else if (IsKeyword(p, end, "vt"))
+		{
+			p += 2;
+			XMFLOAT2 uv(0, 0);
+			ParseFloat(p, end, uv.x);
+			ParseFloat(p, end, uv.y);
+			uvs.push_back(uv);
+		}
+		else if (IsKeyword(p, end, "f"))
+		{
+			p += 1;
+
+			// Read every corner on the line, however many there are
+			corners.clear();
+			bool isValid = true;
+			while (true) {
+				SkipBlanks(p, end);
+				FaceCorner corner;
+				if (!ParseCorner(p, end, corner, positions.size(), uvs.size(), normals.size())) break;
+				isValid &= corner.Position >= 0;
+				corners.push_back(corner);
+			}
+
+			// Skip degenerate faces and faces that reference missing positions
+			if (isValid && corners.size() >= 3)
+			{
+				faceCount++;
+
+				// - Create the verts by looking up
+				//    corresponding data from vectors
+				// - The model is most likely in a right-handed space,
+				//    so invert the Z position and the normal's Z to
+				//    convert to DirectX's left-handed space
+				// - Flip the UV's since they're probably "upside down"
+				faceVerts.resize(corners.size());
+				bool needsFaceNormal = false;
+				for (size_t i = 0; i < corners.size(); i++) {
+					Vertex& v = faceVerts[i];
+					v.Position = positions[corners[i].Position];
+					v.Position.z *= -1.0f;
+
+					v.UV = corners[i].UV >= 0 ? uvs[corners[i].UV] : XMFLOAT2(0, 0);
+					v.UV.y = 1.0f - v.UV.y;
+
+					if (corners[i].Normal >= 0) {
+						v.Normal = normals[corners[i].Normal];
+						v.Normal.z *= -1.0f;
+					}
+					else {
+						needsFaceNormal = true;
+					}
+
+					v.Tangent = XMFLOAT3(0, 0, 0);
+				}
+
+				// Corners without normals get the flat normal of the face
+				if (needsFaceNormal) {
+					XMVECTOR p0 = XMLoadFloat3(&faceVerts[0].Position);
+					XMVECTOR p1 = XMLoadFloat3(&faceVerts[1].Position);
+					XMVECTOR p2 = XMLoadFloat3(&faceVerts[2].Position);
+					XMFLOAT3 faceNormal;
+					XMStoreFloat3(&faceNormal, XMVector3Normalize(XMVector3Cross(p2 - p0, p1 - p0)));
+
+					for (size_t i = 0; i < corners.size(); i++) {
+						if (corners[i].Normal < 0) {
+							faceVerts[i].Normal = faceNormal;
+						}
+					}
+				}
+
+				// Triangulate as a fan around the first corner, flipping
+				// the winding order to match the flipped Z
+				for (size_t i = 1; i + 1 < faceVerts.size(); i++) {
+					_vertices.push_back(faceVerts[0]);
+					_vertices.push_back(faceVerts[i + 1]);
+					_vertices.push_back(faceVerts[i]);
+
+					// Every vertex is unique, so indices just count up
+					unsigned int firstIndex = (unsigned int)_indices.size();
+					_indices.push_back(firstIndex);
+					_indices.push_back(firstIndex + 1);
+					_indices.push_back(firstIndex + 2);
+				}
+			}
+		}
+
+		// Anything else (comments, groups, materials) is skipped
+		SkipLine(p, end);
+	}
+
+	if (_stats) {
+		_stats->Bytes = _size;
+		_stats->Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		_stats->Lines = lineCount;
+		_stats->Faces = faceCount;
+	}
+}
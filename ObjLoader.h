@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include "Vertex.h"
+
+// Timing info from a single OBJ load, for tracking loader throughput
+struct ObjLoadStats
+{
+	size_t Bytes;			// Size of the source file
+	double Seconds;			// Time spent mapping and parsing it
+	unsigned int Lines;		// Number of lines in the file
+	unsigned int Faces;		// Number of faces (of any size) read
+
+	// Parsing throughput, or 0 if nothing was timed
+	double BytesPerSecond() const;
+};
+
+// --------------------------------------------------------
+// Memory-mapped .OBJ loader with a hand-written tokenizer
+//
+// Supports positions, UVs and normals with any face format
+// (v, v/vt, v//vn, v/vt/vn), negative (relative) indices,
+// lines of any length and n-gon faces, which are triangulated
+// as fans. Converts to DirectX's left-handed space the same way
+// the original sscanf_s loader did.
+// --------------------------------------------------------
+namespace ObjLoader
+{
+	// Maps and parses an .OBJ file, returning false if it couldn't be opened
+	bool Load(const wchar_t* _path, std::vector<Vertex>& _vertices, std::vector<unsigned int>& _indices, ObjLoadStats* _stats = nullptr);
+
+	// Parses .OBJ text already in memory (need not be null-terminated)
+	void Parse(const char* _data, size_t _size, std::vector<Vertex>& _vertices, std::vector<unsigned int>& _indices, ObjLoadStats* _stats = nullptr);
+}
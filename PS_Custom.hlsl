@@ -1,13 +1,16 @@
 // Starter code from PixelShader.hlsl
 #include "ShaderStructs.hlsli"
 
-cbuffer PrimaryBuffer : register(b0)
+// Data that's the same for everything drawn this frame
+cbuffer PerFrame : register(b0)
 {
-	float4 colorTint;
-	float roughness;
-	float3 cameraPosition;
-	float3 ambientLight;
 	float totalTime;
+}
+
+// Data that only changes between materials
+cbuffer PerMaterial : register(b1)
+{
+	float4 colorTint;
 	float2 imageCenter;
 	float2 zoomCenter;
 	int maxIterations;
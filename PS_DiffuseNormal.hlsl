@@ -2,19 +2,22 @@
 #include "ShaderLighting.hlsli"
 #include "ShaderNormals.hlsli"
 
-// Data from our primary constant buffer
-cbuffer PrimaryBuffer : register(b0)
+// Data that's the same for everything drawn this frame
+cbuffer PerFrame : register(b0)
 {
-	float4 colorTint;
-	float roughness;
 	float3 cameraPosition;
-
-	float2 uvPosition;
-	float2 uvScale;
+	float3 lightAmbient;
 
 	Light lights[LIGHT_COUNT];
+}
 
-	float3 lightAmbient;
+// Data that only changes between materials
+cbuffer PerMaterial : register(b1)
+{
+	float4 colorTint;
+	float2 uvPosition;
+	float2 uvScale;
+	float roughness;
 }
 
 Texture2D MapDiffuse : register(t0); // "t" registers for textures
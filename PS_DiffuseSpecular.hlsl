@@ -1,18 +1,22 @@
 #include "ShaderStructs.hlsli"
 #include "ShaderLighting.hlsli"
 
-// Data from our primary constant buffer
-cbuffer PrimaryBuffer : register(b0)
+// Data that's the same for everything drawn this frame
+cbuffer PerFrame : register(b0)
 {
-	float4 colorTint;
-	float roughness;
 	float3 cameraPosition;
+	float3 lightAmbient;
+
+	Light lights[LIGHT_COUNT];
+}
 
+// Data that only changes between materials
+cbuffer PerMaterial : register(b1)
+{
+	float4 colorTint;
 	float2 uvPosition;
 	float2 uvScale;
-
-	Light lights[LIGHT_COUNT];
-	float3 lightAmbient;
+	float roughness;
 }
 
 Texture2D MapDiffuseSpecular : register(t0); // "t" registers for textures
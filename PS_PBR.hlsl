@@ -2,25 +2,31 @@
 #include "ShaderLighting.hlsli"
 #include "ShaderNormals.hlsli"
 
-// Data from our primary constant buffer
-cbuffer PrimaryBuffer : register(b0)
+// Data that's the same for everything drawn this frame
+cbuffer PerFrame : register(b0)
 {
-	float4 colorTint;
-	float roughness;
 	float3 cameraPosition;
+	int shadowCascadeCount;
 
-	float2 uvPosition;
-	float2 uvScale;
+	float4 shadowCascadeSplits; // Distance in front of the camera each cascade ends at
+	float4x4 shadowCascadeMatrices[SHADOW_CASCADE_COUNT]; // Light's view-projection matrix for each cascade
 
 	Light lights[LIGHT_COUNT];
+}
 
+// Data that only changes between materials
+cbuffer PerMaterial : register(b1)
+{
+	float4 colorTint;
+	float2 uvPosition;
+	float2 uvScale;
+	float roughness;
 	float metalness;
-	int shadowsActive;
 }
 
 Texture2D MapAlbedoMetalness : register(t0); // "t" registers for textures
 Texture2D MapNormalRoughness : register(t1);
-Texture2D MapShadow          : register(t2);
+Texture2DArray MapShadow     : register(t2); // One slice per cascade
 
 SamplerState BasicSampler : register(s0); // "s" registers for samplers
 SamplerComparisonState ShadowSampler : register(s1);
@@ -48,16 +54,28 @@ float4 main(VertexToPixel_Shadow input) : SV_TARGET
 
 	// Shadow calculations
 
-	// Perspective divide
-	input.shadowPosition /= input.shadowPosition.w;
+	// Pick the first cascade that reaches this pixel
+	int cascade = 0;
+	[unroll]
+	for (int i = 0; i < SHADOW_CASCADE_COUNT - 1; i++) {
+		cascade += input.viewDepth > shadowCascadeSplits[i] ? 1 : 0;
+	}
+	cascade = min(cascade, shadowCascadeCount - 1);
+
+	// Find the pixel's position on the cascade's map, then perspective divide
+	float4 shadowPosition = mul(shadowCascadeMatrices[cascade], float4(input.worldPosition, 1.0f));
+	shadowPosition /= shadowPosition.w;
 
 	// Convert NDCs to UV coordinates for sampling
-	float2 shadowUV = input.shadowPosition.xy * 0.5f + 0.5f;
+	float2 shadowUV = shadowPosition.xy * 0.5f + 0.5f;
 	shadowUV.y = 1 - shadowUV.y;
 
 	// Get distances from light to the closest surface and to this pixel
-	float lightToPixel = input.shadowPosition.z;
-	float shadowAmount = MapShadow.SampleCmpLevelZero(ShadowSampler, shadowUV, lightToPixel).r;
+	float lightToPixel = shadowPosition.z;
+	float shadowAmount = MapShadow.SampleCmpLevelZero(ShadowSampler, float3(shadowUV, cascade), lightToPixel).r;
+
+	// Nothing past the last cascade is shadowed
+	shadowAmount = input.viewDepth > shadowCascadeSplits[shadowCascadeCount - 1] ? 1.0f : shadowAmount;
 
 
 
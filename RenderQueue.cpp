@@ -0,0 +1,115 @@
+#include <cstddef>
+
+#include "RenderQueue.h"
+
+namespace
+{
+	inline uint64_t Field(unsigned int _value, unsigned int _bits)
+	{
+		return (uint64_t)_value & ((1ull << _bits) - 1);
+	}
+}
+
+/// <summary>
+/// Packs a draw's state into a key that sorts it where the given mode wants it
+/// </summary>
+/// <param name="_pass">RENDER_PASS_ the draw is in, which always sorts first</param>
+/// <param name="_vertexShaderID">Small ID of the vertex shader</param>
+/// <param name="_pixelShaderID">Small ID of the pixel shader</param>
+/// <param name="_materialID">Small ID of the material</param>
+/// <param name="_meshID">Small ID of the mesh</param>
+/// <param name="_depth">Distance from the camera, from 0 (near clip plane) to 1 (far clip plane)</param>
+/// <param name="_sortMode">RENDER_SORT_ mode the key is for</param>
+/// <returns>The sort key</returns>
+uint64_t RenderQueue::MakeKey(
+	unsigned int _pass, unsigned int _vertexShaderID, unsigned int _pixelShaderID,
+	unsigned int _materialID, unsigned int _meshID, float _depth, int _sortMode)
+{
+	if (_sortMode == RENDER_SORT_NONE) {
+		return 0;
+	}
+
+	const unsigned int halfShaderBits = RENDER_KEY_SHADER_BITS / 2;
+	_depth = _depth < 0.0f ? 0.0f : (_depth > 1.0f ? 1.0f : _depth);
+	uint64_t pass = Field(_pass, RENDER_KEY_PASS_BITS);
+	uint64_t shaders = Field(_vertexShaderID, halfShaderBits) << halfShaderBits | Field(_pixelShaderID, halfShaderBits);
+	uint64_t material = Field(_materialID, RENDER_KEY_MATERIAL_BITS);
+	uint64_t mesh = Field(_meshID, RENDER_KEY_MESH_BITS);
+	uint64_t depth = (uint64_t)(_depth * (float)((1u << RENDER_KEY_DEPTH_BITS) - 1));
+
+	// Pass is always the top bits, then the rest in the mode's order
+	uint64_t key = pass;
+	if (_sortMode == RENDER_SORT_DEPTH) {
+		key = key << RENDER_KEY_DEPTH_BITS | depth;
+	}
+	key = key << RENDER_KEY_SHADER_BITS | shaders;
+	key = key << RENDER_KEY_MATERIAL_BITS | material;
+	key = key << RENDER_KEY_MESH_BITS | mesh;
+	if (_sortMode != RENDER_SORT_DEPTH) {
+		key = key << RENDER_KEY_DEPTH_BITS | depth;
+	}
+	return key;
+}
+
+void RenderQueue::Clear()
+{
+	packets.clear();
+}
+
+void RenderQueue::Add(uint64_t _key, unsigned int _entityIndex)
+{
+	packets.push_back({ _key, _entityIndex });
+}
+
+/// <summary>
+/// Sorts the queue by key with a stable LSD radix sort
+/// </summary>
+void RenderQueue::Sort()
+{
+	sortPasses = 0;
+	size_t count = packets.size();
+	if (count < 2) {
+		return;
+	}
+	scratch.resize(count);
+
+	// Count every byte's values up front, so passes
+	// over bytes that never change can be skipped
+	unsigned int histograms[8][256] = {};
+	for (const DrawPacket& packet : packets) {
+		for (int b = 0; b < 8; b++) {
+			histograms[b][(packet.Key >> (b * 8)) & 0xFF]++;
+		}
+	}
+
+	for (int b = 0; b < 8; b++) {
+		unsigned int* histogram = histograms[b];
+		if (histogram[(packets[0].Key >> (b * 8)) & 0xFF] == count) {
+			continue;
+		}
+
+		// Turn counts into where each value's packets start
+		unsigned int offset = 0;
+		for (int v = 0; v < 256; v++) {
+			unsigned int valueCount = histogram[v];
+			histogram[v] = offset;
+			offset += valueCount;
+		}
+
+		for (const DrawPacket& packet : packets) {
+			scratch[histogram[(packet.Key >> (b * 8)) & 0xFF]++] = packet;
+		}
+		packets.swap(scratch);
+		sortPasses++;
+	}
+}
+
+const std::vector<DrawPacket>& RenderQueue::GetPackets()
+{
+	return packets;
+}
+
+unsigned int RenderQueue::GetSortPasses()
+{
+	return sortPasses;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Passes draws can be queued in, drawn in this order
+#define RENDER_PASS_OPAQUE		0
+
+// How queued draws are ordered
+#define RENDER_SORT_NONE		0	// The order they were added in
+#define RENDER_SORT_STATE		1	// Grouped by shaders, then material, then mesh, then front to back
+#define RENDER_SORT_DEPTH		2	// Front to back, then by state
+
+// Bits each part of a sort key is packed into
+#define RENDER_KEY_PASS_BITS		4
+#define RENDER_KEY_SHADER_BITS		12	// Vertex and pixel shader IDs, 6 bits each
+#define RENDER_KEY_MATERIAL_BITS	12
+#define RENDER_KEY_MESH_BITS		12
+#define RENDER_KEY_DEPTH_BITS		24
+
+// One draw waiting to be submitted
+struct DrawPacket
+{
+	uint64_t Key;				// Built by RenderQueue::MakeKey()
+	unsigned int EntityIndex;	// What to draw
+};
+
+// A run of sorted draws that share a mesh (and material, outside
+// the shadow pass), which can be drawn as one instanced draw
+struct DrawBatch
+{
+	unsigned int FirstPacket;	// Index of the run's first packet
+	unsigned int PacketCount;
+	bool Instanced;				// Whether the run's instances are in the instance buffer
+	unsigned int StartInstance;	// Where in the instance buffer they start
+};
+
+// --------------------------------------------------------
+// Collects a frame's draws and sorts them by 64-bit keys,
+// so draws sharing shaders, materials and meshes end up
+// next to each other, and opaque draws go front to back
+// to cut down on overdraw
+//
+// Keys are sorted with an LSD radix sort, one byte per
+// pass, skipping bytes every key has in common
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+	// Packs a draw's state into a sort key for the given
+	// RENDER_SORT_ mode. IDs are cut down to their field's
+	// size, and _depth is from 0 (near) to 1 (far)
+	static uint64_t MakeKey(
+		unsigned int _pass, unsigned int _vertexShaderID, unsigned int _pixelShaderID,
+		unsigned int _materialID, unsigned int _meshID, float _depth, int _sortMode);
+
+	// Empties the queue, keeping its memory
+	void Clear();
+	void Add(uint64_t _key, unsigned int _entityIndex);
+	// Sorts by key, keeping packets with equal keys in the order they were added
+	void Sort();
+
+	const std::vector<DrawPacket>& GetPackets();
+	// Number of byte passes the last Sort() actually ran
+	unsigned int GetSortPasses();
+
+private:
+	std::vector<DrawPacket> packets;
+	// Where each radix pass writes to before it's swapped with packets
+	std::vector<DrawPacket> scratch;
+	unsigned int sortPasses = 0;
+};
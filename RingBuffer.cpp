@@ -0,0 +1,127 @@
+#include "RingBuffer.h"
+
+/// <summary>
+/// Creates a ring buffer and the dynamic buffer behind it
+/// </summary>
+/// <param name="_device">Device the buffer is created with</param>
+/// <param name="_context">Device context the buffer is mapped with</param>
+/// <param name="_size">Bytes the buffer starts with room for</param>
+/// <param name="_bindFlags">D3D11_BIND_ flags the buffer can be bound with</param>
+RingBuffer::RingBuffer(
+	Microsoft::WRL::ComPtr<ID3D11Device> _device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+	unsigned int _size, unsigned int _bindFlags) :
+	device(_device),
+	context(_context),
+	bindFlags(_bindFlags),
+	size(0),
+	head(0),
+	fresh(true),
+	generation(0)
+{
+	CreateBuffer(_size);
+	ResetStats();
+}
+
+/// <summary>
+/// Finds room for a write after everything written so far, or at the
+/// front of a fresh buffer if there isn't any, and maps it
+/// </summary>
+/// <param name="_size">Bytes to write</param>
+/// <param name="_alignment">What the offset must be a multiple of</param>
+/// <param name="_offset">Set to the byte offset the write starts at</param>
+/// <returns>Where to write to, or null if mapping failed</returns>
+void* RingBuffer::Map(unsigned int _size, unsigned int _alignment, unsigned int& _offset)
+{
+	// Writes bigger than the whole buffer need a bigger one (as does
+	// any write if there's no buffer yet). If it can't be made, the
+	// old buffer is kept but this write fails
+	if ((_size > size || !buffer) && !CreateBuffer(_size > size * 2 ? _size : size * 2)) {
+		return nullptr;
+	}
+
+	// The first map of a new buffer has to discard it too
+	unsigned int offset = (head + _alignment - 1) / _alignment * _alignment;
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (fresh || offset + _size > size) {
+		offset = 0;
+		mapType = D3D11_MAP_WRITE_DISCARD;
+		if (!fresh) {
+			stats.Wraps++;
+		}
+		fresh = false;
+		generation++;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(buffer.Get(), 0, mapType, 0, &mapped))) {
+		return nullptr;
+	}
+
+	head = offset + _size;
+	stats.Allocations++;
+	stats.Bytes += _size;
+	_offset = offset;
+	return (unsigned char*)mapped.pData + offset;
+}
+
+void RingBuffer::Unmap()
+{
+	context->Unmap(buffer.Get(), 0);
+}
+
+ID3D11Buffer* RingBuffer::GetBuffer()
+{
+	return buffer.Get();
+}
+
+unsigned int RingBuffer::GetSize()
+{
+	return size;
+}
+
+unsigned long long RingBuffer::GetGeneration()
+{
+	return generation;
+}
+
+RingBufferStats RingBuffer::GetStats()
+{
+	return stats;
+}
+
+void RingBuffer::ResetStats()
+{
+	stats = {};
+}
+
+/// <summary>
+/// Replaces the buffer with an empty one of the given size. Anything
+/// the GPU hasn't read from the old one yet stays alive until it has
+/// </summary>
+/// <param name="_size">Bytes the buffer has room for</param>
+/// <returns>Whether the buffer was created. If not, the old one is left as it was</returns>
+bool RingBuffer::CreateBuffer(unsigned int _size)
+{
+	// Constant buffers must be a multiple of 16 bytes
+	unsigned int newSize = (_size + 15) & ~15u;
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth		= newSize;
+	bufferDesc.Usage			= D3D11_USAGE_DYNAMIC;
+	bufferDesc.BindFlags		= bindFlags;
+	bufferDesc.CPUAccessFlags	= D3D11_CPU_ACCESS_WRITE;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> newBuffer;
+	if (FAILED(device->CreateBuffer(&bufferDesc, 0, newBuffer.GetAddressOf()))) {
+		return false;
+	}
+	buffer = newBuffer;
+	size = newSize;
+
+	// It has to be discarded the first time it's mapped, which also
+	// moves on to a new generation, since nothing written to the old
+	// buffer can be read from this one
+	head = 0;
+	fresh = true;
+	return true;
+}
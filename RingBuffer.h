@@ -0,0 +1,68 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+// How much was written to a RingBuffer since its stats were last reset
+struct RingBufferStats
+{
+	unsigned int Allocations;
+	unsigned long long Bytes;
+	unsigned int Wraps;		// Times it ran out of room and started over with a fresh buffer
+};
+
+// --------------------------------------------------------
+// One large dynamic buffer that short-lived data (like
+// per-draw constants and instance data) is written into
+// back to back, then bound by offset.
+//
+// Writes are mapped with WRITE_NO_OVERWRITE, which promises
+// the driver nothing the GPU might still read is touched,
+// so it needn't copy or wait. When the buffer fills, it's
+// mapped with WRITE_DISCARD instead and writing starts over
+// at the front of a fresh buffer, while the GPU keeps
+// reading the old one.
+//
+// Everything written before a wrap is gone afterward, so
+// anything that reuses an earlier write should check it was
+// made in the current GetGeneration()
+// --------------------------------------------------------
+class RingBuffer
+{
+public:
+	RingBuffer(
+		Microsoft::WRL::ComPtr<ID3D11Device> _device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+		unsigned int _size, unsigned int _bindFlags);
+
+	// Maps room for _size bytes for writing, returning where they
+	// are, or null if the buffer couldn't be mapped. Call Unmap()
+	// once they're written, before drawing with them
+	void* Map(unsigned int _size, unsigned int _alignment, unsigned int& _offset);
+	void Unmap();
+
+	ID3D11Buffer* GetBuffer();
+	unsigned int GetSize();
+	// Goes up every time the buffer's contents are discarded
+	unsigned long long GetGeneration();
+
+	RingBufferStats GetStats();
+	void ResetStats();
+
+private:
+	bool CreateBuffer(unsigned int _size);
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	unsigned int bindFlags;
+	unsigned int size;
+
+	// Where the next write can start
+	unsigned int head;
+	// Whether the buffer hasn't been mapped since it was created
+	bool fresh;
+	unsigned long long generation;
+
+	RingBufferStats stats;
+};
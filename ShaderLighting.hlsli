@@ -4,6 +4,8 @@
 #include "ShaderStructs.hlsli"
 
 #define LIGHT_COUNT	8
+// Must match SHADOW_CASCADE_COUNT in ShadowCascades.h
+#define SHADOW_CASCADE_COUNT	4
 
 
 
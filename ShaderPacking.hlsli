@@ -0,0 +1,37 @@
+#ifndef __GGP_SHADER_PACKING__
+#define __GGP_SHADER_PACKING__
+
+#include "ShaderStructs.hlsli"
+
+// Compressed vertex, matching PackedVertex in VertexPacking.h
+// - The input layout converts each value to a float, so the
+//   shader only has to undo the quantization and encoding
+struct VertexShaderInput_Packed
+{
+    float4 localPosition	: POSITION; // SNORM XYZ position, relative to the mesh's bounds
+    float4 normalTangent	: NORMAL; // SNORM octahedral normal (XY) and tangent (ZW)
+    float2 uv				: TEXCOORD; // Half-precision UV coordinate
+};
+
+// Turns a vector stored in octahedral form back into a unit vector
+// - Matches OctahedralDecode() in VertexPacking.cpp
+float3 OctahedralDecode(float2 encoded)
+{
+    float3 v = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float t = saturate(-v.z);
+    v.xy += (v.xy >= 0.0f) ? -t : t;
+    return normalize(v);
+}
+
+// Unpacks a compressed vertex into the same form as an uncompressed one
+VertexShaderInput UnpackVertex(VertexShaderInput_Packed input, float3 quantizationScale, float3 quantizationOffset)
+{
+    VertexShaderInput output;
+    output.localPosition = input.localPosition.xyz * quantizationScale + quantizationOffset;
+    output.normal = OctahedralDecode(input.normalTangent.xy);
+    output.tangent = OctahedralDecode(input.normalTangent.zw);
+    output.uv = input.uv;
+    return output;
+}
+
+#endif
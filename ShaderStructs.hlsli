@@ -19,6 +19,17 @@ struct VertexShaderInput
     float2 uv				: TEXCOORD; // UV coordinate
 };
 
+// Per-instance data for instanced draws, matching InstanceData in InstanceData.h
+// - "_PER_INSTANCE" semantics tell SimpleShader to read these from input slot 1,
+//   once per instance
+// - Each matrix arrives as the rows of the C++ matrix, the same as matrices
+//   in constant buffers, so they're used the same way
+struct InstanceInput
+{
+    float4x4 world			: WORLD_PER_INSTANCE; // World matrix
+    float4x4 worldIT		: WORLD_IT_PER_INSTANCE; // Inverse transpose of the world matrix
+};
+
 // Struct representing the data we're sending down the pipeline
 // - Should match our pixel shader's input (hence the name: Vertex to Pixel)
 // - At a minimum, we need a piece of data defined tagged as SV_POSITION
@@ -57,7 +68,7 @@ struct VertexToPixel_Shadow
     float3 tangent        : TANGENT; // Tangent vector
     float2 uv             : TEXCOORD; // UV coordinate
     float3 worldPosition  : POSITION; // World position of the pixel
-    float4 shadowPosition : SHADOW_POSITION; // UV coordinate of the pixel on the shadow map
+    float viewDepth       : VIEW_DEPTH; // Distance of the pixel in front of the camera, for picking a shadow cascade
 };
 
 // For skybox shader
@@ -0,0 +1,172 @@
+#include <cmath>
+
+#include "ShadowCascades.h"
+
+using namespace DirectX;
+
+/// <summary>
+/// Finds where to split a camera's view into slices using the "practical" split
+/// scheme, which blends logarithmic splits (even resolution at every distance, but
+/// tiny slices up close) with even splits (large slices everywhere)
+/// </summary>
+/// <param name="_near">Distance the first slice starts at</param>
+/// <param name="_far">Distance the last slice ends at</param>
+/// <param name="_count">Number of slices</param>
+/// <param name="_lambda">How logarithmic the splits are, from 0 (even) to 1 (logarithmic)</param>
+/// <param name="_splits">Array the distances are written to, with room for _count + 1 of them</param>
+void ShadowCascades::ComputeSplits(float _near, float _far, unsigned int _count, float _lambda, float* _splits)
+{
+	if (_count == 0) {
+		return;
+	}
+
+	// Logarithmic splits can't start at 0
+	float logNear = fmaxf(_near, 0.0001f);
+
+	_splits[0] = _near;
+	for (unsigned int i = 1; i < _count; i++) {
+		float fraction = (float)i / _count;
+		float logSplit = logNear * powf(_far / logNear, fraction);
+		float evenSplit = _near + (_far - _near) * fraction;
+		_splits[i] = _lambda * logSplit + (1.0f - _lambda) * evenSplit;
+	}
+	_splits[_count] = _far;
+}
+
+/// <summary>
+/// Gets the view-space corners of the part of a camera's view between two distances
+/// </summary>
+/// <param name="_cameraProjection">Camera's projection matrix</param>
+/// <param name="_cameraNear">Distance to the camera's near clip plane</param>
+/// <param name="_cameraFar">Distance to the camera's far clip plane</param>
+/// <param name="_sliceNear">Distance the slice starts at</param>
+/// <param name="_sliceFar">Distance the slice ends at</param>
+/// <param name="_corners">Array the four near corners and then four far corners are written to</param>
+void ShadowCascades::ComputeSliceCorners(
+	const XMFLOAT4X4& _cameraProjection, float _cameraNear, float _cameraFar,
+	float _sliceNear, float _sliceFar,
+	XMFLOAT3 _corners[8])
+{
+	XMMATRIX inverseProjection = XMMatrixInverse(nullptr, XMLoadFloat4x4(&_cameraProjection));
+
+	// Depth changes evenly along each edge of the view, for
+	// perspective and orthographic cameras alike, so each slice
+	// corner is part of the way between a near and far corner
+	float range = _cameraFar - _cameraNear;
+	float nearFraction = (_sliceNear - _cameraNear) / range;
+	float farFraction = (_sliceFar - _cameraNear) / range;
+
+	static const float cornerSigns[4][2] = { { -1, -1 }, { 1, -1 }, { -1, 1 }, { 1, 1 } };
+	for (int i = 0; i < 4; i++) {
+		XMVECTOR nearCorner = XMVector3TransformCoord(XMVectorSet(cornerSigns[i][0], cornerSigns[i][1], 0.0f, 1.0f), inverseProjection);
+		XMVECTOR farCorner = XMVector3TransformCoord(XMVectorSet(cornerSigns[i][0], cornerSigns[i][1], 1.0f, 1.0f), inverseProjection);
+		XMStoreFloat3(&_corners[i], XMVectorLerp(nearCorner, farCorner, nearFraction));
+		XMStoreFloat3(&_corners[i + 4], XMVectorLerp(nearCorner, farCorner, farFraction));
+	}
+}
+
+/// <summary>
+/// Builds the light's view and projection matrices for one slice of a camera's view
+/// </summary>
+/// <param name="_corners">View-space corners of the slice</param>
+/// <param name="_cameraView">Camera's view matrix</param>
+/// <param name="_lightDirection">Direction the light shines in</param>
+/// <param name="_lightDistance">Distance from the slice's center to pull the light's eye back</param>
+/// <param name="_resolution">Width and height of the cascade's shadow map in texels</param>
+/// <returns>The cascade, with its distances left at 0</returns>
+ShadowCascade ShadowCascades::ComputeCascade(
+	const XMFLOAT3 _corners[8], const XMFLOAT4X4& _cameraView,
+	const XMFLOAT3& _lightDirection,
+	float _lightDistance, unsigned int _resolution)
+{
+	// Find a sphere around the slice in view space, so its size depends
+	// only on the slice's shape and never on where the camera is
+	XMVECTOR center = XMVectorZero();
+	for (int i = 0; i < 8; i++) {
+		center = center + XMLoadFloat3(&_corners[i]);
+	}
+	center = center * (1.0f / 8.0f);
+
+	float radius = 0.0f;
+	for (int i = 0; i < 8; i++) {
+		radius = fmaxf(radius, XMVectorGetX(XMVector3Length(XMLoadFloat3(&_corners[i]) - center)));
+	}
+	// Round up so small changes to the projection don't change the size,
+	// then leave room for the half texel snapping can move the map by
+	radius = ceilf(radius * 16.0f) / 16.0f;
+	radius *= (float)_resolution / (float)(_resolution > 1 ? _resolution - 1 : 1);
+
+	center = XMVector3TransformCoord(center, XMMatrixInverse(nullptr, XMLoadFloat4x4(&_cameraView)));
+
+	// Only the view's position depends on the camera. Its rotation
+	// depends only on the light, so it needs an up vector that
+	// isn't parallel to the light
+	XMVECTOR direction = XMVector3Normalize(XMLoadFloat3(&_lightDirection));
+	XMVECTOR up = fabsf(XMVectorGetY(direction)) > 0.99f
+		? XMVectorSet(0, 0, 1, 0)
+		: XMVectorSet(0, 1, 0, 0);
+
+	XMMATRIX view = XMMatrixLookToLH(center - direction * _lightDistance, direction, up);
+	XMMATRIX projection = XMMatrixOrthographicOffCenterLH(-radius, radius, -radius, radius, 0.0f, _lightDistance + radius);
+
+	// Snap the map to whole texels by finding where the world's origin lands
+	// on it and shifting the projection so that's exactly on a texel corner.
+	// Everything else then lands on the same spot within its texel every frame
+	float halfResolution = _resolution * 0.5f;
+	XMVECTOR origin = XMVector3TransformCoord(XMVectorZero(), XMMatrixMultiply(view, projection)) * halfResolution;
+	XMVECTOR offset = (XMVectorRound(origin) - origin) * (1.0f / halfResolution);
+	projection.r[3] = projection.r[3] + XMVectorSet(XMVectorGetX(offset), XMVectorGetY(offset), 0.0f, 0.0f);
+
+	ShadowCascade cascade = {};
+	XMStoreFloat4x4(&cascade.View, view);
+	XMStoreFloat4x4(&cascade.Projection, projection);
+	cascade.Radius = radius;
+	cascade.TexelSize = radius * 2.0f / _resolution;
+	return cascade;
+}
+
+/// <summary>
+/// Splits a camera's view into slices and builds a cascade for each one
+/// </summary>
+/// <param name="_cameraView">Camera's view matrix</param>
+/// <param name="_cameraProjection">Camera's projection matrix</param>
+/// <param name="_cameraNear">Distance to the camera's near clip plane</param>
+/// <param name="_cameraFar">Distance to the camera's far clip plane</param>
+/// <param name="_maxDistance">Distance past which nothing gets shadows, if closer than the far clip plane</param>
+/// <param name="_count">Number of cascades, up to SHADOW_CASCADE_COUNT</param>
+/// <param name="_lambda">How logarithmic the splits are, from 0 (even) to 1 (logarithmic)</param>
+/// <param name="_lightDirection">Direction the light shines in</param>
+/// <param name="_lightDistance">Distance from each slice's center to pull the light's eye back</param>
+/// <param name="_resolution">Width and height of each cascade's shadow map in texels</param>
+/// <param name="_cascades">Array the cascades are written to, with room for _count of them</param>
+/// <returns>Number of cascades written</returns>
+unsigned int ShadowCascades::ComputeCascades(
+	const XMFLOAT4X4& _cameraView, const XMFLOAT4X4& _cameraProjection,
+	float _cameraNear, float _cameraFar, float _maxDistance,
+	unsigned int _count, float _lambda,
+	const XMFLOAT3& _lightDirection, float _lightDistance, unsigned int _resolution,
+	ShadowCascade* _cascades)
+{
+	_count = _count < SHADOW_CASCADE_COUNT ? _count : SHADOW_CASCADE_COUNT;
+	if (_count == 0 || _cameraFar <= _cameraNear) {
+		return 0;
+	}
+
+	float shadowFar = fminf(_cameraFar, _maxDistance);
+	if (shadowFar <= _cameraNear) {
+		shadowFar = _cameraFar;
+	}
+
+	float splits[SHADOW_CASCADE_COUNT + 1];
+	ComputeSplits(_cameraNear, shadowFar, _count, _lambda, splits);
+
+	for (unsigned int i = 0; i < _count; i++) {
+		XMFLOAT3 corners[8];
+		ComputeSliceCorners(_cameraProjection, _cameraNear, _cameraFar, splits[i], splits[i + 1], corners);
+
+		_cascades[i] = ComputeCascade(corners, _cameraView, _lightDirection, _lightDistance, _resolution);
+		_cascades[i].NearDistance = splits[i];
+		_cascades[i].FarDistance = splits[i + 1];
+	}
+	return _count;
+}
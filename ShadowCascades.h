@@ -0,0 +1,57 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// Most slices a camera's view can be split into for shadows
+// - Must match SHADOW_CASCADE_COUNT in ShaderLighting.hlsli
+#define SHADOW_CASCADE_COUNT 4
+
+// One slice of a camera's view, covered by its own shadow map
+struct ShadowCascade
+{
+	DirectX::XMFLOAT4X4 View;		// Light's view of the slice
+	DirectX::XMFLOAT4X4 Projection;	// Orthographic projection around the slice, snapped to whole texels
+	float NearDistance;				// Distance in front of the camera the slice starts at
+	float FarDistance;				// Distance in front of the camera the slice ends at
+	float Radius;					// Radius of the sphere around the slice (half the map's width in world units)
+	float TexelSize;				// Width of one shadow map texel in world units
+};
+
+// --------------------------------------------------------
+// CPU-side math for cascaded shadow maps
+//
+// Each cascade's map covers a sphere around its slice of the
+// camera's view, so it never changes size as the camera turns,
+// and moves in whole-texel steps, so shadow edges don't shimmer
+// as the camera moves
+// --------------------------------------------------------
+namespace ShadowCascades
+{
+	// Finds where to split the view between _near and _far into _count slices,
+	// blending logarithmic splits (_lambda = 1) with even ones (_lambda = 0).
+	// Writes _count + 1 distances to _splits, starting at _near and ending at _far
+	void ComputeSplits(float _near, float _far, unsigned int _count, float _lambda, float* _splits);
+
+	// Gets the view-space corners of the part of a camera's view between two
+	// distances in front of it: the near corners, then the far corners
+	void ComputeSliceCorners(
+		const DirectX::XMFLOAT4X4& _cameraProjection, float _cameraNear, float _cameraFar,
+		float _sliceNear, float _sliceFar,
+		DirectX::XMFLOAT3 _corners[8]);
+
+	// Builds the light's matrices for a slice, given its view-space corners. The light's
+	// eye is pulled back _lightDistance from the slice's center, and the map is _resolution texels wide
+	ShadowCascade ComputeCascade(
+		const DirectX::XMFLOAT3 _corners[8], const DirectX::XMFLOAT4X4& _cameraView,
+		const DirectX::XMFLOAT3& _lightDirection,
+		float _lightDistance, unsigned int _resolution);
+
+	// Splits a camera's view up to _maxDistance into _count cascades and
+	// builds each one, returning how many were written to _cascades
+	unsigned int ComputeCascades(
+		const DirectX::XMFLOAT4X4& _cameraView, const DirectX::XMFLOAT4X4& _cameraProjection,
+		float _cameraNear, float _cameraFar, float _maxDistance,
+		unsigned int _count, float _lambda,
+		const DirectX::XMFLOAT3& _lightDirection, float _lightDistance, unsigned int _resolution,
+		ShadowCascade* _cascades);
+}
@@ -1,9 +1,22 @@
 #include "SimpleShader.h"
+#include "StateCache.h"
+#include "RingBuffer.h"
 
 // Default error reporting state
 bool ISimpleShader::ReportErrors = false;
 bool ISimpleShader::ReportWarnings = false;
 
+// Upload totals start empty
+unsigned int ISimpleShader::UploadCount = 0;
+unsigned int ISimpleShader::SkippedUploadCount = 0;
+unsigned long long ISimpleShader::UploadedBytes = 0;
+
+// Binds go straight to the device context by default
+StateCache* ISimpleShader::BindCache = nullptr;
+
+// Every buffer has its own constant buffer by default
+RingBuffer* ISimpleShader::ConstantRing = nullptr;
+
 // To enable error reporting, use either or both 
 // of the following lines somewhere in your program, 
 // preferably before loading/using any shaders.
@@ -29,6 +42,14 @@ ISimpleShader::ISimpleShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Micros
 	this->constantBufferCount = 0;
 	this->constantBuffers = 0;
 	this->shaderValid = false;
+
+	// Keep an 11.1 context around, and check whether the
+	// driver can update just part of a constant buffer
+	context.As(&this->deviceContext1);
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	this->partialUpdates = this->deviceContext1
+		&& SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)))
+		&& options.ConstantBufferPartialUpdate;
 }
 
 // --------------------------------------------------------
@@ -198,10 +219,15 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		newBuffDesc.StructureByteStride = 0;
 		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
 
-		// Set up the data buffer for this constant buffer
+		// Set up the data buffer for this constant buffer, padded to match the
+		// buffer itself so partial uploads of the last 16 bytes stay in bounds
 		constantBuffers[b].Size = bufferDesc.Size;
-		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
-		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
+		constantBuffers[b].LocalDataBuffer = new unsigned char[newBuffDesc.ByteWidth];
+		ZeroMemory(constantBuffers[b].LocalDataBuffer, newBuffDesc.ByteWidth);
+
+		// The whole buffer needs uploading the first time
+		constantBuffers[b].DirtyStart = 0;
+		constantBuffers[b].DirtyEnd = newBuffDesc.ByteWidth;
 
 		// Loop through all variables in this buffer
 		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
@@ -345,13 +371,10 @@ void ISimpleShader::CopyAllBufferData()
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
-	// Loop through the constant buffers and copy all data
+	// Loop through the constant buffers and copy any changed data
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+		UploadBuffer(&constantBuffers[i]);
 	}
 }
 
@@ -380,9 +403,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -402,9 +423,126 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
+}
+
+
+// --------------------------------------------------------
+// Uploads whatever part of a constant buffer's local data
+// has changed since it was last uploaded, skipping the
+// upload entirely if nothing has
+//
+// cb - The buffer to upload
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer* cb)
+{
+	// Buffers in the ring are handled separately
+	if (cb->FromRing && ConstantRing && CanBindFromRing() && UploadRingBuffer(cb))
+		return;
+
+	// Nothing changed?
+	if (cb->DirtyStart >= cb->DirtyEnd)
+	{
+		SkippedUploadCount++;
+		return;
+	}
+
+	// Partial updates must cover whole 16-byte constants
+	unsigned int bufferSize = ((cb->Size + 15) / 16) * 16;
+	unsigned int start = cb->DirtyStart & ~15u;
+	unsigned int end = (cb->DirtyEnd + 15) & ~15u;
+	if (end > bufferSize) end = bufferSize;
+
+	if (partialUpdates && (start > 0 || end < bufferSize))
+	{
+		// Copy just the changed range
+		D3D11_BOX box = { start, 0, 0, end, 1, 1 };
+		deviceContext1->UpdateSubresource1(
+			cb->ConstantBuffer.Get(), 0, &box,
+			cb->LocalDataBuffer + start, 0, 0, 0);
+		UploadedBytes += end - start;
+	}
+	else
+	{
+		// Copy the entire local data buffer
+		deviceContext->UpdateSubresource(
+			cb->ConstantBuffer.Get(), 0, 0,
+			cb->LocalDataBuffer, 0, 0);
+		UploadedBytes += bufferSize;
+	}
+	UploadCount++;
+
+	// Everything's up to date now, so empty the range
+	cb->DirtyStart = bufferSize;
+	cb->DirtyEnd = 0;
+}
+
+// --------------------------------------------------------
+// Writes a constant buffer's local data into the next free
+// spot in ConstantRing and binds it there. Nothing is
+// written if nothing's changed and the last copy is still
+// in the ring, since it's still bound.
+//
+// cb - The buffer to upload
+//
+// Returns false if the ring couldn't be mapped, in which
+// case the buffer goes back to its own constant buffer
+// --------------------------------------------------------
+bool ISimpleShader::UploadRingBuffer(SimpleConstantBuffer* cb)
+{
+	if (cb->DirtyStart >= cb->DirtyEnd && cb->RingGeneration == ConstantRing->GetGeneration())
+	{
+		SkippedUploadCount++;
+		return true;
+	}
+
+	// Ranges bound by offset have to start and end on a
+	// multiple of 16 constants (256 bytes)
+	unsigned int bufferSize = ((cb->Size + 15) / 16) * 16;
+	unsigned int ringSize = ((cb->Size + 255) / 256) * 256;
+	unsigned int offset = 0;
+	void* destination = ConstantRing->Map(ringSize, 256, offset);
+	if (!destination)
+	{
+		// Its own buffer has none of the data written to the ring
+		cb->FromRing = false;
+		cb->DirtyStart = 0;
+		cb->DirtyEnd = bufferSize;
+		BindConstantBuffer(cb);
+		return false;
+	}
+
+	memcpy(destination, cb->LocalDataBuffer, bufferSize);
+	ConstantRing->Unmap();
+	cb->RingOffset = offset;
+	cb->RingGeneration = ConstantRing->GetGeneration();
+	UploadedBytes += bufferSize;
+	UploadCount++;
+
+	// The data's somewhere new, so it needs binding again
+	BindConstantBuffer(cb);
+
+	cb->DirtyStart = bufferSize;
+	cb->DirtyEnd = 0;
+	return true;
+}
+
+// --------------------------------------------------------
+// Marks a buffer to be uploaded to ConstantRing from now on
+//
+// bufferName - The name of the buffer
+//
+// Returns false if there's no such buffer, or this kind of
+// shader can't bind part of the ring
+// --------------------------------------------------------
+bool ISimpleShader::SetBufferFromRing(std::string bufferName)
+{
+	SimpleConstantBuffer* cb = this->FindConstantBuffer(bufferName);
+	if (!cb || !CanBindFromRing())
+		return false;
+
+	cb->FromRing = true;
+	return true;
 }
 
 
@@ -420,8 +558,8 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 bool ISimpleShader::SetData(std::string name, const void* data, unsigned int size)
 {
 	// Look for the variable and verify
-	SimpleShaderVariable* var = FindVariable(name, -1);
-	if (var == 0)
+	SimpleShaderHandle handle = GetVariableHandle(name);
+	if (!handle.IsValid())
 	{
 		if (ReportWarnings)
 		{
@@ -433,8 +571,9 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 	}
 
 	// Ensure we're not trying to copy more data than the variable can hold
+	// here, where the variable's name is still around for the warning
 	// Note: We can copy less data, in the case of a subset of an array
-	if (size > var->Size)
+	if (size > handle.Size)
 	{
 		if (ReportWarnings)
 		{
@@ -445,14 +584,8 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		return false;
 	}
 
-	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
-
-	// Success
-	return true;
+	// The rest is the same as setting it through a handle
+	return SetData(handle, data, size);
 }
 
 // --------------------------------------------------------
@@ -535,6 +668,126 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 dat
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
 
+// --------------------------------------------------------
+// Looks up a variable by name and returns a handle to it,
+// which can be kept and used to set the variable without
+// looking it up again
+//
+// name - The name of the shader variable
+//
+// Returns an invalid handle if the variable doesn't exist
+// --------------------------------------------------------
+SimpleShaderHandle ISimpleShader::GetVariableHandle(const std::string& name)
+{
+	SimpleShaderHandle handle;
+
+	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
+		varTable.find(name);
+	if (result == varTable.end())
+		return handle;
+
+	handle.ConstantBufferIndex = result->second.ConstantBufferIndex;
+	handle.ByteOffset = result->second.ByteOffset;
+	handle.Size = result->second.Size;
+	return handle;
+}
+
+// --------------------------------------------------------
+// Sets a variable through a handle with arbitrary data of
+// the specified size
+//
+// handle - A handle from this shader's GetVariableHandle()
+// data - The data to set in the buffer
+// size - The size of the data (this must be less than or equal to the variable's size)
+//
+// Returns true if data is copied, false if the handle is invalid
+// --------------------------------------------------------
+bool ISimpleShader::SetData(SimpleShaderHandle handle, const void* data, unsigned int size)
+{
+	// Invalid handles are for variables this shader doesn't have,
+	// which is expected when the same handles are looked up on
+	// several shaders, so there's nothing to warn about
+	if (!handle.IsValid() || handle.ConstantBufferIndex >= constantBufferCount)
+		return false;
+
+	// Ensure we're not trying to copy more data than the variable can hold
+	// Note: We can copy less data, in the case of a subset of an array
+	if (size > handle.Size)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleShader::SetData() - Shader variable is smaller than the size of the data being set. Ensure the variable is large enough for the specified data.\n");
+		}
+		return false;
+	}
+
+	// Data that's already there doesn't need uploading again
+	SimpleConstantBuffer* cb = &constantBuffers[handle.ConstantBufferIndex];
+	unsigned char* destination = cb->LocalDataBuffer + handle.ByteOffset;
+	if (memcmp(destination, data, size) == 0)
+		return true;
+
+	// Set the data in the local data buffer
+	memcpy(destination, data, size);
+
+	// Grow the range that needs uploading to include it (an empty
+	// range starts past the end of the buffer and ends at 0, so this
+	// works whether or not anything else has changed)
+	cb->DirtyStart = min(cb->DirtyStart, handle.ByteOffset);
+	cb->DirtyEnd = max(cb->DirtyEnd, handle.ByteOffset + size);
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets INTEGER data through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetInt(SimpleShaderHandle handle, int data)
+{
+	return this->SetData(handle, &data, sizeof(int));
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat(SimpleShaderHandle handle, float data)
+{
+	return this->SetData(handle, &data, sizeof(float));
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT2 variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat2(SimpleShaderHandle handle, const DirectX::XMFLOAT2& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 2);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT3 variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat3(SimpleShaderHandle handle, const DirectX::XMFLOAT3& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 3);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT4 variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat4(SimpleShaderHandle handle, const DirectX::XMFLOAT4& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 4);
+}
+
+// --------------------------------------------------------
+// Sets a MATRIX (4x4) variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetMatrix4x4(SimpleShaderHandle handle, const DirectX::XMFLOAT4X4& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 16);
+}
+
 // --------------------------------------------------------
 // Determines if the shader contains the specified
 // variable within one of its constant buffers
@@ -721,6 +974,30 @@ SimpleVertexShader::SimpleVertexShader(Microsoft::WRL::ComPtr<ID3D11Device> devi
 	this->LoadShaderFile(shaderFile);
 }
 
+// --------------------------------------------------------
+// Constructor overload which takes input element descriptions
+//
+// The input layout is created from these elements instead of
+// shader reflection, which is needed for vertex formats whose
+// data types differ from the shader's inputs (e.g. SNORM or
+// half-precision data read as floats)
+// --------------------------------------------------------
+SimpleVertexShader::SimpleVertexShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, LPCWSTR shaderFile, const D3D11_INPUT_ELEMENT_DESC* inputElements, unsigned int inputElementCount)
+	: ISimpleShader(device, context)
+{
+	// Save the elements until the shader's code is loaded
+	this->inputElements.assign(inputElements, inputElements + inputElementCount);
+
+	// Per-instance compatible if any element comes from instance data
+	this->perInstanceCompatible = false;
+	for (unsigned int i = 0; i < inputElementCount; i++)
+		if (inputElements[i].InputSlotClass == D3D11_INPUT_PER_INSTANCE_DATA)
+			this->perInstanceCompatible = true;
+
+	// Load the actual compiled shader file
+	this->LoadShaderFile(shaderFile);
+}
+
 // --------------------------------------------------------
 // Destructor - Clean up actual shader (base will be called automatically)
 // --------------------------------------------------------
@@ -766,6 +1043,18 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 	if (inputLayout)
 		return true;
 
+	// Were we given the elements to create one from?
+	if (!inputElements.empty())
+	{
+		HRESULT hr = device->CreateInputLayout(
+			&inputElements[0],
+			(unsigned int)inputElements.size(),
+			shaderBlob->GetBufferPointer(),
+			shaderBlob->GetBufferSize(),
+			inputLayout.GetAddressOf());
+		return SUCCEEDED(hr);
+	}
+
 	// Vertex shader was created successfully, so we now use the
 	// shader code to re-reflect and create an input layout that 
 	// matches what the vertex shader expects.  Code adapted from:
@@ -869,8 +1158,16 @@ void SimpleVertexShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader and input layout
-	deviceContext->IASetInputLayout(inputLayout.Get());
-	deviceContext->VSSetShader(shader.Get(), 0, 0);
+	if (BindCache)
+	{
+		BindCache->SetInputLayout(inputLayout.Get());
+		BindCache->SetVertexShader(shader.Get());
+	}
+	else
+	{
+		deviceContext->IASetInputLayout(inputLayout.Get());
+		deviceContext->VSSetShader(shader.Get(), 0, 0);
+	}
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -880,13 +1177,43 @@ void SimpleVertexShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->VSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(&constantBuffers[i]);
 	}
 }
 
+// --------------------------------------------------------
+// Vertex shaders can bind part of ConstantRing with the
+// Direct3D 11.1 context
+// --------------------------------------------------------
+bool SimpleVertexShader::CanBindFromRing()
+{
+	return deviceContext1 != nullptr;
+}
+
+// --------------------------------------------------------
+// Binds one constant buffer to the vertex shader stage, or
+// where its data was last written in ConstantRing
+// --------------------------------------------------------
+void SimpleVertexShader::BindConstantBuffer(SimpleConstantBuffer* cb)
+{
+	ID3D11Buffer* buffer = cb->ConstantBuffer.Get();
+	unsigned int firstConstant = 0;
+	unsigned int constantCount = 0;
+	if (cb->FromRing && ConstantRing && CanBindFromRing())
+	{
+		buffer = ConstantRing->GetBuffer();
+		firstConstant = cb->RingOffset / 16;
+		constantCount = ((cb->Size + 255) / 256) * 16;
+	}
+
+	if (BindCache)
+		BindCache->SetVertexConstantBuffer(cb->BindIndex, buffer, firstConstant, constantCount);
+	else if (constantCount > 0)
+		deviceContext1->VSSetConstantBuffers1(cb->BindIndex, 1, &buffer, &firstConstant, &constantCount);
+	else
+		deviceContext->VSSetConstantBuffers(cb->BindIndex, 1, &buffer);
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the vertex shader stage
 //
@@ -911,7 +1238,10 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 	}
 
 	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (BindCache)
+		BindCache->SetVertexShaderResource(srvInfo->BindIndex, srv.Get());
+	else
+		deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -941,7 +1271,10 @@ bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 	}
 
 	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	if (BindCache)
+		BindCache->SetVertexSampler(sampInfo->BindIndex, samplerState.Get());
+	else
+		deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1012,7 +1345,10 @@ void SimplePixelShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 	
 	// Set the shader
-	deviceContext->PSSetShader(shader.Get(), 0, 0);
+	if (BindCache)
+		BindCache->SetPixelShader(shader.Get());
+	else
+		deviceContext->PSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1022,11 +1358,41 @@ void SimplePixelShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->PSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(&constantBuffers[i]);
+	}
+}
+
+// --------------------------------------------------------
+// Pixel shaders can bind part of ConstantRing with the
+// Direct3D 11.1 context
+// --------------------------------------------------------
+bool SimplePixelShader::CanBindFromRing()
+{
+	return deviceContext1 != nullptr;
+}
+
+// --------------------------------------------------------
+// Binds one constant buffer to the pixel shader stage, or
+// where its data was last written in ConstantRing
+// --------------------------------------------------------
+void SimplePixelShader::BindConstantBuffer(SimpleConstantBuffer* cb)
+{
+	ID3D11Buffer* buffer = cb->ConstantBuffer.Get();
+	unsigned int firstConstant = 0;
+	unsigned int constantCount = 0;
+	if (cb->FromRing && ConstantRing && CanBindFromRing())
+	{
+		buffer = ConstantRing->GetBuffer();
+		firstConstant = cb->RingOffset / 16;
+		constantCount = ((cb->Size + 255) / 256) * 16;
 	}
+
+	if (BindCache)
+		BindCache->SetPixelConstantBuffer(cb->BindIndex, buffer, firstConstant, constantCount);
+	else if (constantCount > 0)
+		deviceContext1->PSSetConstantBuffers1(cb->BindIndex, 1, &buffer, &firstConstant, &constantCount);
+	else
+		deviceContext->PSSetConstantBuffers(cb->BindIndex, 1, &buffer);
 }
 
 // --------------------------------------------------------
@@ -1053,7 +1419,10 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 	}
 
 	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (BindCache)
+		BindCache->SetPixelShaderResource(srvInfo->BindIndex, srv.Get());
+	else
+		deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1083,7 +1452,10 @@ bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr
 	}
 
 	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	if (BindCache)
+		BindCache->SetPixelSampler(sampInfo->BindIndex, samplerState.Get());
+	else
+		deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -3,6 +3,7 @@
 #pragma comment(lib, "d3dcompiler.lib")
 
 #include <d3d11.h>
+#include <d3d11_1.h>
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 #include <wrl/client.h>
@@ -11,6 +12,8 @@
 #include <vector>
 #include <string>
 
+class StateCache;
+class RingBuffer;
 
 // --------------------------------------------------------
 // Used by simple shaders to store information about
@@ -23,6 +26,21 @@ struct SimpleShaderVariable
 	unsigned int ConstantBufferIndex;
 };
 
+// --------------------------------------------------------
+// A variable's location within one specific shader, looked
+// up once by name with ISimpleShader::GetVariableHandle()
+// so it can be set repeatedly without any string lookups.
+// Only valid for the shader it came from
+// --------------------------------------------------------
+struct SimpleShaderHandle
+{
+	unsigned int ConstantBufferIndex = 0;
+	unsigned int ByteOffset = 0;
+	unsigned int Size = 0;	// 0 if the variable doesn't exist
+
+	bool IsValid() const { return Size > 0; }
+};
+
 // --------------------------------------------------------
 // Contains information about a specific
 // constant buffer in a shader, as well as
@@ -37,6 +55,18 @@ struct SimpleConstantBuffer
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer = 0;
 	unsigned char* LocalDataBuffer = 0;
 	std::vector<SimpleShaderVariable> Variables;
+
+	// Bytes of LocalDataBuffer changed since it was last uploaded, from
+	// DirtyStart up to DirtyEnd. Empty (nothing to upload) when DirtyStart >= DirtyEnd
+	unsigned int DirtyStart = 0;
+	unsigned int DirtyEnd = 0;
+
+	// Whether the data is uploaded to ISimpleShader::ConstantRing instead
+	// of ConstantBuffer, and where and in which of the ring's generations
+	// it was last uploaded to
+	bool FromRing = false;
+	unsigned int RingOffset = 0;
+	unsigned long long RingGeneration = 0;
 };
 
 // --------------------------------------------------------
@@ -89,6 +119,18 @@ public:
 	bool SetMatrix4x4(std::string name, const float data[16]);
 	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
 
+	// Looks up a variable once, so it can be set through a handle
+	SimpleShaderHandle GetVariableHandle(const std::string& name);
+
+	// Sets shader data through a handle, with no string lookups
+	bool SetData(SimpleShaderHandle handle, const void* data, unsigned int size);
+	bool SetInt(SimpleShaderHandle handle, int data);
+	bool SetFloat(SimpleShaderHandle handle, float data);
+	bool SetFloat2(SimpleShaderHandle handle, const DirectX::XMFLOAT2& data);
+	bool SetFloat3(SimpleShaderHandle handle, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(SimpleShaderHandle handle, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(SimpleShaderHandle handle, const DirectX::XMFLOAT4X4& data);
+
 	// Setting shader resources
 	virtual bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
 	virtual bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
@@ -114,6 +156,10 @@ public:
 	unsigned int GetBufferSize(unsigned int index);
 	const SimpleConstantBuffer* GetBufferInfo(std::string name);
 	const SimpleConstantBuffer* GetBufferInfo(unsigned int index);
+
+	// Uploads a buffer to ConstantRing instead of its own constant buffer, for
+	// buffers that change every draw (vertex and pixel shaders only)
+	bool SetBufferFromRing(std::string bufferName);
 	
 	// Misc getters
 	Microsoft::WRL::ComPtr<ID3DBlob> GetShaderBlob() { return shaderBlob; }
@@ -122,6 +168,21 @@ public:
 	static bool ReportErrors;
 	static bool ReportWarnings;
 
+	// Constant buffer uploads made by every shader since these were
+	// last reset, for measuring how much data is sent to the GPU
+	static unsigned int UploadCount;
+	static unsigned int SkippedUploadCount;	// Buffers that were already up to date
+	static unsigned long long UploadedBytes;
+
+	// If set, vertex and pixel shaders bind through this instead of
+	// straight to their device contexts, so redundant binds are skipped
+	static StateCache* BindCache;
+
+	// If set, buffers marked with SetBufferFromRing() are written into this
+	// and bound by offset, which needs a Direct3D 11.1 context and a driver
+	// that can map dynamic constant buffers with WRITE_NO_OVERWRITE
+	static RingBuffer* ConstantRing;
+
 protected:
 	
 	bool shaderValid;
@@ -129,6 +190,11 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
 
+	// Direct3D 11.1 context, for uploading only part of a constant
+	// buffer and binding buffers by offset (null before Direct3D 11.1)
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> deviceContext1;
+	bool partialUpdates;
+
 	// Resource counts
 	unsigned int constantBufferCount;
 	
@@ -150,6 +216,15 @@ protected:
 
 	virtual void CleanUp();
 
+	// Uploads the changed part of a constant buffer, if any
+	void UploadBuffer(SimpleConstantBuffer* cb);
+	bool UploadRingBuffer(SimpleConstantBuffer* cb);
+
+	// Whether this shader's stage can bind part of ConstantRing, and
+	// binds one buffer (or its place in the ring) if so
+	virtual bool CanBindFromRing() { return false; }
+	virtual void BindConstantBuffer(SimpleConstantBuffer* cb) { }
+
 	// Helpers for finding data by name
 	SimpleShaderVariable* FindVariable(std::string name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
@@ -173,6 +248,7 @@ class SimpleVertexShader : public ISimpleShader
 public:
 	SimpleVertexShader( Microsoft::WRL::ComPtr<ID3D11Device> device,  Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, LPCWSTR shaderFile);
 	SimpleVertexShader( Microsoft::WRL::ComPtr<ID3D11Device> device,  Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, LPCWSTR shaderFile, Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout, bool perInstanceCompatible);
+	SimpleVertexShader( Microsoft::WRL::ComPtr<ID3D11Device> device,  Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, LPCWSTR shaderFile, const D3D11_INPUT_ELEMENT_DESC* inputElements, unsigned int inputElementCount);
 	~SimpleVertexShader();
 	Microsoft::WRL::ComPtr<ID3D11VertexShader> GetDirectXShader() { return shader; }
 	Microsoft::WRL::ComPtr<ID3D11InputLayout> GetInputLayout() { return inputLayout; }
@@ -184,9 +260,12 @@ public:
 protected:
 	bool perInstanceCompatible;
 	 Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+	std::vector<D3D11_INPUT_ELEMENT_DESC> inputElements;
 	 Microsoft::WRL::ComPtr<ID3D11VertexShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	bool CanBindFromRing();
+	void BindConstantBuffer(SimpleConstantBuffer* cb);
 	void CleanUp();
 };
 
@@ -208,6 +287,8 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	bool CanBindFromRing();
+	void BindConstantBuffer(SimpleConstantBuffer* cb);
 	void CleanUp();
 };
 
@@ -0,0 +1,184 @@
+#include <cstdint>
+
+#include "StateCache.h"
+
+namespace
+{
+	// Marks a slot whose contents the cache doesn't know
+	template <typename T> T* Unknown()
+	{
+		return reinterpret_cast<T*>(UINTPTR_MAX);
+	}
+
+	template <typename T, size_t N> void Forget(T* (&_slots)[N])
+	{
+		for (size_t i = 0; i < N; i++) {
+			_slots[i] = Unknown<T>();
+		}
+	}
+}
+
+/// <summary>
+/// Creates a cache that knows nothing about what's bound yet
+/// </summary>
+/// <param name="_context">Device context binds are passed on to</param>
+StateCache::StateCache(Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context) :
+	context(_context)
+{
+	context.As(&context1);
+	Invalidate();
+	ResetStats();
+}
+
+// Plain pointers are enough to compare binds with: the context holds
+// a reference to everything that's bound, so nothing the cache thinks is
+// bound can be freed (and its address reused) without the cache seeing
+// something else bound in its place first
+
+void StateCache::SetInputLayout(ID3D11InputLayout* _inputLayout)
+{
+	if (Change(inputLayout, _inputLayout)) {
+		context->IASetInputLayout(_inputLayout);
+	}
+}
+
+void StateCache::SetVertexShader(ID3D11VertexShader* _shader)
+{
+	if (Change(vertexShader, _shader)) {
+		context->VSSetShader(_shader, 0, 0);
+	}
+}
+
+void StateCache::SetPixelShader(ID3D11PixelShader* _shader)
+{
+	if (Change(pixelShader, _shader)) {
+		context->PSSetShader(_shader, 0, 0);
+	}
+}
+
+void StateCache::SetVertexConstantBuffer(unsigned int _slot, ID3D11Buffer* _buffer, unsigned int _firstConstant, unsigned int _constantCount)
+{
+	if (ChangeConstantBuffer(vertexConstantBuffers[_slot], vertexConstantRanges[_slot], _buffer, { _firstConstant, _constantCount })) {
+		if (_constantCount > 0 && context1) {
+			context1->VSSetConstantBuffers1(_slot, 1, &_buffer, &_firstConstant, &_constantCount);
+		}
+		else {
+			context->VSSetConstantBuffers(_slot, 1, &_buffer);
+		}
+	}
+}
+
+void StateCache::SetPixelConstantBuffer(unsigned int _slot, ID3D11Buffer* _buffer, unsigned int _firstConstant, unsigned int _constantCount)
+{
+	if (ChangeConstantBuffer(pixelConstantBuffers[_slot], pixelConstantRanges[_slot], _buffer, { _firstConstant, _constantCount })) {
+		if (_constantCount > 0 && context1) {
+			context1->PSSetConstantBuffers1(_slot, 1, &_buffer, &_firstConstant, &_constantCount);
+		}
+		else {
+			context->PSSetConstantBuffers(_slot, 1, &_buffer);
+		}
+	}
+}
+
+void StateCache::SetVertexShaderResource(unsigned int _slot, ID3D11ShaderResourceView* _srv)
+{
+	if (Change(vertexShaderResources[_slot], _srv)) {
+		context->VSSetShaderResources(_slot, 1, &_srv);
+	}
+}
+
+void StateCache::SetPixelShaderResource(unsigned int _slot, ID3D11ShaderResourceView* _srv)
+{
+	if (Change(pixelShaderResources[_slot], _srv)) {
+		context->PSSetShaderResources(_slot, 1, &_srv);
+	}
+}
+
+void StateCache::SetVertexSampler(unsigned int _slot, ID3D11SamplerState* _sampler)
+{
+	if (Change(vertexSamplers[_slot], _sampler)) {
+		context->VSSetSamplers(_slot, 1, &_sampler);
+	}
+}
+
+void StateCache::SetPixelSampler(unsigned int _slot, ID3D11SamplerState* _sampler)
+{
+	if (Change(pixelSamplers[_slot], _sampler)) {
+		context->PSSetSamplers(_slot, 1, &_sampler);
+	}
+}
+
+/// <summary>
+/// Forgets what's bound to every slot, for after something
+/// changes the pipeline without going through the cache
+/// </summary>
+void StateCache::Invalidate()
+{
+	inputLayout = Unknown<ID3D11InputLayout>();
+	vertexShader = Unknown<ID3D11VertexShader>();
+	pixelShader = Unknown<ID3D11PixelShader>();
+	Forget(vertexConstantBuffers);
+	Forget(pixelConstantBuffers);
+	Forget(vertexSamplers);
+	Forget(pixelSamplers);
+	InvalidateShaderResources();
+}
+
+/// <summary>
+/// Forgets what's bound to every SRV slot, for after binding
+/// render or depth targets that might have been bound as SRVs
+/// (which D3D11 quietly unbinds)
+/// </summary>
+void StateCache::InvalidateShaderResources()
+{
+	Forget(vertexShaderResources);
+	Forget(pixelShaderResources);
+}
+
+StateCacheStats StateCache::GetStats()
+{
+	return stats;
+}
+
+void StateCache::ResetStats()
+{
+	stats = {};
+}
+
+/// <summary>
+/// Records a bind to a slot, counting it as issued or skipped
+/// </summary>
+/// <param name="_current">What the cache thinks the slot holds, updated to _new</param>
+/// <param name="_new">Object being bound</param>
+/// <returns>Whether the bind needs to be passed on to the context</returns>
+template <typename T> bool StateCache::Change(T*& _current, T* _new)
+{
+	if (_current == _new) {
+		stats.Skipped++;
+		return false;
+	}
+	_current = _new;
+	stats.Issued++;
+	return true;
+}
+
+/// <summary>
+/// Records a bind to a constant buffer slot, which only
+/// matches what's there if the range matches too
+/// </summary>
+/// <param name="_current">What the cache thinks the slot holds, updated to _new</param>
+/// <param name="_currentRange">Range of _current the cache thinks is bound, updated to _newRange</param>
+/// <param name="_new">Buffer being bound</param>
+/// <param name="_newRange">Range of _new being bound</param>
+/// <returns>Whether the bind needs to be passed on to the context</returns>
+bool StateCache::ChangeConstantBuffer(ID3D11Buffer*& _current, ConstantRange& _currentRange, ID3D11Buffer* _new, ConstantRange _newRange)
+{
+	if (_current == _new && _currentRange.First == _newRange.First && _currentRange.Count == _newRange.Count) {
+		stats.Skipped++;
+		return false;
+	}
+	_current = _new;
+	_currentRange = _newRange;
+	stats.Issued++;
+	return true;
+}
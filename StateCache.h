@@ -0,0 +1,87 @@
+#pragma once
+
+#include <d3d11.h>
+#include <d3d11_1.h>
+#include <wrl/client.h>
+
+// How many binds went through a StateCache since its stats were last reset
+struct StateCacheStats
+{
+	unsigned int Issued;	// Passed on to the device context
+	unsigned int Skipped;	// Dropped because the slot already held the same object
+};
+
+// --------------------------------------------------------
+// Sits in front of a device context and remembers what's
+// bound to the vertex and pixel shader stages: shaders, the
+// input layout, and each slot's constant buffer, SRV and
+// sampler. Binds that wouldn't change anything are dropped.
+// Constant buffers can also be bound by range (with the
+// Direct3D 11.1 context), and count as the same bind only if
+// the range is the same too.
+//
+// Only binds made through the cache are tracked, so call
+// Invalidate() after anything else changes these stages
+// (like ImGui drawing). Binding a resource as a render or
+// depth target also unbinds it as an SRV, so call
+// InvalidateShaderResources() after doing that with
+// anything that might already be bound as an SRV.
+// --------------------------------------------------------
+class StateCache
+{
+public:
+	StateCache(Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context);
+
+	void SetInputLayout(ID3D11InputLayout* _inputLayout);
+	void SetVertexShader(ID3D11VertexShader* _shader);
+	void SetPixelShader(ID3D11PixelShader* _shader);
+
+	// A _constantCount of 0 binds the whole buffer. Otherwise
+	// both are in 16-byte constants and multiples of 16
+	void SetVertexConstantBuffer(unsigned int _slot, ID3D11Buffer* _buffer, unsigned int _firstConstant = 0, unsigned int _constantCount = 0);
+	void SetPixelConstantBuffer(unsigned int _slot, ID3D11Buffer* _buffer, unsigned int _firstConstant = 0, unsigned int _constantCount = 0);
+	void SetVertexShaderResource(unsigned int _slot, ID3D11ShaderResourceView* _srv);
+	void SetPixelShaderResource(unsigned int _slot, ID3D11ShaderResourceView* _srv);
+	void SetVertexSampler(unsigned int _slot, ID3D11SamplerState* _sampler);
+	void SetPixelSampler(unsigned int _slot, ID3D11SamplerState* _sampler);
+
+	// Forgets everything, so the next bind to every slot goes through
+	void Invalidate();
+	// Forgets just the SRVs
+	void InvalidateShaderResources();
+
+	StateCacheStats GetStats();
+	void ResetStats();
+
+private:
+	// Part of a buffer bound to a constant buffer slot
+	struct ConstantRange
+	{
+		unsigned int First;
+		unsigned int Count;	// 0 for the whole buffer
+	};
+
+	// Records a bind to a slot, returning whether it changes anything
+	template <typename T> bool Change(T*& _current, T* _new);
+	bool ChangeConstantBuffer(ID3D11Buffer*& _current, ConstantRange& _currentRange, ID3D11Buffer* _new, ConstantRange _newRange);
+
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	// For binding constant buffer ranges (null before Direct3D 11.1)
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> context1;
+
+	// What the cache knows is bound. Unknown slots are marked with
+	// a value no real object can have, so the next bind always goes through
+	ID3D11InputLayout* inputLayout;
+	ID3D11VertexShader* vertexShader;
+	ID3D11PixelShader* pixelShader;
+	ID3D11Buffer* vertexConstantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	ID3D11Buffer* pixelConstantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	ConstantRange vertexConstantRanges[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	ConstantRange pixelConstantRanges[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	ID3D11ShaderResourceView* vertexShaderResources[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
+	ID3D11ShaderResourceView* pixelShaderResources[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
+	ID3D11SamplerState* vertexSamplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+	ID3D11SamplerState* pixelSamplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+
+	StateCacheStats stats;
+};
@@ -3,22 +3,30 @@
 using namespace DirectX;
 
 /// <summary>
-/// Constructs a Transformation with no translation, no rotation, normal scale
+/// Constructs a Transformation with no translation, no rotation, normal scale,
+/// stored in the shared TransformSystem
 /// </summary>
 Transform::Transform() :
-	position(0.0f, 0.0f, 0.0f),
-	rotation(0.0f, 0.0f, 0.0f),
-	scale(1.0f, 1.0f, 1.0f),
-	right(1.0f, 0.0f, 0.0f),
-	up(0.0f, 1.0f, 0.0f),
-	forward(0.0f, 0.0f, 1.0f)
+	Transform(TransformSystem::Global())
 {
-	XMStoreFloat4x4(&world, XMMatrixIdentity());
-	XMStoreFloat4x4(&worldInverseTranspose,
-		XMMatrixInverse(0, XMMatrixTranspose(XMMatrixIdentity()))
-	);
-	areMatricesDirty = false;
-	areVerticesDirty = false;
+}
+
+/// <summary>
+/// Constructs a Transformation with no translation, no rotation, normal scale
+/// </summary>
+/// <param name="_system">The TransformSystem to store the Transform's data in</param>
+Transform::Transform(TransformSystem& _system) :
+	system(&_system),
+	id(_system.Create())
+{
+}
+
+/// <summary>
+/// Gives the Transform's data back to its TransformSystem
+/// </summary>
+Transform::~Transform()
+{
+	system->Destroy(id);
 }
 
 /// <summary>
@@ -27,16 +35,27 @@ Transform::Transform() :
 /// <returns>The Transform's x, y, and z positions</returns>
 DirectX::XMFLOAT3 Transform::GetPosition()
 {
-	return position;
+	return system->GetPosition(id);
 }
 
 /// <summary>
-/// Gets the Transform's rotation
+/// Gets the Transform's rotation. If it uses quaternion rotation,
+/// this is worked out from its quaternion, so it may not match
+/// the angles it was last given
 /// </summary>
 /// <returns>The Transform's rotations about the X, Y, and Z axes</returns>
 DirectX::XMFLOAT3 Transform::GetRotation()
 {
-	return rotation;
+	return system->GetRotation(id);
+}
+
+/// <summary>
+/// Gets the Transform's rotation as a quaternion
+/// </summary>
+/// <returns>The quaternion the Transform's matrices are built from</returns>
+DirectX::XMFLOAT4 Transform::GetOrientation()
+{
+	return system->GetOrientation(id);
 }
 
 /// <summary>
@@ -45,69 +64,84 @@ DirectX::XMFLOAT3 Transform::GetRotation()
 /// <returns>The Transform's scale along the x, y, and z axes</returns>
 DirectX::XMFLOAT3 Transform::GetScale()
 {
-	return scale;
+	return system->GetScale(id);
+}
+
+/// <summary>
+/// Gets the Transform's version, which goes up every time it changes, and when its
+/// parent moves once its matrices are rebuilt. Comparing it to a version saved
+/// earlier shows whether the Transform moved since then
+/// </summary>
+/// <returns>The number of changes made to the Transform</returns>
+unsigned long long Transform::GetVersion()
+{
+	return system->GetVersion(id);
+}
+
+/// <summary>
+/// Gets whether the Transform keeps its rotation as only a quaternion
+/// </summary>
+/// <returns>Whether Rotate() composes quaternions instead of adding angles</returns>
+bool Transform::GetQuaternionRotation()
+{
+	return system->GetQuaternionRotation(id);
+}
+
+/// <summary>
+/// Gets the ID the Transform's data has in its TransformSystem, so
+/// it can be read from the system directly
+/// </summary>
+/// <returns>The Transform's ID</returns>
+unsigned int Transform::GetID()
+{
+	return id;
 }
 
 /// <summary>
 /// Gets the Transform's world matrix.
-/// Rebuilds matrices if they have been mutated
+/// Rebuilds matrices if they have been mutated since TransformSystem::UpdateMatrices()
 /// </summary>
 /// <returns>The world matrix representing the Transform</returns>
 DirectX::XMFLOAT4X4 Transform::GetWorld()
 {
-	if (areMatricesDirty) {
-		RebuildMatrices();
-	}
-	return world;
+	return system->GetWorld(id);
 }
 
 /// <summary>
-/// Sets the Transform's world inverse transpose matrix.
-/// Rebuilds matrices if they have been mutated
+/// Gets the Transform's world inverse transpose matrix.
+/// Rebuilds matrices if they have been mutated since TransformSystem::UpdateMatrices()
 /// </summary>
 /// <returns>The transposed then inverted world matrix representing the Transform</returns>
 DirectX::XMFLOAT4X4 Transform::GetWorldInverseTranspose()
 {
-	if (areMatricesDirty) {
-		RebuildMatrices();
-	}
-	return worldInverseTranspose;
+	return system->GetWorldInverseTranspose(id);
 }
 
 /// <summary>
 /// Gets the Transform's forward vector
 /// </summary>
-/// <returns>The Transform's forward vector</returns>
+/// <returns>The Transform's forward vector, from its rotation matrix</returns>
 DirectX::XMFLOAT3 Transform::GetForward()
 {
-	if (areVerticesDirty) {
-		RebuildVertices();
-	}
-	return forward;
+	return system->GetForward(id);
 }
 
 /// <summary>
 /// Gets the Transform's right vector
 /// </summary>
-/// <returns>The Transform's right vector</returns>
+/// <returns>The Transform's right vector, from its rotation matrix</returns>
 DirectX::XMFLOAT3 Transform::GetRight()
 {
-	if (areVerticesDirty) {
-		RebuildVertices();
-	}
-	return right;
+	return system->GetRight(id);
 }
 
 /// <summary>
 /// Gets the Transform's up vector
 /// </summary>
-/// <returns>The Transform's up vector</returns>
+/// <returns>The Transform's up vector, from its rotation matrix</returns>
 DirectX::XMFLOAT3 Transform::GetUp()
 {
-	if (areVerticesDirty) {
-		RebuildVertices();
-	}
-	return up;
+	return system->GetUp(id);
 }
 
 /// <summary>
@@ -118,8 +152,7 @@ DirectX::XMFLOAT3 Transform::GetUp()
 /// <param name="_z">The Transform's new Z position</param>
 void Transform::SetPosition(float _x, float _y, float _z)
 {
-	position = XMFLOAT3(_x, _y, _z);
-	areMatricesDirty = true;
+	system->SetPosition(id, XMFLOAT3(_x, _y, _z));
 }
 
 /// <summary>
@@ -128,8 +161,7 @@ void Transform::SetPosition(float _x, float _y, float _z)
 /// <param name="_xyz">The Transform's new X, Y, and Z positions</param>
 void Transform::SetPosition(DirectX::XMFLOAT3 _xyz)
 {
-	position = _xyz;
-	areMatricesDirty = true;
+	system->SetPosition(id, _xyz);
 }
 
 /// <summary>
@@ -140,9 +172,7 @@ void Transform::SetPosition(DirectX::XMFLOAT3 _xyz)
 /// <param name="_roll">The Transform's new rotation about the Z axis</param>
 void Transform::SetRotation(float _pitch, float _yaw, float _roll)
 {
-	rotation = XMFLOAT3(_pitch, _yaw, _roll);
-	areMatricesDirty = true;
-	areVerticesDirty = true;
+	system->SetRotation(id, XMFLOAT3(_pitch, _yaw, _roll));
 }
 
 /// <summary>
@@ -151,9 +181,16 @@ void Transform::SetRotation(float _pitch, float _yaw, float _roll)
 /// <param name="_pitchYawRoll">The Transform's new rotation about the X, Y, and Z axes</param>
 void Transform::SetRotation(DirectX::XMFLOAT3 _pitchYawRoll)
 {
-	rotation = _pitchYawRoll;
-	areMatricesDirty = true;
-	areVerticesDirty = true;
+	system->SetRotation(id, _pitchYawRoll);
+}
+
+/// <summary>
+/// Sets the Transform's rotation from a quaternion
+/// </summary>
+/// <param name="_quaternion">The Transform's new rotation, normalized</param>
+void Transform::SetOrientation(DirectX::XMFLOAT4 _quaternion)
+{
+	system->SetOrientation(id, _quaternion);
 }
 
 /// <summary>
@@ -164,8 +201,7 @@ void Transform::SetRotation(DirectX::XMFLOAT3 _pitchYawRoll)
 /// <param name="_z">The Transform's new scale about the Z axis</param>
 void Transform::SetScale(float _x, float _y, float _z)
 {
-	scale = XMFLOAT3(_x, _y, _z);
-	areMatricesDirty = true;
+	system->SetScale(id, XMFLOAT3(_x, _y, _z));
 }
 
 /// <summary>
@@ -174,8 +210,36 @@ void Transform::SetScale(float _x, float _y, float _z)
 /// <param name="_xyz">The Transform's new scale about the X, Y, and Z axes</param>
 void Transform::SetScale(DirectX::XMFLOAT3 _xyz)
 {
-	scale = _xyz;
-	areMatricesDirty = true;
+	system->SetScale(id, _xyz);
+}
+
+/// <summary>
+/// Makes the Transform's position, rotation and scale relative to another
+/// Transform's, so it follows that Transform around. The parent isn't kept
+/// alive by its children; destroying it leaves them with no parent
+/// </summary>
+/// <param name="_parent">The Transform's new parent, in the same TransformSystem, or null for none</param>
+/// <returns>Whether the parent was set, which it isn't if it's in another system or would make a loop</returns>
+bool Transform::SetParent(std::shared_ptr<Transform> _parent)
+{
+	if (!_parent) {
+		return system->SetParent(id, TRANSFORM_NONE);
+	}
+	if (_parent->system != system) {
+		return false;
+	}
+	return system->SetParent(id, _parent->id);
+}
+
+/// <summary>
+/// Sets whether the Transform keeps its rotation as only a quaternion,
+/// so Rotate() composes rotations instead of adding to its angles.
+/// That avoids gimbal lock, and working out angles until they're asked for
+/// </summary>
+/// <param name="_quaternionRotation">Whether to use quaternion rotation</param>
+void Transform::SetQuaternionRotation(bool _quaternionRotation)
+{
+	system->SetQuaternionRotation(id, _quaternionRotation);
 }
 
 /// <summary>
@@ -198,8 +262,9 @@ void Transform::MoveAbsolute(float _x, float _y, float _z)
 void Transform::MoveAbsolute(DirectX::XMFLOAT3 _xyz)
 {
 	// Add translation vector to position and store the result back
+	XMFLOAT3 position = system->GetPosition(id);
 	XMStoreFloat3(&position, XMLoadFloat3(&position) + XMLoadFloat3(&_xyz));
-	areMatricesDirty = true;
+	system->SetPosition(id, position);
 }
 
 /// <summary>
@@ -221,14 +286,10 @@ void Transform::MoveRelative(float _x, float _y, float _z)
 void Transform::MoveRelative(DirectX::XMFLOAT3 _xyz)
 {
 	// Rotates the movement vector by the transform's rotation before adding it to the position
-	XMStoreFloat3(
-		&position, 
-		XMLoadFloat3(&position) + XMVector3Rotate(
-			XMLoadFloat3(&_xyz),
-			XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z)
-		)
-	);
-	areMatricesDirty = true;
+	XMFLOAT3 position = system->GetPosition(id);
+	XMFLOAT4 orientation = system->GetOrientation(id);
+	XMStoreFloat3(&position, XMLoadFloat3(&position) + XMVector3Rotate(XMLoadFloat3(&_xyz), XMLoadFloat4(&orientation)));
+	system->SetPosition(id, position);
 }
 
 /// <summary>
@@ -245,16 +306,14 @@ void Transform::Rotate(float _pitch, float _yaw, float _roll)
 }
 
 /// <summary>
-/// Adds an amount to the Transform's current rotation along each world axis
+/// Adds an amount to the Transform's current rotation along each world axis.
+/// If it uses quaternion rotation, its rotation is composed with one about
+/// the world's axes instead
 /// </summary>
 /// <param name="_pitchYawRoll">How much to add to the Transform's rotation about the world's X, Y, and Z axes</param>
 void Transform::Rotate(DirectX::XMFLOAT3 _pitchYawRoll)
 {
-	// Add rotation vector to rotation and store the result back
-	// (I'm not worrying about gimbal lock)
-	XMStoreFloat3(&rotation, XMLoadFloat3(&rotation) + XMLoadFloat3(&_pitchYawRoll));
-	areMatricesDirty = true;
-	areVerticesDirty = true;
+	system->Rotate(id, _pitchYawRoll);
 }
 
 /// <summary>
@@ -267,12 +326,12 @@ void Transform::Scale(float _x, float _y, float _z)
 {
 	// Because DirectXMath doesn't seem to include element-wise multiplication,
 	// scaling multiplication isn't performed SIMD
-	scale = XMFLOAT3(
+	XMFLOAT3 scale = system->GetScale(id);
+	system->SetScale(id, XMFLOAT3(
 		scale.x * _x,
 		scale.y * _y,
 		scale.z * _z
-	);
-	areMatricesDirty = true;
+	));
 }
 
 /// <summary>
@@ -281,54 +340,5 @@ void Transform::Scale(float _x, float _y, float _z)
 /// <param name="_xyz">How much to multiply to the Transform's scale along its X, Y, and Z axes</param>
 void Transform::Scale(DirectX::XMFLOAT3 _xyz)
 {
-	// Probably more performant to repeat code here
-	// rather than make new function call(?)
-	scale = XMFLOAT3(
-		scale.x * _xyz.x,
-		scale.y * _xyz.y,
-		scale.z * _xyz.z
-	);
-	areMatricesDirty = true;
-}
-
-/// <summary>
-/// Recalculates the Transform's World and World Inverse Transpose matrices,
-/// then marks them as no longer dirty
-/// </summary>
-void Transform::RebuildMatrices()
-{
-	// Multiply Scale to Rotation to Translation to calculate the new World matrix
-	XMMATRIX newWorld =
-		XMMatrixScalingFromVector(XMLoadFloat3(&scale)) *
-		XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&rotation)) *
-		XMMatrixTranslationFromVector(XMLoadFloat3(&position));
-	
-	// Store World matrix
-	XMStoreFloat4x4(&world, newWorld);
-
-	// Transpose and invert World matrix to calculate World Inverse Transpose and store it
-	XMStoreFloat4x4(&worldInverseTranspose, 
-		XMMatrixInverse(0, XMMatrixTranspose(newWorld))
-	);
-
-	// Mark matrices as clean
-	areMatricesDirty = false;
-}
-
-/// <summary>
-/// Recalculates the Transform's Forward, Right, and Up vertices,
-/// then marks them as no longer dirty
-/// </summary>
-void Transform::RebuildVertices()
-{
-	XMVECTOR rotQuat = XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
-	// Set all three vertices
-	XMFLOAT3 worldRight = XMFLOAT3(1.0f, 0.0f, 0.0f);
-	XMFLOAT3 worldUp = XMFLOAT3(0.0f, 1.0f, 0.0f);
-	XMFLOAT3 worldForward = XMFLOAT3(0.0f, 0.0f, 1.0f);
-	// Rotate each vertex by the Transform's rotation values
-	XMStoreFloat3(&right, XMVector3Rotate(XMLoadFloat3(&worldRight), rotQuat));
-	XMStoreFloat3(&up, XMVector3Rotate(XMLoadFloat3(&worldUp), rotQuat));
-	XMStoreFloat3(&forward, XMVector3Rotate(XMLoadFloat3(&worldForward), rotQuat));
-	areVerticesDirty = false;
+	Scale(_xyz.x, _xyz.y, _xyz.z);
 }
@@ -1,31 +1,48 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <memory>
 
-// Represents a transformation in 3D space
+#include "TransformSystem.h"
+
+// Represents a transformation in 3D space, relative to its
+// parent if it has one. The data lives in a TransformSystem,
+// and this is a handle to it there
 class Transform
 {
 public:
-	// Constructor
+	// Constructors/Destructor
 	Transform();
+	Transform(TransformSystem& _system);
+	~Transform();
+	Transform(const Transform&) = delete; // Remove copy constructor
+	Transform& operator=(const Transform&) = delete; // Remove copy-assignment operator
 
 	// Getters
 	DirectX::XMFLOAT3 GetPosition();
 	DirectX::XMFLOAT3 GetRotation();
+	DirectX::XMFLOAT4 GetOrientation();
 	DirectX::XMFLOAT3 GetScale();
 	DirectX::XMFLOAT4X4 GetWorld();
 	DirectX::XMFLOAT4X4 GetWorldInverseTranspose();
 	DirectX::XMFLOAT3 GetForward();
 	DirectX::XMFLOAT3 GetRight();
 	DirectX::XMFLOAT3 GetUp();
+	unsigned long long GetVersion();
+	bool GetQuaternionRotation();
+	// ID of the Transform's data in its TransformSystem
+	unsigned int GetID();
 
 	// Setters
 	void SetPosition(float _x, float _y, float _z);
 	void SetPosition(DirectX::XMFLOAT3 _xyz);
 	void SetRotation(float _pitch, float _yaw, float _roll);
 	void SetRotation(DirectX::XMFLOAT3 _pitchYawRoll);
+	void SetOrientation(DirectX::XMFLOAT4 _quaternion);
 	void SetScale(float _x, float _y, float _z);
 	void SetScale(DirectX::XMFLOAT3 _xyz);
+	bool SetParent(std::shared_ptr<Transform> _parent);
+	void SetQuaternionRotation(bool _quaternionRotation);
 
 	// Mutators
 	void MoveAbsolute(float _x, float _y, float _z);
@@ -38,28 +55,7 @@ public:
 	void Scale(DirectX::XMFLOAT3 _xyz);
 
 private:
-	// Translation
-	DirectX::XMFLOAT3 position;
-	// Rotation
-	DirectX::XMFLOAT3 rotation;
-	// Scale
-	DirectX::XMFLOAT3 scale;
-	// Final World Matrix
-	DirectX::XMFLOAT4X4 world;
-	// Final Inverse Transpose World Matrix
-	DirectX::XMFLOAT4X4 worldInverseTranspose;
-	// Forward, right, and up vectors for the Transform
-	DirectX::XMFLOAT3 forward;
-	DirectX::XMFLOAT3 right;
-	DirectX::XMFLOAT3 up;
-
-	// Whether World and World Inverse Transpose matrices needs to be rebuilt
-	bool areMatricesDirty;
-	// Whether Forward, Right, and Up vertices need to be rebuilt
-	bool areVerticesDirty;
-
-	// Rebuilds World and WorldInverseTranspose
-	void RebuildMatrices();
-	// Rebuilds Forward, Right, and Up vertices
-	void RebuildVertices();
+	// System holding the Transform's data, and its ID there
+	TransformSystem* system;
+	unsigned int id;
 };
@@ -0,0 +1,887 @@
+#include "TransformSystem.h"
+
+#include <cmath>
+#include <iterator>
+
+using namespace DirectX;
+
+namespace
+{
+	// Reorders _values so slot i holds what was in slot _order[i],
+	// keeping the vector's size (and so its padding)
+	template <typename T> void Permute(std::vector<T>& _values, const std::vector<unsigned int>& _order, size_t _paddedCount, T _padding)
+	{
+		std::vector<T> reordered(_paddedCount, _padding);
+		for (size_t i = 0; i < _order.size(); i++) {
+			reordered[i] = _values[_order[i]];
+		}
+		_values.swap(reordered);
+	}
+
+	// Builds the inverse transpose of a matrix made from only scale, rotation
+	// and translation, without a general inverse. Inverting it undoes the
+	// translation, then the rotation by transposing it, then the scale by its
+	// reciprocal, which leaves each row of the world matrix divided by its
+	// axis's scale squared, with the translation undone in the last column
+	XMMATRIX InverseTransposeSRT(FXMMATRIX _world, float _scaleX, float _scaleY, float _scaleZ)
+	{
+		XMVECTOR inverseScalesSquared;
+		if (_scaleX == _scaleY && _scaleY == _scaleZ) {
+			// A uniform scale only changes the length of the world matrix's
+			// rows, so its 3x3 part works as is, over one scale squared
+			inverseScalesSquared = XMVectorReplicate(1.0f / (_scaleX * _scaleX));
+		}
+		else {
+			inverseScalesSquared = XMVectorReciprocal(XMVectorSet(
+				_scaleX * _scaleX, _scaleY * _scaleY, _scaleZ * _scaleZ, 1.0f));
+		}
+
+		XMVECTOR position = _world.r[3];
+		XMMATRIX inverseTranspose;
+		inverseTranspose.r[0] = XMVectorScale(
+			XMVectorSetW(_world.r[0], -XMVectorGetX(XMVector3Dot(position, _world.r[0]))),
+			XMVectorGetX(inverseScalesSquared));
+		inverseTranspose.r[1] = XMVectorScale(
+			XMVectorSetW(_world.r[1], -XMVectorGetX(XMVector3Dot(position, _world.r[1]))),
+			XMVectorGetY(inverseScalesSquared));
+		inverseTranspose.r[2] = XMVectorScale(
+			XMVectorSetW(_world.r[2], -XMVectorGetX(XMVector3Dot(position, _world.r[2]))),
+			XMVectorGetZ(inverseScalesSquared));
+		inverseTranspose.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+		return inverseTranspose;
+	}
+
+	// A transform for TestInverseTransposes() to build
+	struct InverseTransposeTestCase
+	{
+		int Parent;			// Index of the case that's its parent, or -1
+		XMFLOAT3 Scale;
+		bool Quaternion;	// Whether it uses quaternion rotation
+	};
+
+	// Groups of 4 that are all uniformly scaled (with and without a
+	// parent), mixed groups, non-uniform parents with rotated non-uniform
+	// children, a mirrored scale and quaternion rotation
+	const InverseTransposeTestCase inverseTransposeTestCases[] = {
+		{ -1, { 2.0f, 2.0f, 2.0f }, false },
+		{ -1, { 0.5f, 0.5f, 0.5f }, false },
+		{ -1, { 1.0f, 1.0f, 1.0f }, false },
+		{ -1, { 3.0f, 3.0f, 3.0f }, false },
+
+		{ -1, { 1.0f, 3.0f, 0.5f }, false },
+		{ -1, { 0.25f, 1.0f, 2.0f }, false },
+		{ -1, { 2.0f, 1.0f, 0.5f }, false },
+		{ -1, { 3.0f, 1.0f, 2.0f }, true },
+
+		{ -1, { -1.0f, 2.0f, 1.0f }, false },
+		{ -1, { 1.5f, 1.5f, 1.5f }, false },
+		{ -1, { 0.1f, 0.1f, 0.1f }, false },
+		{ -1, { 4.0f, 4.0f, 4.0f }, true },
+
+		{ 6, { 0.5f, 0.5f, 0.5f }, false },
+		{ 6, { 2.0f, 2.0f, 2.0f }, false },
+		{ 6, { 1.0f, 1.0f, 1.0f }, false },
+		{ 6, { 1.25f, 1.25f, 1.25f }, true },
+
+		{ 6, { 0.5f, 3.0f, 1.0f }, false },
+		{ 9, { 2.0f, 2.0f, 2.0f }, false },
+		{ 9, { 1.0f, 0.5f, 2.0f }, false },
+		{ 16, { 1.5f, 1.5f, 1.5f }, false },
+
+		{ 16, { 2.0f, 1.0f, 0.75f }, false },
+		{ 18, { 0.5f, 0.5f, 0.5f }, false },
+	};
+
+	// Creates every test case in _system, in order, so each group of 4
+	// cases shares a group of 4 slots
+	std::vector<unsigned int> CreateInverseTransposeTestCases(TransformSystem& _system)
+	{
+		std::vector<unsigned int> ids;
+		for (unsigned int i = 0; i < (unsigned int)std::size(inverseTransposeTestCases); i++) {
+			const InverseTransposeTestCase& testCase = inverseTransposeTestCases[i];
+			unsigned int id = _system.Create();
+			_system.SetPosition(id, XMFLOAT3(i * 0.7f - 3.0f, (i % 5) * 1.3f - 2.0f, 4.0f - i * 0.4f));
+			_system.SetQuaternionRotation(id, testCase.Quaternion);
+			_system.Rotate(id, XMFLOAT3(i * 0.37f, i * 0.61f - 1.0f, i * 0.29f + 0.1f));
+			_system.SetScale(id, testCase.Scale);
+			if (testCase.Parent >= 0) {
+				_system.SetParent(id, ids[testCase.Parent]);
+			}
+			ids.push_back(id);
+		}
+		return ids;
+	}
+}
+
+/// <summary>
+/// Constructs a system with no slots
+/// </summary>
+TransformSystem::TransformSystem() :
+	slotCount(0),
+	orderDirty(false)
+{
+}
+
+/// <summary>
+/// Gets the system shared by the whole app, which Transforms use by default
+/// </summary>
+/// <returns>The shared system</returns>
+TransformSystem& TransformSystem::Global()
+{
+	static TransformSystem system;
+	return system;
+}
+
+/// <summary>
+/// Hands out a transform, reusing a destroyed one's slot if there is one.
+/// It has no parent, so any slot keeps parents before their children
+/// </summary>
+/// <returns>ID of the transform, set to no translation, no rotation and normal scale</returns>
+unsigned int TransformSystem::Create()
+{
+	unsigned int slot;
+	if (!freeSlots.empty()) {
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else {
+		slot = slotCount++;
+
+		// Grow the arrays by a whole group of 4 at a time
+		size_t paddedCount = (slotCount + 3) & ~3u;
+		if (paddedCount > positionX.size()) {
+			for (std::vector<float>* component : {
+				&positionX, &positionY, &positionZ,
+				&rotationX, &rotationY, &rotationZ,
+				&orientationX, &orientationY, &orientationZ, &orientationW,
+				&scaleX, &scaleY, &scaleZ }) {
+				component->resize(paddedCount, 0.0f);
+			}
+			worlds.resize(paddedCount);
+			worldInverseTransposes.resize(paddedCount);
+			versions.resize(paddedCount, 0);
+			parents.resize(paddedCount, TRANSFORM_NONE);
+			parentVersions.resize(paddedCount, 0);
+			childCounts.resize(paddedCount, 0);
+			idOfSlot.resize(paddedCount, TRANSFORM_NONE);
+			dirtyBits.resize((paddedCount + 63) / 64, 0);
+			parentedBits.resize((paddedCount + 63) / 64, 0);
+			quaternionBits.resize((paddedCount + 63) / 64, 0);
+			uniformScaleBits.resize((paddedCount + 63) / 64, 0);
+		}
+	}
+
+	unsigned int id;
+	if (!freeIDs.empty()) {
+		id = freeIDs.back();
+		freeIDs.pop_back();
+	}
+	else {
+		id = (unsigned int)slotOfId.size();
+		slotOfId.push_back(TRANSFORM_NONE);
+	}
+	slotOfId[id] = slot;
+	idOfSlot[slot] = id;
+
+	positionX[slot] = positionY[slot] = positionZ[slot] = 0.0f;
+	rotationX[slot] = rotationY[slot] = rotationZ[slot] = 0.0f;
+	orientationX[slot] = orientationY[slot] = orientationZ[slot] = 0.0f;
+	orientationW[slot] = 1.0f;
+	scaleX[slot] = scaleY[slot] = scaleZ[slot] = 1.0f;
+	XMStoreFloat4x4(&worlds[slot], XMMatrixIdentity());
+	XMStoreFloat4x4(&worldInverseTransposes[slot], XMMatrixIdentity());
+	versions[slot] = 0;
+	parents[slot] = TRANSFORM_NONE;
+	parentVersions[slot] = 0;
+	childCounts[slot] = 0;
+	SetBit(dirtyBits, slot, false);
+	SetBit(parentedBits, slot, false);
+	SetBit(quaternionBits, slot, false);
+	SetBit(uniformScaleBits, slot, true);
+	return id;
+}
+
+/// <summary>
+/// Gives a transform's slot and ID back so Create() can reuse them.
+/// Its children are left without a parent, relative to the world instead
+/// </summary>
+/// <param name="_id">ID of the transform</param>
+void TransformSystem::Destroy(unsigned int _id)
+{
+	unsigned int slot = slotOfId[_id];
+
+	// Only transforms with children need to look for them
+	if (childCounts[slot] > 0) {
+		for (unsigned int child = 0; child < slotCount; child++) {
+			if (parents[child] == slot) {
+				SetParent(idOfSlot[child], TRANSFORM_NONE);
+			}
+		}
+	}
+	if (parents[slot] != TRANSFORM_NONE) {
+		childCounts[parents[slot]]--;
+		parents[slot] = TRANSFORM_NONE;
+	}
+
+	SetBit(dirtyBits, slot, false);
+	SetBit(parentedBits, slot, false);
+	idOfSlot[slot] = TRANSFORM_NONE;
+	slotOfId[_id] = TRANSFORM_NONE;
+	freeSlots.push_back(slot);
+	freeIDs.push_back(_id);
+}
+
+DirectX::XMFLOAT3 TransformSystem::GetPosition(unsigned int _id)
+{
+	unsigned int slot = slotOfId[_id];
+	return XMFLOAT3(positionX[slot], positionY[slot], positionZ[slot]);
+}
+
+/// <summary>
+/// Gets a transform's rotation about each axis. If it uses quaternion
+/// rotation, they're worked out from its quaternion first
+/// </summary>
+/// <param name="_id">ID of the transform</param>
+/// <returns>The transform's pitch, yaw and roll</returns>
+DirectX::XMFLOAT3 TransformSystem::GetRotation(unsigned int _id)
+{
+	unsigned int slot = slotOfId[_id];
+	if (GetBit(quaternionBits, slot)) {
+		SetAnglesFromOrientation(slot);
+	}
+	return XMFLOAT3(rotationX[slot], rotationY[slot], rotationZ[slot]);
+}
+
+DirectX::XMFLOAT4 TransformSystem::GetOrientation(unsigned int _id)
+{
+	unsigned int slot = slotOfId[_id];
+	return XMFLOAT4(orientationX[slot], orientationY[slot], orientationZ[slot], orientationW[slot]);
+}
+
+DirectX::XMFLOAT3 TransformSystem::GetScale(unsigned int _id)
+{
+	unsigned int slot = slotOfId[_id];
+	return XMFLOAT3(scaleX[slot], scaleY[slot], scaleZ[slot]);
+}
+
+/// <summary>
+/// Gets a transform's world matrix, rebuilding it on its own if it's out of date
+/// </summary>
+/// <param name="_id">ID of the transform</param>
+/// <returns>The transform's world matrix</returns>
+const DirectX::XMFLOAT4X4& TransformSystem::GetWorld(unsigned int _id)
+{
+	unsigned int slot = slotOfId[_id];
+	EnsureMatrices(slot);
+	return worlds[slot];
+}
+
+/// <summary>
+/// Gets a transform's world inverse transpose matrix, rebuilding it on its own if it's out of date
+/// </summary>
+/// <param name="_id">ID of the transform</param>
+/// <returns>The transform's world inverse transpose matrix</returns>
+const DirectX::XMFLOAT4X4& TransformSystem::GetWorldInverseTranspose(unsigned int _id)
+{
+	unsigned int slot = slotOfId[_id];
+	EnsureMatrices(slot);
+	return worldInverseTransposes[slot];
+}
+
+unsigned long long TransformSystem::GetVersion(unsigned int _id)
+{
+	return versions[slotOfId[_id]];
+}
+
+unsigned int TransformSystem::GetParent(unsigned int _id)
+{
+	unsigned int parent = parents[slotOfId[_id]];
+	return parent == TRANSFORM_NONE ? TRANSFORM_NONE : idOfSlot[parent];
+}
+
+bool TransformSystem::GetQuaternionRotation(unsigned int _id)
+{
+	return GetBit(quaternionBits, slotOfId[_id]);
+}
+
+DirectX::XMFLOAT3 TransformSystem::GetRight(unsigned int _id)
+{
+	return GetRotationRow(slotOfId[_id], 0);
+}
+
+DirectX::XMFLOAT3 TransformSystem::GetUp(unsigned int _id)
+{
+	return GetRotationRow(slotOfId[_id], 1);
+}
+
+DirectX::XMFLOAT3 TransformSystem::GetForward(unsigned int _id)
+{
+	return GetRotationRow(slotOfId[_id], 2);
+}
+
+void TransformSystem::SetPosition(unsigned int _id, DirectX::XMFLOAT3 _position)
+{
+	unsigned int slot = slotOfId[_id];
+	positionX[slot] = _position.x;
+	positionY[slot] = _position.y;
+	positionZ[slot] = _position.z;
+	MarkDirty(slot);
+}
+
+void TransformSystem::SetRotation(unsigned int _id, DirectX::XMFLOAT3 _rotation)
+{
+	unsigned int slot = slotOfId[_id];
+	rotationX[slot] = _rotation.x;
+	rotationY[slot] = _rotation.y;
+	rotationZ[slot] = _rotation.z;
+	SetOrientationFromAngles(slot);
+	MarkDirty(slot);
+}
+
+void TransformSystem::SetOrientation(unsigned int _id, DirectX::XMFLOAT4 _orientation)
+{
+	unsigned int slot = slotOfId[_id];
+	orientationX[slot] = _orientation.x;
+	orientationY[slot] = _orientation.y;
+	orientationZ[slot] = _orientation.z;
+	orientationW[slot] = _orientation.w;
+	if (!GetBit(quaternionBits, slot)) {
+		SetAnglesFromOrientation(slot);
+	}
+	MarkDirty(slot);
+}
+
+void TransformSystem::SetScale(unsigned int _id, DirectX::XMFLOAT3 _scale)
+{
+	unsigned int slot = slotOfId[_id];
+	scaleX[slot] = _scale.x;
+	scaleY[slot] = _scale.y;
+	scaleZ[slot] = _scale.z;
+	SetBit(uniformScaleBits, slot, _scale.x == _scale.y && _scale.y == _scale.z);
+	MarkDirty(slot);
+}
+
+/// <summary>
+/// Makes a transform's position, rotation and scale relative to another
+/// transform's. If that puts it before its new parent, the slots are put
+/// back in breadth-first order at the next UpdateMatrices()
+/// </summary>
+/// <param name="_id">ID of the transform</param>
+/// <param name="_parentID">ID of its new parent, or TRANSFORM_NONE for none</param>
+/// <returns>Whether the parent was set, which it isn't if it would make a loop</returns>
+bool TransformSystem::SetParent(unsigned int _id, unsigned int _parentID)
+{
+	unsigned int slot = slotOfId[_id];
+	unsigned int parent = _parentID == TRANSFORM_NONE ? TRANSFORM_NONE : slotOfId[_parentID];
+
+	// A transform can't be its own ancestor
+	for (unsigned int ancestor = parent; ancestor != TRANSFORM_NONE; ancestor = parents[ancestor]) {
+		if (ancestor == slot) {
+			return false;
+		}
+	}
+
+	if (parents[slot] != TRANSFORM_NONE) {
+		childCounts[parents[slot]]--;
+	}
+	parents[slot] = parent;
+	SetBit(parentedBits, slot, parent != TRANSFORM_NONE);
+	if (parent != TRANSFORM_NONE) {
+		childCounts[parent]++;
+		if (parent > slot) {
+			orderDirty = true;
+		}
+	}
+
+	MarkDirty(slot);
+	return true;
+}
+
+/// <summary>
+/// Sets whether a transform keeps its rotation as only a quaternion. Its
+/// quaternion is always up to date, so this only changes how it rotates
+/// </summary>
+/// <param name="_id">ID of the transform</param>
+/// <param name="_quaternionRotation">Whether to compose rotations instead of adding angles</param>
+void TransformSystem::SetQuaternionRotation(unsigned int _id, bool _quaternionRotation)
+{
+	unsigned int slot = slotOfId[_id];
+	if (GetBit(quaternionBits, slot) && !_quaternionRotation) {
+		SetAnglesFromOrientation(slot);
+	}
+	SetBit(quaternionBits, slot, _quaternionRotation);
+}
+
+/// <summary>
+/// Rotates a transform about each world axis. Transforms using angles add
+/// to them, while ones using quaternion rotation multiply their quaternion
+/// by one made from the angles, which never needs their angles at all
+/// </summary>
+/// <param name="_id">ID of the transform</param>
+/// <param name="_pitchYawRoll">How much to rotate about the X, Y, and Z axes</param>
+void TransformSystem::Rotate(unsigned int _id, DirectX::XMFLOAT3 _pitchYawRoll)
+{
+	unsigned int slot = slotOfId[_id];
+	if (!GetBit(quaternionBits, slot)) {
+		rotationX[slot] += _pitchYawRoll.x;
+		rotationY[slot] += _pitchYawRoll.y;
+		rotationZ[slot] += _pitchYawRoll.z;
+		SetOrientationFromAngles(slot);
+		MarkDirty(slot);
+		return;
+	}
+
+	// Renormalize so rounding errors don't build up over many rotations
+	XMFLOAT4 orientation;
+	XMStoreFloat4(&orientation, XMQuaternionNormalize(XMQuaternionMultiply(
+		XMVectorSet(orientationX[slot], orientationY[slot], orientationZ[slot], orientationW[slot]),
+		XMQuaternionRotationRollPitchYaw(_pitchYawRoll.x, _pitchYawRoll.y, _pitchYawRoll.z))));
+	orientationX[slot] = orientation.x;
+	orientationY[slot] = orientation.y;
+	orientationZ[slot] = orientation.z;
+	orientationW[slot] = orientation.w;
+	MarkDirty(slot);
+}
+
+/// <summary>
+/// Rebuilds the matrices of every out of date slot in one pass from
+/// front to back. Since parents come before their children, a parent
+/// is always rebuilt before its children check whether it moved
+/// </summary>
+/// <returns>Number of slots rebuilt</returns>
+unsigned int TransformSystem::UpdateMatrices()
+{
+	if (orderDirty) {
+		RebuildOrder();
+	}
+
+	unsigned int rebuilt = 0;
+	for (size_t word = 0; word < dirtyBits.size(); word++) {
+		uint64_t bits = dirtyBits[word];
+
+		// Add children whose parent's world matrix changed since they were built
+		uint64_t parented = parentedBits[word];
+		for (unsigned int bit = 0; parented != 0; bit++, parented >>= 1) {
+			if (!(parented & 1)) {
+				continue;
+			}
+			unsigned int slot = (unsigned int)word * 64 + bit;
+			if (versions[parents[slot]] != parentVersions[slot]) {
+				// Their world matrix changes too, even if they didn't
+				if (!((bits >> bit) & 1)) {
+					versions[slot]++;
+				}
+				bits |= 1ull << bit;
+			}
+		}
+
+		if (bits == 0) {
+			continue;
+		}
+		dirtyBits[word] = 0;
+
+		for (unsigned int group = 0; group < 64; group += 4) {
+			unsigned int lanes = (unsigned int)(bits >> group) & 0xF;
+			if (lanes != 0) {
+				RebuildGroup((unsigned int)word * 64 + group, lanes);
+				rebuilt += (lanes & 1) + (lanes >> 1 & 1) + (lanes >> 2 & 1) + (lanes >> 3);
+			}
+		}
+	}
+	return rebuilt;
+}
+
+unsigned int TransformSystem::GetCount()
+{
+	return slotCount - (unsigned int)freeSlots.size();
+}
+
+/// <summary>
+/// Checks the World Inverse Transpose matrices, which are built straight from
+/// scale, rotation and translation, against transposing and inverting each
+/// World matrix with XMMatrixInverse(). Rebuilds any out of date matrices first
+/// </summary>
+/// <returns>Largest difference in any element, divided by the largest element of that matrix (or 1 if that's smaller)</returns>
+float TransformSystem::MeasureInverseTransposeError()
+{
+	UpdateMatrices();
+
+	float maxError = 0.0f;
+	for (unsigned int slot = 0; slot < slotCount; slot++) {
+		if (idOfSlot[slot] == TRANSFORM_NONE) {
+			continue;
+		}
+		XMFLOAT4X4 reference;
+		XMStoreFloat4x4(&reference, XMMatrixInverse(0, XMMatrixTranspose(XMLoadFloat4x4(&worlds[slot]))));
+
+		float difference = 0.0f;
+		float size = 1.0f;
+		for (int row = 0; row < 4; row++) {
+			for (int column = 0; column < 4; column++) {
+				difference = fmaxf(difference, fabsf(worldInverseTransposes[slot].m[row][column] - reference.m[row][column]));
+				size = fmaxf(size, fabsf(reference.m[row][column]));
+			}
+		}
+		maxError = fmaxf(maxError, difference / size);
+	}
+	return maxError;
+}
+
+/// <summary>
+/// Builds transforms with uniform and non-uniform scales, with and without
+/// parents, and checks their World Inverse Transposes against a general
+/// inverse, both when rebuilt four at a time and when rebuilt one at a time
+/// </summary>
+/// <param name="_maxError">Set to the largest relative error found</param>
+/// <returns>Whether every matrix was within TRANSFORM_IT_TOLERANCE</returns>
+bool TransformSystem::TestInverseTransposes(float& _maxError)
+{
+	TransformSystem batched;
+	CreateInverseTransposeTestCases(batched);
+	batched.UpdateMatrices();
+
+	// Reading the matrices before UpdateMatrices() rebuilds them one at a time
+	TransformSystem perObject;
+	for (unsigned int id : CreateInverseTransposeTestCases(perObject)) {
+		perObject.GetWorldInverseTranspose(id);
+	}
+
+	_maxError = fmaxf(batched.MeasureInverseTransposeError(), perObject.MeasureInverseTransposeError());
+	return _maxError <= TRANSFORM_IT_TOLERANCE;
+}
+
+void TransformSystem::MarkDirty(unsigned int _slot)
+{
+	SetBit(dirtyBits, _slot, true);
+	versions[_slot]++;
+}
+
+bool TransformSystem::IsSlotDirty(unsigned int _slot)
+{
+	return GetBit(dirtyBits, _slot);
+}
+
+bool TransformSystem::GetBit(const std::vector<uint64_t>& _bits, unsigned int _slot)
+{
+	return (_bits[_slot / 64] >> (_slot % 64)) & 1;
+}
+
+/// <summary>
+/// Builds a slot's quaternion from its pitch, yaw and roll
+/// </summary>
+/// <param name="_slot">Index of the slot</param>
+void TransformSystem::SetOrientationFromAngles(unsigned int _slot)
+{
+	XMFLOAT4 orientation;
+	XMStoreFloat4(&orientation, XMQuaternionRotationRollPitchYaw(rotationX[_slot], rotationY[_slot], rotationZ[_slot]));
+	orientationX[_slot] = orientation.x;
+	orientationY[_slot] = orientation.y;
+	orientationZ[_slot] = orientation.z;
+	orientationW[_slot] = orientation.w;
+}
+
+/// <summary>
+/// Works out the pitch, yaw and roll that XMQuaternionRotationRollPitchYaw()
+/// would make a slot's quaternion from. Pointing straight up or down, yaw
+/// and roll turn about the same axis, so it's all put into yaw
+/// </summary>
+/// <param name="_slot">Index of the slot</param>
+void TransformSystem::SetAnglesFromOrientation(unsigned int _slot)
+{
+	float x = orientationX[_slot], y = orientationY[_slot], z = orientationZ[_slot], w = orientationW[_slot];
+
+	// Elements of the rotation matrix that pick out each angle
+	float sinPitch = -2.0f * (y * z - x * w);
+	sinPitch = fminf(fmaxf(sinPitch, -1.0f), 1.0f);
+	rotationX[_slot] = asinf(sinPitch);
+	if (fabsf(sinPitch) < 0.9999f) {
+		rotationY[_slot] = atan2f(2.0f * (x * z + y * w), 1.0f - 2.0f * (x * x + y * y));
+		rotationZ[_slot] = atan2f(2.0f * (x * y + z * w), 1.0f - 2.0f * (x * x + z * z));
+	}
+	else {
+		rotationY[_slot] = atan2f(-2.0f * (x * z - y * w), 1.0f - 2.0f * (y * y + z * z));
+		rotationZ[_slot] = 0.0f;
+	}
+}
+
+/// <summary>
+/// Gets one row of the rotation matrix a slot's quaternion makes,
+/// which is where its local X, Y or Z axis points
+/// </summary>
+/// <param name="_slot">Index of the slot</param>
+/// <param name="_row">0 for right, 1 for up or 2 for forward</param>
+/// <returns>The row, which is always normalized</returns>
+DirectX::XMFLOAT3 TransformSystem::GetRotationRow(unsigned int _slot, int _row)
+{
+	float x = orientationX[_slot], y = orientationY[_slot], z = orientationZ[_slot], w = orientationW[_slot];
+	switch (_row) {
+	case 0:
+		return XMFLOAT3(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w));
+	case 1:
+		return XMFLOAT3(2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w));
+	default:
+		return XMFLOAT3(2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y));
+	}
+}
+
+void TransformSystem::SetBit(std::vector<uint64_t>& _bits, unsigned int _slot, bool _value)
+{
+	if (_value) {
+		_bits[_slot / 64] |= 1ull << (_slot % 64);
+	}
+	else {
+		_bits[_slot / 64] &= ~(1ull << (_slot % 64));
+	}
+}
+
+/// <summary>
+/// Rebuilds a slot's matrices if it's dirty or its parent moved, first
+/// doing the same for each of its ancestors from the root down
+/// </summary>
+/// <param name="_slot">Index of the slot</param>
+void TransformSystem::EnsureMatrices(unsigned int _slot)
+{
+	// Most transforms have no parent, so skip gathering ancestors
+	if (parents[_slot] == TRANSFORM_NONE) {
+		if (IsSlotDirty(_slot)) {
+			RebuildMatrices(_slot);
+		}
+		return;
+	}
+
+	ancestors.clear();
+	for (unsigned int slot = _slot; slot != TRANSFORM_NONE; slot = parents[slot]) {
+		ancestors.push_back(slot);
+	}
+	for (size_t i = ancestors.size(); i-- > 0;) {
+		unsigned int slot = ancestors[i];
+		unsigned int parent = parents[slot];
+		bool parentMoved = parent != TRANSFORM_NONE && versions[parent] != parentVersions[slot];
+		if (parentMoved && !IsSlotDirty(slot)) {
+			versions[slot]++;
+		}
+		if (parentMoved || IsSlotDirty(slot)) {
+			RebuildMatrices(slot);
+		}
+	}
+}
+
+/// <summary>
+/// Recalculates one slot's World and World Inverse Transpose
+/// matrices, then marks them as no longer dirty. Its parent's
+/// matrices must already be up to date
+/// </summary>
+/// <param name="_slot">Index of the slot</param>
+void TransformSystem::RebuildMatrices(unsigned int _slot)
+{
+	// Scale each row of the rotation by its axis and add the translation,
+	// the same as multiplying Scale to Rotation to Translation
+	XMMATRIX rotation = XMMatrixRotationQuaternion(XMVectorSet(
+		orientationX[_slot], orientationY[_slot], orientationZ[_slot], orientationW[_slot]));
+	XMMATRIX newWorld(
+		XMVectorScale(rotation.r[0], scaleX[_slot]),
+		XMVectorScale(rotation.r[1], scaleY[_slot]),
+		XMVectorScale(rotation.r[2], scaleZ[_slot]),
+		XMVectorSet(positionX[_slot], positionY[_slot], positionZ[_slot], 1.0f));
+	XMMATRIX newWorldIT = InverseTransposeSRT(newWorld, scaleX[_slot], scaleY[_slot], scaleZ[_slot]);
+
+	// Then by the parent's matrices to put it in world space. The inverse
+	// transpose of a product is the product of the inverse transposes
+	unsigned int parent = parents[_slot];
+	if (parent != TRANSFORM_NONE) {
+		newWorld = newWorld * XMLoadFloat4x4(&worlds[parent]);
+		newWorldIT = newWorldIT * XMLoadFloat4x4(&worldInverseTransposes[parent]);
+		parentVersions[_slot] = versions[parent];
+	}
+	XMStoreFloat4x4(&worlds[_slot], newWorld);
+	XMStoreFloat4x4(&worldInverseTransposes[_slot], newWorldIT);
+
+	SetBit(dirtyBits, _slot, false);
+}
+
+/// <summary>
+/// Rebuilds the matrices of up to 4 neighboring slots at once. Each
+/// component of the 4 slots is loaded into one vector, so every step
+/// of building the matrices works on all 4 slots in one instruction
+/// </summary>
+/// <param name="_first">Index of the group's first slot, a multiple of 4</param>
+/// <param name="_lanes">Bit for each slot in the group that needs storing</param>
+void TransformSystem::RebuildGroup(unsigned int _first, unsigned int _lanes)
+{
+	XMVECTOR qx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&orientationX[_first]));
+	XMVECTOR qy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&orientationY[_first]));
+	XMVECTOR qz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&orientationZ[_first]));
+	XMVECTOR qw = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&orientationW[_first]));
+	XMVECTOR sx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&scaleX[_first]));
+	XMVECTOR sy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&scaleY[_first]));
+	XMVECTOR sz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&scaleZ[_first]));
+
+	// Rows of XMMatrixRotationQuaternion(), which needs no trig
+	XMVECTOR one = XMVectorSplatOne();
+	XMVECTOR two = one + one;
+	XMVECTOR xx = qx * qx, yy = qy * qy, zz = qz * qz;
+	XMVECTOR xy = qx * qy, xz = qx * qz, yz = qy * qz;
+	XMVECTOR xw = qx * qw, yw = qy * qw, zw = qz * qw;
+	XMVECTOR r00 = one - two * (yy + zz);
+	XMVECTOR r01 = two * (xy + zw);
+	XMVECTOR r02 = two * (xz - yw);
+	XMVECTOR r10 = two * (xy - zw);
+	XMVECTOR r11 = one - two * (xx + zz);
+	XMVECTOR r12 = two * (yz + xw);
+	XMVECTOR r20 = two * (xz + yw);
+	XMVECTOR r21 = two * (yz - xw);
+	XMVECTOR r22 = one - two * (xx + yy);
+	XMVECTOR px = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&positionX[_first]));
+	XMVECTOR py = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&positionY[_first]));
+	XMVECTOR pz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&positionZ[_first]));
+
+	// World rows are the rotation's rows times their axis's scale
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR w00 = r00 * sx, w01 = r01 * sx, w02 = r02 * sx;
+	XMVECTOR w10 = r10 * sy, w11 = r11 * sy, w12 = r12 * sy;
+	XMVECTOR w20 = r20 * sz, w21 = r21 * sz, w22 = r22 * sz;
+	XMMATRIX rows0 = XMMatrixTranspose(XMMATRIX(w00, w01, w02, zero));
+	XMMATRIX rows1 = XMMatrixTranspose(XMMATRIX(w10, w11, w12, zero));
+	XMMATRIX rows2 = XMMatrixTranspose(XMMATRIX(w20, w21, w22, zero));
+	XMMATRIX rows3 = XMMatrixTranspose(XMMATRIX(px, py, pz, one));
+
+	// World Inverse Transpose rows are the rotation's rows divided by their
+	// axis's scale, with the translation undone in the last column
+	// (the same as InverseTransposeSRT(), a lane per slot)
+	XMMATRIX itRows0, itRows1, itRows2;
+	unsigned int uniformLanes = (unsigned int)(uniformScaleBits[_first / 64] >> (_first % 64)) & 0xF;
+	if ((uniformLanes & _lanes) == _lanes) {
+		// With the same scale on every axis, that's just the world rows
+		// over the scale squared, so one reciprocal does all three
+		XMVECTOR is2 = XMVectorReciprocal(sx * sx);
+		itRows0 = XMMatrixTranspose(XMMATRIX(
+			w00 * is2, w01 * is2, w02 * is2, -(px * w00 + py * w01 + pz * w02) * is2));
+		itRows1 = XMMatrixTranspose(XMMATRIX(
+			w10 * is2, w11 * is2, w12 * is2, -(px * w10 + py * w11 + pz * w12) * is2));
+		itRows2 = XMMatrixTranspose(XMMATRIX(
+			w20 * is2, w21 * is2, w22 * is2, -(px * w20 + py * w21 + pz * w22) * is2));
+	}
+	else {
+		XMVECTOR isx = XMVectorReciprocal(sx);
+		XMVECTOR isy = XMVectorReciprocal(sy);
+		XMVECTOR isz = XMVectorReciprocal(sz);
+		itRows0 = XMMatrixTranspose(XMMATRIX(
+			r00 * isx, r01 * isx, r02 * isx, -(px * r00 + py * r01 + pz * r02) * isx));
+		itRows1 = XMMatrixTranspose(XMMATRIX(
+			r10 * isy, r11 * isy, r12 * isy, -(px * r10 + py * r11 + pz * r12) * isy));
+		itRows2 = XMMatrixTranspose(XMMATRIX(
+			r20 * isz, r21 * isz, r22 * isz, -(px * r20 + py * r21 + pz * r22) * isz));
+	}
+	XMVECTOR itRow3 = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+
+	// After transposing, each slot's rows are in the same lane of each set.
+	// Lanes go in order, so a parent in the same group is stored first
+	for (unsigned int lane = 0; lane < 4; lane++) {
+		if (!(_lanes & (1u << lane))) {
+			continue;
+		}
+		unsigned int slot = _first + lane;
+		XMMATRIX world(rows0.r[lane], rows1.r[lane], rows2.r[lane], rows3.r[lane]);
+		XMMATRIX worldIT(itRows0.r[lane], itRows1.r[lane], itRows2.r[lane], itRow3);
+		unsigned int parent = parents[slot];
+		if (parent != TRANSFORM_NONE) {
+			world = world * XMLoadFloat4x4(&worlds[parent]);
+			worldIT = worldIT * XMLoadFloat4x4(&worldInverseTransposes[parent]);
+			parentVersions[slot] = versions[parent];
+		}
+		XMStoreFloat4x4(&worlds[slot], world);
+		XMStoreFloat4x4(&worldInverseTransposes[slot], worldIT);
+	}
+}
+
+/// <summary>
+/// Moves every slot so that roots come first, then their children,
+/// then their children's children and so on, packing out freed slots.
+/// IDs follow their transforms, so handles stay valid
+/// </summary>
+void TransformSystem::RebuildOrder()
+{
+	orderDirty = false;
+
+	// Group each slot's children together, in their current order
+	std::vector<unsigned int> firstChild(slotCount + 1, 0);
+	for (unsigned int slot = 0; slot < slotCount; slot++) {
+		if (idOfSlot[slot] != TRANSFORM_NONE && parents[slot] != TRANSFORM_NONE) {
+			firstChild[parents[slot] + 1]++;
+		}
+	}
+	for (unsigned int slot = 0; slot < slotCount; slot++) {
+		firstChild[slot + 1] += firstChild[slot];
+	}
+	std::vector<unsigned int> children(firstChild[slotCount]);
+	std::vector<unsigned int> nextChild(firstChild.begin(), firstChild.end() - 1);
+	for (unsigned int slot = 0; slot < slotCount; slot++) {
+		if (idOfSlot[slot] != TRANSFORM_NONE && parents[slot] != TRANSFORM_NONE) {
+			children[nextChild[parents[slot]]++] = slot;
+		}
+	}
+
+	// Roots, then each slot's children in the order the slots were added
+	std::vector<unsigned int> order;
+	order.reserve(slotCount - freeSlots.size());
+	for (unsigned int slot = 0; slot < slotCount; slot++) {
+		if (idOfSlot[slot] != TRANSFORM_NONE && parents[slot] == TRANSFORM_NONE) {
+			order.push_back(slot);
+		}
+	}
+	for (size_t i = 0; i < order.size(); i++) {
+		unsigned int slot = order[i];
+		for (unsigned int c = firstChild[slot]; c < firstChild[slot + 1]; c++) {
+			order.push_back(children[c]);
+		}
+	}
+
+	std::vector<unsigned int> newSlotOf(slotCount, TRANSFORM_NONE);
+	for (unsigned int i = 0; i < (unsigned int)order.size(); i++) {
+		newSlotOf[order[i]] = i;
+	}
+
+	// Move everything to its new slot
+	std::vector<bool> dirty(order.size());
+	std::vector<bool> quaternion(order.size());
+	std::vector<bool> uniformScale(order.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		dirty[i] = IsSlotDirty(order[i]);
+		quaternion[i] = GetBit(quaternionBits, order[i]);
+		uniformScale[i] = GetBit(uniformScaleBits, order[i]);
+	}
+	slotCount = (unsigned int)order.size();
+	size_t paddedCount = (slotCount + 3) & ~3u;
+	for (std::vector<float>* component : {
+		&positionX, &positionY, &positionZ,
+		&rotationX, &rotationY, &rotationZ,
+		&orientationX, &orientationY, &orientationZ, &orientationW }) {
+		Permute(*component, order, paddedCount, 0.0f);
+	}
+	for (std::vector<float>* component : { &scaleX, &scaleY, &scaleZ }) {
+		Permute(*component, order, paddedCount, 1.0f);
+	}
+	Permute(worlds, order, paddedCount, XMFLOAT4X4());
+	Permute(worldInverseTransposes, order, paddedCount, XMFLOAT4X4());
+	Permute(versions, order, paddedCount, 0ull);
+	Permute(parents, order, paddedCount, TRANSFORM_NONE);
+	Permute(parentVersions, order, paddedCount, 0ull);
+	Permute(childCounts, order, paddedCount, 0u);
+	Permute(idOfSlot, order, paddedCount, TRANSFORM_NONE);
+	freeSlots.clear();
+
+	dirtyBits.assign((paddedCount + 63) / 64, 0);
+	parentedBits.assign((paddedCount + 63) / 64, 0);
+	quaternionBits.assign((paddedCount + 63) / 64, 0);
+	uniformScaleBits.assign((paddedCount + 63) / 64, 0);
+	for (unsigned int slot = 0; slot < slotCount; slot++) {
+		if (parents[slot] != TRANSFORM_NONE) {
+			parents[slot] = newSlotOf[parents[slot]];
+			SetBit(parentedBits, slot, true);
+		}
+		SetBit(dirtyBits, slot, dirty[slot]);
+		SetBit(quaternionBits, slot, quaternion[slot]);
+		SetBit(uniformScaleBits, slot, uniformScale[slot]);
+		slotOfId[idOfSlot[slot]] = slot;
+	}
+}
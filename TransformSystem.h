@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+// Marks a transform with no parent, or a handle to nothing
+#define TRANSFORM_NONE	0xFFFFFFFFu
+
+// Largest relative error TransformSystem::TestInverseTransposes()
+// allows in a World Inverse Transpose matrix
+#define TRANSFORM_IT_TOLERANCE	1e-4f
+
+// --------------------------------------------------------
+// Stores every Transform's data in structure-of-arrays form:
+// one contiguous array per component (position X, Y, Z and
+// so on), plus a bit per transform marking whose matrices
+// are out of date.
+//
+// Every transform's rotation is kept as a quaternion, which
+// its matrices and axes are built from without any trig.
+// By default it's set from pitch, yaw and roll angles that
+// are kept too, and rotating adds to them. Transforms set
+// to use quaternion rotation keep only the quaternion, and
+// rotating composes it with another, so they can't gimbal
+// lock; their angles are worked out only when asked for.
+//
+// Transforms can have a parent, in which case their world
+// matrix is their local matrix times their parent's world
+// matrix. The arrays are kept in breadth-first order, so
+// parents always come before their children, and handles
+// are IDs that map to wherever a transform currently is.
+//
+// UpdateMatrices() rebuilds every dirty transform's matrices
+// in one linear pass, four at a time with one per SIMD lane.
+// Children are rebuilt if their parent's world matrix has
+// changed since they were last built, which the pass can
+// tell from the parent's version without walking the tree.
+// Matrices read before then are rebuilt one at a time
+// instead, so they're never out of date either way.
+// --------------------------------------------------------
+class TransformSystem
+{
+public:
+	TransformSystem();
+	TransformSystem(const TransformSystem&) = delete; // Remove copy constructor
+	TransformSystem& operator=(const TransformSystem&) = delete; // Remove copy-assignment operator
+
+	// System every Transform uses unless it's given another
+	static TransformSystem& Global();
+
+	// Hands out a handle to a transform with no translation, no
+	// rotation, normal scale and no parent
+	unsigned int Create();
+	// Frees a transform, leaving its children with no parent
+	void Destroy(unsigned int _id);
+
+	// Getters
+	DirectX::XMFLOAT3 GetPosition(unsigned int _id);
+	DirectX::XMFLOAT3 GetRotation(unsigned int _id);
+	DirectX::XMFLOAT4 GetOrientation(unsigned int _id);
+	DirectX::XMFLOAT3 GetScale(unsigned int _id);
+	// Rebuild the transform's matrices first if they're out of date
+	const DirectX::XMFLOAT4X4& GetWorld(unsigned int _id);
+	const DirectX::XMFLOAT4X4& GetWorldInverseTranspose(unsigned int _id);
+	// Goes up whenever the transform's world matrix changes, including
+	// when its parent moves (once its matrices have been rebuilt)
+	unsigned long long GetVersion(unsigned int _id);
+	unsigned int GetParent(unsigned int _id);
+	bool GetQuaternionRotation(unsigned int _id);
+	// The transform's local axes, from its rotation alone
+	DirectX::XMFLOAT3 GetRight(unsigned int _id);
+	DirectX::XMFLOAT3 GetUp(unsigned int _id);
+	DirectX::XMFLOAT3 GetForward(unsigned int _id);
+
+	// Setters, which mark the transform dirty
+	void SetPosition(unsigned int _id, DirectX::XMFLOAT3 _position);
+	void SetRotation(unsigned int _id, DirectX::XMFLOAT3 _rotation);
+	void SetOrientation(unsigned int _id, DirectX::XMFLOAT4 _orientation);
+	void SetScale(unsigned int _id, DirectX::XMFLOAT3 _scale);
+	// Returns false if _parentID is _id or one of its descendants
+	bool SetParent(unsigned int _id, unsigned int _parentID);
+	// Whether the transform keeps only a quaternion, instead of angles too
+	void SetQuaternionRotation(unsigned int _id, bool _quaternionRotation);
+
+	// Adds angles to the transform's rotation, or composes it with a
+	// rotation about the world's axes if it uses quaternion rotation
+	void Rotate(unsigned int _id, DirectX::XMFLOAT3 _pitchYawRoll);
+
+	// Rebuilds every out of date transform's matrices, returning how many there were
+	unsigned int UpdateMatrices();
+
+	// Number of transforms in use
+	unsigned int GetCount();
+
+	// Largest difference between any transform's World Inverse Transpose
+	// and a general inverse of its World matrix, relative to its size
+	float MeasureInverseTransposeError();
+	// Checks the inverse transposes of a fixed set of tricky transforms,
+	// returning false if any is off by more than TRANSFORM_IT_TOLERANCE
+	static bool TestInverseTransposes(float& _maxError);
+
+private:
+	// PER SLOT
+	// Everything below is indexed by slot, in breadth-first order
+	// Component arrays, padded to a multiple of 4 slots
+	// so every group of 4 can be loaded at once
+	std::vector<float> positionX, positionY, positionZ;
+	// Pitch, yaw and roll, out of date if the slot uses quaternion rotation
+	std::vector<float> rotationX, rotationY, rotationZ;
+	std::vector<float> orientationX, orientationY, orientationZ, orientationW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<DirectX::XMFLOAT4X4> worlds;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposes;
+	std::vector<unsigned long long> versions;
+	// Parent's slot, and the parent's version when the slot was last built
+	std::vector<unsigned int> parents;
+	std::vector<unsigned long long> parentVersions;
+	std::vector<unsigned int> childCounts;
+	std::vector<unsigned int> idOfSlot;
+	// One bit per slot, set if its own data changed
+	std::vector<uint64_t> dirtyBits;
+	// One bit per slot, set if it has a parent
+	std::vector<uint64_t> parentedBits;
+	// One bit per slot, set if it uses quaternion rotation
+	std::vector<uint64_t> quaternionBits;
+	// One bit per slot, set if its own scale is the same on every axis,
+	// so its World Inverse Transpose can be built from its World matrix
+	std::vector<uint64_t> uniformScaleBits;
+	// Slots given back by Destroy()
+	std::vector<unsigned int> freeSlots;
+	// Slots handed out so far, including freed ones
+	unsigned int slotCount;
+	// Whether a slot now comes before its parent
+	bool orderDirty;
+
+	// PER ID
+	std::vector<unsigned int> slotOfId;
+	std::vector<unsigned int> freeIDs;
+
+	// Slots from one up to its root, reused by EnsureMatrices()
+	std::vector<unsigned int> ancestors;
+
+	void MarkDirty(unsigned int _slot);
+	bool IsSlotDirty(unsigned int _slot);
+	bool GetBit(const std::vector<uint64_t>& _bits, unsigned int _slot);
+	void SetOrientationFromAngles(unsigned int _slot);
+	void SetAnglesFromOrientation(unsigned int _slot);
+	// One row of the rotation matrix built from a slot's quaternion
+	DirectX::XMFLOAT3 GetRotationRow(unsigned int _slot, int _row);
+	void SetBit(std::vector<uint64_t>& _bits, unsigned int _slot, bool _value);
+	// Rebuilds a slot and any of its ancestors that are out of date
+	void EnsureMatrices(unsigned int _slot);
+	// Rebuilds one slot's matrices on its own
+	void RebuildMatrices(unsigned int _slot);
+	// Rebuilds the slots in a group of 4 whose bits are set in _lanes
+	void RebuildGroup(unsigned int _first, unsigned int _lanes);
+	// Puts every slot back in breadth-first order, dropping freed slots
+	void RebuildOrder();
+};
@@ -1,11 +1,16 @@
 #include "ShaderStructs.hlsli"
 
-// Data from our primary constant buffer
-cbuffer PrimaryBuffer : register(b0)
+// Data that's the same for everything drawn this frame
+cbuffer PerFrame : register(b0)
 {
-	float4x4 tfWorld;
 	float4x4 tfView;
 	float4x4 tfProjection;
+}
+
+// Data that changes with every entity
+cbuffer PerObject : register(b2)
+{
+	float4x4 tfWorld;
 	float4x4 tfWorldIT;
 }
 
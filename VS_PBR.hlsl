@@ -1,33 +1,71 @@
 #include "ShaderStructs.hlsli"
+#ifdef PACKED_VERTICES
+#include "ShaderPacking.hlsli"
+#endif
 
-// Data from our primary constant buffer
-cbuffer PrimaryBuffer : register(b0)
+// Data that's the same for everything drawn this frame
+cbuffer PerFrame : register(b0)
 {
-	float4x4 tfWorld;
 	float4x4 tfView;
 	float4x4 tfProjection;
+}
+
+#if !defined(INSTANCED) || defined(PACKED_VERTICES)
+// Data that changes with every entity (or every group
+// of instances, which all share a mesh)
+cbuffer PerObject : register(b2)
+{
+#ifndef INSTANCED
+	float4x4 tfWorld;
 	float4x4 tfWorldIT;
-	float4x4 tfShadowView;
-	float4x4 tfShadowProjection;
+#endif
+#ifdef PACKED_VERTICES
+	float3 quantizationScale;
+	float3 quantizationOffset;
+#endif
 }
+#endif
+
+#ifdef PACKED_VERTICES
+#define VERTEX_INPUT VertexShaderInput_Packed
+#else
+#define VERTEX_INPUT VertexShaderInput
+#endif
 
-VertexToPixel_Shadow main(VertexShaderInput input)
+#ifdef INSTANCED
+VertexToPixel_Shadow main(VERTEX_INPUT vertexInput, InstanceInput instance)
 {
+	// Each instance brings its own matrices
+	float4x4 world = instance.world;
+	float4x4 worldIT = instance.worldIT;
+#else
+VertexToPixel_Shadow main(VERTEX_INPUT vertexInput)
+{
+	float4x4 world = tfWorld;
+	float4x4 worldIT = tfWorldIT;
+#endif
+#ifdef PACKED_VERTICES
+	// Decompress the vertex, then carry on as usual
+	VertexShaderInput input = UnpackVertex(vertexInput, quantizationScale, quantizationOffset);
+#else
+	VertexShaderInput input = vertexInput;
+#endif
+
 	// Set up output struct
 	VertexToPixel_Shadow output;
 
 	// Build wvp matrix and find the screen position
-	matrix wvp = mul(tfProjection, mul(tfView, tfWorld));
+	matrix wvp = mul(tfProjection, mul(tfView, world));
 	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
 	// Send other data through the pipeline
-	output.normal = mul((float3x3)tfWorldIT, input.normal);
-	output.tangent = mul((float3x3)tfWorld, input.tangent);
+	output.normal = mul((float3x3)worldIT, input.normal);
+	output.tangent = mul((float3x3)world, input.tangent);
 	output.uv = input.uv;
-	output.worldPosition = mul(tfWorld, float4(input.localPosition, 1)).xyz;
+	output.worldPosition = mul(world, float4(input.localPosition, 1)).xyz;
 
-	// Calculate shadow map position
-	matrix shadowWVP = mul(tfShadowProjection, mul(tfShadowView, tfWorld));
-	output.shadowPosition = mul(shadowWVP, float4(input.localPosition, 1.0f));
+	// Calculate depth in front of the camera, so the pixel
+	// shader can pick which shadow cascade to sample
+	output.viewDepth = mul(tfView, float4(output.worldPosition, 1.0f)).z;
 
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
@@ -0,0 +1,4 @@
+// VS_PBR for instanced draws, with each instance's matrices
+// coming from an instance buffer
+#define INSTANCED
+#include "VS_PBR.hlsl"
@@ -0,0 +1,3 @@
+// VS_PBR for meshes with PackedVertex vertices
+#define PACKED_VERTICES
+#include "VS_PBR.hlsl"
@@ -0,0 +1,4 @@
+// VS_PBR for instanced draws of meshes with PackedVertex vertices
+#define PACKED_VERTICES
+#define INSTANCED
+#include "VS_PBR.hlsl"
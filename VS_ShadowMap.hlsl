@@ -1,16 +1,55 @@
 #include "ShaderStructs.hlsli"
+#ifdef PACKED_VERTICES
+#include "ShaderPacking.hlsli"
+#endif
 
-cbuffer PrimaryBuffer : register(b0)
+// Data that's the same for every caster drawn into a cascade
+cbuffer PerCascade : register(b0)
 {
-	matrix world;
 	matrix view;
 	matrix projection;
 }
 
-float4 main(VertexShaderInput input) : SV_POSITION
+#if !defined(INSTANCED) || defined(PACKED_VERTICES)
+// Data that changes with every caster (or every group
+// of instances, which all share a mesh)
+cbuffer PerObject : register(b2)
 {
+#ifndef INSTANCED
+	matrix world;
+#endif
+#ifdef PACKED_VERTICES
+	float3 quantizationScale;
+	float3 quantizationOffset;
+#endif
+}
+#endif
+
+#ifdef PACKED_VERTICES
+#define VERTEX_INPUT VertexShaderInput_Packed
+#else
+#define VERTEX_INPUT VertexShaderInput
+#endif
+
+#ifdef INSTANCED
+float4 main(VERTEX_INPUT vertexInput, InstanceInput instance) : SV_POSITION
+{
+	// Each instance brings its own world matrix
+	matrix casterWorld = instance.world;
+#else
+float4 main(VERTEX_INPUT vertexInput) : SV_POSITION
+{
+	matrix casterWorld = world;
+#endif
+#ifdef PACKED_VERTICES
+	// Decompress the vertex, then carry on as usual
+	VertexShaderInput input = UnpackVertex(vertexInput, quantizationScale, quantizationOffset);
+#else
+	VertexShaderInput input = vertexInput;
+#endif
+
 	return mul(
-		mul(projection, mul(view, world)),
+		mul(projection, mul(view, casterWorld)),
 		float4(input.localPosition, 1.0f)
 	);
-}
\ No newline at end of file
+}
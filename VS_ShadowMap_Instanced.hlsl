@@ -0,0 +1,4 @@
+// VS_ShadowMap for instanced draws, with each instance's world
+// matrix coming from an instance buffer
+#define INSTANCED
+#include "VS_ShadowMap.hlsl"
@@ -0,0 +1,3 @@
+// VS_ShadowMap for meshes with PackedVertex vertices
+#define PACKED_VERTICES
+#include "VS_ShadowMap.hlsl"
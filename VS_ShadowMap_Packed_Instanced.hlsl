@@ -0,0 +1,4 @@
+// VS_ShadowMap for instanced draws of meshes with PackedVertex vertices
+#define PACKED_VERTICES
+#define INSTANCED
+#include "VS_ShadowMap.hlsl"
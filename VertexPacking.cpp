@@ -0,0 +1,196 @@
+#include <cmath>
+
+#include <DirectXPackedVector.h>
+
+#include "VertexPacking.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Converts a value in [-1, 1] to snorm16 and back
+	// the same way the GPU does
+	inline int16_t FloatToSnorm16(float _value)
+	{
+		_value = _value < -1.0f ? -1.0f : (_value > 1.0f ? 1.0f : _value);
+		return (int16_t)lroundf(_value * 32767.0f);
+	}
+
+	inline float Snorm16ToFloat(int16_t _value)
+	{
+		float result = _value / 32767.0f;
+		return result < -1.0f ? -1.0f : result;
+	}
+
+	inline float SignNotZero(float _value)
+	{
+		return _value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	// Maps a unit vector onto an octahedron, unfolded into
+	// the [-1, 1] square, so it can be stored in two values
+	XMFLOAT2 OctahedralEncode(const XMFLOAT3& _vector)
+	{
+		float length = fabsf(_vector.x) + fabsf(_vector.y) + fabsf(_vector.z);
+		if (length == 0.0f) {
+			return XMFLOAT2(0, 0);
+		}
+
+		XMFLOAT2 result(_vector.x / length, _vector.y / length);
+
+		// Fold the lower half of the octahedron over the upper half
+		if (_vector.z < 0.0f) {
+			float x = result.x;
+			result.x = (1.0f - fabsf(result.y)) * SignNotZero(x);
+			result.y = (1.0f - fabsf(x)) * SignNotZero(result.y);
+		}
+		return result;
+	}
+
+	// Inverse of OctahedralEncode, matching OctahedralDecode in ShaderPacking.hlsli
+	XMFLOAT3 OctahedralDecode(float _x, float _y)
+	{
+		XMFLOAT3 result(_x, _y, 1.0f - fabsf(_x) - fabsf(_y));
+		float t = result.z < 0.0f ? -result.z : 0.0f;
+		result.x += result.x >= 0.0f ? -t : t;
+		result.y += result.y >= 0.0f ? -t : t;
+
+		XMStoreFloat3(&result, XMVector3Normalize(XMLoadFloat3(&result)));
+		return result;
+	}
+
+	// Angle between two vectors in degrees
+	float AngleDegrees(const XMFLOAT3& _a, const XMFLOAT3& _b)
+	{
+		XMVECTOR a = XMVector3Normalize(XMLoadFloat3(&_a));
+		XMVECTOR b = XMVector3Normalize(XMLoadFloat3(&_b));
+		float cosine = XMVectorGetX(XMVector3Dot(a, b));
+		cosine = cosine < -1.0f ? -1.0f : (cosine > 1.0f ? 1.0f : cosine);
+		return XMConvertToDegrees(acosf(cosine));
+	}
+}
+
+/// <summary>
+/// Finds the scale and offset that fit every vertex's position into [-1, 1]
+/// </summary>
+/// <param name="_vertices">Array of vertices</param>
+/// <param name="_vertexCount">Number of vertices in the array</param>
+/// <returns>The quantization for the vertices' bounds</returns>
+VertexQuantization VertexPacking::ComputeQuantization(const Vertex* _vertices, size_t _vertexCount)
+{
+	VertexQuantization quantization = { XMFLOAT3(1, 1, 1), XMFLOAT3(0, 0, 0) };
+	if (_vertexCount == 0) {
+		return quantization;
+	}
+
+	XMVECTOR min = XMLoadFloat3(&_vertices[0].Position);
+	XMVECTOR max = min;
+	for (size_t i = 1; i < _vertexCount; i++) {
+		XMVECTOR position = XMLoadFloat3(&_vertices[i].Position);
+		min = XMVectorMin(min, position);
+		max = XMVectorMax(max, position);
+	}
+
+	// Keep flat meshes (like quads) from dividing by zero
+	XMVECTOR scale = XMVectorMax((max - min) * 0.5f, XMVectorReplicate(1e-6f));
+	XMStoreFloat3(&quantization.Scale, scale);
+	XMStoreFloat3(&quantization.Offset, (max + min) * 0.5f);
+	return quantization;
+}
+
+/// <summary>
+/// Compresses a vertex into the PackedVertex format
+/// </summary>
+/// <param name="_vertex">The vertex to compress</param>
+/// <param name="_quantization">Bounds of the mesh the vertex is from</param>
+/// <returns>The compressed vertex</returns>
+PackedVertex VertexPacking::Encode(const Vertex& _vertex, const VertexQuantization& _quantization)
+{
+	PackedVertex packed = {};
+	packed.Position[0] = FloatToSnorm16((_vertex.Position.x - _quantization.Offset.x) / _quantization.Scale.x);
+	packed.Position[1] = FloatToSnorm16((_vertex.Position.y - _quantization.Offset.y) / _quantization.Scale.y);
+	packed.Position[2] = FloatToSnorm16((_vertex.Position.z - _quantization.Offset.z) / _quantization.Scale.z);
+	packed.Position[3] = FloatToSnorm16(1.0f);
+
+	XMFLOAT2 normal = OctahedralEncode(_vertex.Normal);
+	XMFLOAT2 tangent = OctahedralEncode(_vertex.Tangent);
+	packed.NormalTangent[0] = FloatToSnorm16(normal.x);
+	packed.NormalTangent[1] = FloatToSnorm16(normal.y);
+	packed.NormalTangent[2] = FloatToSnorm16(tangent.x);
+	packed.NormalTangent[3] = FloatToSnorm16(tangent.y);
+
+	packed.UV[0] = PackedVector::XMConvertFloatToHalf(_vertex.UV.x);
+	packed.UV[1] = PackedVector::XMConvertFloatToHalf(_vertex.UV.y);
+	return packed;
+}
+
+/// <summary>
+/// Decompresses a PackedVertex the same way the packed vertex shaders do
+/// </summary>
+/// <param name="_packed">The compressed vertex</param>
+/// <param name="_quantization">Bounds of the mesh the vertex is from</param>
+/// <returns>The decompressed vertex</returns>
+Vertex VertexPacking::Decode(const PackedVertex& _packed, const VertexQuantization& _quantization)
+{
+	Vertex vertex = {};
+	vertex.Position.x = Snorm16ToFloat(_packed.Position[0]) * _quantization.Scale.x + _quantization.Offset.x;
+	vertex.Position.y = Snorm16ToFloat(_packed.Position[1]) * _quantization.Scale.y + _quantization.Offset.y;
+	vertex.Position.z = Snorm16ToFloat(_packed.Position[2]) * _quantization.Scale.z + _quantization.Offset.z;
+
+	vertex.Normal = OctahedralDecode(Snorm16ToFloat(_packed.NormalTangent[0]), Snorm16ToFloat(_packed.NormalTangent[1]));
+	vertex.Tangent = OctahedralDecode(Snorm16ToFloat(_packed.NormalTangent[2]), Snorm16ToFloat(_packed.NormalTangent[3]));
+
+	vertex.UV.x = PackedVector::XMConvertHalfToFloat(_packed.UV[0]);
+	vertex.UV.y = PackedVector::XMConvertHalfToFloat(_packed.UV[1]);
+	return vertex;
+}
+
+/// <summary>
+/// Compresses an array of vertices, decompressing each one again
+/// to measure how far it moved
+/// </summary>
+/// <param name="_vertices">Array of vertices to compress</param>
+/// <param name="_vertexCount">Number of vertices in the array</param>
+/// <param name="_quantization">Bounds of the mesh the vertices are from</param>
+/// <param name="_packed">Array the compressed vertices are written to, with room for _vertexCount vertices</param>
+/// <returns>The largest and average error of each part of the vertices</returns>
+VertexPackingError VertexPacking::Pack(const Vertex* _vertices, size_t _vertexCount, const VertexQuantization& _quantization, PackedVertex* _packed)
+{
+	VertexPackingError error = {};
+	if (_vertexCount == 0) {
+		return error;
+	}
+
+	double totalPosition = 0.0;
+	double totalNormal = 0.0;
+	double totalTangent = 0.0;
+	double totalUV = 0.0;
+
+	for (size_t i = 0; i < _vertexCount; i++) {
+		_packed[i] = Encode(_vertices[i], _quantization);
+		Vertex decoded = Decode(_packed[i], _quantization);
+
+		XMVECTOR positionDifference = XMLoadFloat3(&decoded.Position) - XMLoadFloat3(&_vertices[i].Position);
+		XMVECTOR uvDifference = XMLoadFloat2(&decoded.UV) - XMLoadFloat2(&_vertices[i].UV);
+		float position = XMVectorGetX(XMVector3Length(positionDifference));
+		float normal = AngleDegrees(decoded.Normal, _vertices[i].Normal);
+		float tangent = AngleDegrees(decoded.Tangent, _vertices[i].Tangent);
+		float uv = XMVectorGetX(XMVector2Length(uvDifference));
+
+		error.MaxPosition = fmaxf(error.MaxPosition, position);
+		error.MaxNormalDegrees = fmaxf(error.MaxNormalDegrees, normal);
+		error.MaxTangentDegrees = fmaxf(error.MaxTangentDegrees, tangent);
+		error.MaxUV = fmaxf(error.MaxUV, uv);
+
+		totalPosition += position;
+		totalNormal += normal;
+		totalTangent += tangent;
+		totalUV += uv;
+	}
+
+	error.AveragePosition = (float)(totalPosition / _vertexCount);
+	error.AverageNormalDegrees = (float)(totalNormal / _vertexCount);
+	error.AverageTangentDegrees = (float)(totalTangent / _vertexCount);
+	error.AverageUV = (float)(totalUV / _vertexCount);
+	return error;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// A compressed alternative to Vertex (20 bytes vs. 44)
+//
+// - Position is snorm16, relative to the mesh's bounds
+// - Normal and tangent are octahedral-encoded snorm16
+// - UV is half precision
+//
+// Must match VertexShaderInput_Packed in ShaderPacking.hlsli
+// --------------------------------------------------------
+struct PackedVertex
+{
+	int16_t Position[4];		// R16G16B16A16_SNORM, W unused
+	int16_t NormalTangent[4];	// R16G16B16A16_SNORM, normal in XY and tangent in ZW
+	uint16_t UV[2];				// R16G16_FLOAT
+};
+
+// Maps a mesh's positions into the [-1, 1] range snorm16 can store:
+// packed = (position - Offset) / Scale
+struct VertexQuantization
+{
+	DirectX::XMFLOAT3 Scale;	// Half the size of the mesh's bounds
+	DirectX::XMFLOAT3 Offset;	// Center of the mesh's bounds
+};
+
+// How far vertices moved after being packed and unpacked again
+struct VertexPackingError
+{
+	float MaxPosition;			// In local units
+	float AveragePosition;
+	float MaxNormalDegrees;
+	float AverageNormalDegrees;
+	float MaxTangentDegrees;
+	float AverageTangentDegrees;
+	float MaxUV;
+	float AverageUV;
+};
+
+namespace VertexPacking
+{
+	// Finds the quantization that fits a set of vertices' positions
+	VertexQuantization ComputeQuantization(const Vertex* _vertices, size_t _vertexCount);
+
+	// Compresses and decompresses single vertices
+	PackedVertex Encode(const Vertex& _vertex, const VertexQuantization& _quantization);
+	Vertex Decode(const PackedVertex& _packed, const VertexQuantization& _quantization);
+
+	// Compresses a set of vertices and measures how much precision was lost
+	VertexPackingError Pack(const Vertex* _vertices, size_t _vertexCount, const VertexQuantization& _quantization, PackedVertex* _packed);
+}
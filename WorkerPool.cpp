@@ -0,0 +1,165 @@
+#include <atomic>
+
+#include "WorkerPool.h"
+
+struct WorkerPool::Batch
+{
+	const std::function<void(size_t)>* Job;
+	size_t Count;
+	std::atomic<size_t> NextIndex;
+};
+
+namespace
+{
+	// Whether the current thread is already inside a ParallelFor() job,
+	// so nested loops run on the spot instead of waiting on themselves
+	thread_local bool isInsideJob = false;
+}
+
+/// <summary>
+/// Constructs a WorkerPool and starts its threads
+/// </summary>
+/// <param name="_workerCount">Number of threads to start (not counting threads that call ParallelFor)</param>
+WorkerPool::WorkerPool(unsigned int _workerCount) :
+	batch(nullptr),
+	batchNumber(0),
+	activeWorkers(0),
+	isStopping(false)
+{
+	for (unsigned int i = 0; i < _workerCount; i++) {
+		workers.emplace_back(&WorkerPool::WorkerLoop, this);
+	}
+}
+
+/// <summary>
+/// Stops and joins every worker thread
+/// </summary>
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		isStopping = true;
+	}
+	wakeCondition.notify_all();
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+/// <summary>
+/// Runs a job once for every index in a range, spreading the indices
+/// across the worker threads and the calling thread
+/// </summary>
+/// <param name="_count">Number of indices to run the job for</param>
+/// <param name="_job">Function to run for each index, which must be safe to call from multiple threads at once</param>
+void WorkerPool::ParallelFor(size_t _count, const std::function<void(size_t)>& _job)
+{
+	Batch localBatch;
+	localBatch.Job = &_job;
+	localBatch.Count = _count;
+	localBatch.NextIndex = 0;
+
+	// Hand the loop to the workers, unless there's no point or they're
+	// already busy (with a loop this one may have been called from)
+	bool isShared = false;
+	if (_count > 1 && !workers.empty() && !isInsideJob) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (batch == nullptr) {
+			batch = &localBatch;
+			batchNumber++;
+			isShared = true;
+		}
+	}
+
+	if (isShared) {
+		wakeCondition.notify_all();
+	}
+
+	// Work on the loop from this thread too
+	bool wasInsideJob = isInsideJob;
+	isInsideJob = true;
+	RunBatch(localBatch);
+	isInsideJob = wasInsideJob;
+
+	if (isShared) {
+		// Every index has been taken at this point, so just wait
+		// for workers to finish the ones they're still running
+		std::unique_lock<std::mutex> lock(mutex);
+		finishedCondition.wait(lock, [this]() { return activeWorkers == 0; });
+		batch = nullptr;
+	}
+}
+
+/// <summary>
+/// Gets how many threads work on each ParallelFor() loop
+/// </summary>
+/// <returns>The number of worker threads plus the calling thread</returns>
+unsigned int WorkerPool::GetThreadCount()
+{
+	return (unsigned int)workers.size() + 1;
+}
+
+/// <summary>
+/// Gets the pool shared by the whole app, starting it the first time it's used
+/// </summary>
+/// <returns>A pool with one thread per core (counting the thread that calls ParallelFor)</returns>
+WorkerPool& WorkerPool::Global()
+{
+	static WorkerPool pool(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0);
+	return pool;
+}
+
+/// <summary>
+/// Gets whether the calling thread is a worker or is running a job,
+/// meaning a nested ParallelFor() wouldn't be split across threads
+/// </summary>
+/// <returns>Whether the calling thread is already inside a job</returns>
+bool WorkerPool::IsInsideJob()
+{
+	return isInsideJob;
+}
+
+/// <summary>
+/// Waits for loops to work on until the pool is destroyed
+/// </summary>
+void WorkerPool::WorkerLoop()
+{
+	isInsideJob = true;
+	unsigned long long lastBatchNumber = 0;
+
+	while (true) {
+		Batch* currentBatch = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait(lock, [&]() { return isStopping || (batch != nullptr && batchNumber != lastBatchNumber); });
+			if (isStopping) {
+				return;
+			}
+
+			currentBatch = batch;
+			lastBatchNumber = batchNumber;
+			activeWorkers++;
+		}
+
+		RunBatch(*currentBatch);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			activeWorkers--;
+		}
+		finishedCondition.notify_one();
+	}
+}
+
+/// <summary>
+/// Runs iterations of a batch until every index has been taken
+/// </summary>
+/// <param name="_batch">The batch to work on</param>
+void WorkerPool::RunBatch(Batch& _batch)
+{
+	size_t index;
+	while ((index = _batch.NextIndex.fetch_add(1)) < _batch.Count) {
+		(*_batch.Job)(index);
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// A fixed set of worker threads that split loops between
+// them. The calling thread works on the loop too, and
+// ParallelFor() doesn't return until every iteration is done
+// --------------------------------------------------------
+class WorkerPool
+{
+public:
+	// Constructors/Destructor
+	WorkerPool(unsigned int _workerCount);
+	~WorkerPool();
+	WorkerPool(const WorkerPool&) = delete; // Remove copy constructor
+	WorkerPool& operator=(const WorkerPool&) = delete; // Remove copy-assignment operator
+
+	// Runs _job(i) for every i in [0, _count), spread across all threads
+	void ParallelFor(size_t _count, const std::function<void(size_t)>& _job);
+
+	// Number of threads that work on each loop, including the caller
+	unsigned int GetThreadCount();
+
+	// Pool shared by the whole app, with one thread per core
+	static WorkerPool& Global();
+
+	// Whether the calling thread is running a ParallelFor() job,
+	// in which case any loops it starts will run on it alone
+	static bool IsInsideJob();
+
+private:
+	// A loop currently being worked on
+	struct Batch;
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	std::condition_variable finishedCondition;
+
+	// Current loop, how many times a loop has been started,
+	// and how many workers are still working on the current loop
+	Batch* batch;
+	unsigned long long batchNumber;
+	unsigned int activeWorkers;
+	bool isStopping;
+
+	// Loop each worker thread runs until the pool is destroyed
+	void WorkerLoop();
+	// Takes iterations from a batch until there are none left
+	static void RunBatch(Batch& _batch);
+};